@@ -6,6 +6,7 @@
 #include "dev_out.h"
 #include "ipc.h"
 #include "settings.h"
+#include "devices_status.h"
 
 #include "rog_ally.h"
 #include "legion_go.h"
@@ -35,6 +36,11 @@ int main(int argc, char ** argv) {
     .enable_leds_commands = false,
     .enable_imu = true,
     .imu_polling_interface = true,
+    .imu_filter = 0,
+    .imu_filter_min_cutoff_hz = 2.0,
+    .imu_filter_beta = 0.5,
+    .imu_filter_cutoff_hz = 80.0,
+    .gyro_bias_estimation = false,
   };
   
   load_in_config(&in_settings, configuration_file);
@@ -50,6 +56,28 @@ int main(int argc, char ** argv) {
     .invert_x = false,
     .gyro_to_analog_activation_treshold = 16,
     .gyro_to_analog_mapping = 4,
+    .gyro_to_analog_exponent = 1.0,
+    .sticks_curve = {
+        .inner_deadzone = 0,
+        .outer_deadzone = 0,
+        .anti_deadzone = 0,
+        .exponent = 1.0,
+    },
+    .sticks_radial = false,
+    .triggers_curve = {
+        .inner_deadzone = 0,
+        .outer_deadzone = 0,
+        .anti_deadzone = 0,
+        .exponent = 1.0,
+    },
+    .gyro_to_mouse = false,
+    .gyro_to_mouse_ratchet = false,
+    .gyro_to_mouse_sensitivity = 8.0,
+    .gyro_to_mouse_acceleration = 0.0,
+    .motion_prediction = false,
+    .motion_prediction_quadratic = false,
+    .motion_prediction_horizon_us = 4000,
+    .motion_prediction_max_delta = 2048,
   };
 
   load_out_config(&out_settings, configuration_file);
@@ -81,10 +109,11 @@ int main(int argc, char ** argv) {
     exit(EXIT_FAILURE);
   }
 
-  int in_message_pipes[2];
-  const int in_msg_pipe_res = pipe(in_message_pipes);
-  if (in_msg_pipe_res != 0) {
-    fprintf(stderr, "Unable to create out_message pipe: %d\n", errno);
+  // dev_in and dev_out share the same address space: input is handed over without any syscall
+  static devices_status_shared_t shared_status;
+  const int shared_status_res = devices_status_shared_init(&shared_status, &out_settings);
+  if (shared_status_res != 0) {
+    fprintf(stderr, "Unable to create the shared input state: %d\n", shared_status_res);
     exit(EXIT_FAILURE);
   }
 
@@ -113,10 +142,10 @@ int main(int argc, char ** argv) {
     .input_dev_decl = in_devs,
     .flags = 0x00000000U,
     .communication = {
-      .type = ipc_unix_pipe,
+      .type = ipc_shared_state,
       .endpoint = {
-        .pipe = {
-          .in_message_pipe_fd = in_message_pipes[1],
+        .shared = {
+          .state = &shared_status,
           .out_message_pipe_fd = out_message_pipes[0],
         }
       }
@@ -128,10 +157,10 @@ int main(int argc, char ** argv) {
   dev_out_data_t dev_out_thread_data = {
     .flags = 0x00000000U,
     .communication = {
-      .type = ipc_unix_pipe,
+      .type = ipc_shared_state,
       .endpoint = {
-        .pipe = {
-          .in_message_pipe_fd = in_message_pipes[0],
+        .shared = {
+          .state = &shared_status,
           .out_message_pipe_fd = out_message_pipes[1],
         }
       }
@@ -204,5 +233,7 @@ main_err:
     printf("dev_out_thread terminated\n");
   }
 
+  devices_status_shared_close(&shared_status);
+
   return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
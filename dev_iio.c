@@ -109,22 +109,6 @@ static int dev_iio_create(char* dev_path, const char* path, dev_iio_t **const ou
     (*out_iio)->flags = 0x00000000U;
     (*out_iio)->fd = -1;
 
-    (*out_iio)->accel_scale_x = 0.0f;
-    (*out_iio)->accel_scale_y = 0.0f;
-    (*out_iio)->accel_scale_z = 0.0f;
-    (*out_iio)->anglvel_scale_x = 0.0f;
-    (*out_iio)->anglvel_scale_y = 0.0f;
-    (*out_iio)->anglvel_scale_z = 0.0f;
-    (*out_iio)->temp_scale = 0.0f;
-
-    (*out_iio)->outer_accel_scale_x = ACCEL_SCALE;
-    (*out_iio)->outer_accel_scale_y = ACCEL_SCALE;
-    (*out_iio)->outer_accel_scale_z = ACCEL_SCALE;
-    (*out_iio)->outer_anglvel_scale_x = GYRO_SCALE;
-    (*out_iio)->outer_anglvel_scale_y = GYRO_SCALE;
-    (*out_iio)->outer_anglvel_scale_z = GYRO_SCALE;
-    (*out_iio)->outer_temp_scale = 0.0;
-
     const long path_len = strlen(path) + 1;
     (*out_iio)->path = malloc(path_len);
     if ((*out_iio)->path == NULL) {
@@ -172,7 +156,6 @@ static int dev_iio_create(char* dev_path, const char* path, dev_iio_t **const ou
         char* const anglvel_scale = rr.buf;
         if (anglvel_scale != NULL) {
             (*out_iio)->flags |= DEV_IIO_HAS_ANGLVEL;
-            (*out_iio)->anglvel_scale_x = (*out_iio)->anglvel_scale_y = (*out_iio)->anglvel_scale_z = strtod(anglvel_scale, NULL);
             free((void*)anglvel_scale);
         } else {
             // TODO: what about if those are split in in_anglvel_{x,y,z}_scale?
@@ -189,7 +172,6 @@ static int dev_iio_create(char* dev_path, const char* path, dev_iio_t **const ou
         char* const accel_scale = rr.buf;
         if (accel_scale != NULL) {
             (*out_iio)->flags |= DEV_IIO_HAS_ACCEL;
-            (*out_iio)->accel_scale_x = (*out_iio)->accel_scale_y = (*out_iio)->accel_scale_z = strtod(accel_scale, NULL);
             free((void*)accel_scale);
         } else {
             // TODO: what about if those are plit in in_accel_{x,y,z}_scale?
@@ -206,7 +188,7 @@ static int dev_iio_create(char* dev_path, const char* path, dev_iio_t **const ou
         rr = read_file((*out_iio)->path, scale_main_file);
         char* const accel_scale = rr.buf;
         if (accel_scale != NULL) {
-            (*out_iio)->temp_scale = strtod(accel_scale, NULL);
+            // temperature is not reported: the file is only required to be there
             free((void*)accel_scale);
         } else {
             fprintf(stderr, "Unable to read in_temp_scale file from path %s%s.\n", (*out_iio)->path, scale_main_file);
@@ -252,7 +234,7 @@ dev_iio_change_anglvel_sampling_freq_err:
 
 int dev_iio_change_accel_sampling_freq(const dev_iio_t *const iio, const char *const freq_str_hz) {
     int res = -EINVAL;
-    if (!dev_iio_has_anglvel(iio)) {
+    if (!dev_iio_has_accel(iio)) {
         res = -ENOENT;
         goto dev_iio_change_accel_sampling_freq_err;
     }
@@ -263,6 +245,87 @@ dev_iio_change_accel_sampling_freq_err:
     return res;
 }
 
+/**
+ * Lowest frequency in the space separated list avail that is at least wanted_hz, the highest one if none is.
+ */
+static double choose_sampling_freq(const char *const avail, double wanted_hz) {
+    double best = 0.0;
+    bool best_enough = false;
+
+    const char *cursor = avail;
+    for (;;) {
+        char *end = NULL;
+        const double freq = strtod(cursor, &end);
+        if (end == cursor) {
+            break;
+        }
+        cursor = end;
+
+        if (freq <= 0.0) {
+            continue;
+        }
+
+        const bool enough = freq >= wanted_hz;
+        if ((best_enough) ? ((enough) && (freq < best)) : ((enough) || (freq > best))) {
+            best = freq;
+            best_enough = enough;
+        }
+    }
+
+    return best;
+}
+
+int dev_iio_negotiate_sampling_freq(
+    const dev_iio_t *const iio,
+    uint32_t wanted_hz,
+    const char *const fallback_freq_str_hz,
+    uint32_t *const out_freq_hz
+) {
+    int res = -ENOENT;
+
+    *out_freq_hz = 0;
+
+    const char *const prefix = dev_iio_has_anglvel(iio) ? "/in_anglvel_sampling_frequency" : "/in_accel_sampling_frequency";
+
+    char file[64];
+    snprintf(file, sizeof(file), "%s_available", prefix);
+
+    char freq_str[32] = "\0";
+    struct read_file_res rr = read_file(iio->path, file);
+    if (rr.buf != NULL) {
+        const double freq = choose_sampling_freq(rr.buf, (double)wanted_hz);
+        free(rr.buf);
+
+        if (freq > 0.0) {
+            snprintf(freq_str, sizeof(freq_str), "%.6f", freq);
+        }
+    }
+
+    if ((freq_str[0] == '\0') && (fallback_freq_str_hz != NULL)) {
+        snprintf(freq_str, sizeof(freq_str), "%s", fallback_freq_str_hz);
+    }
+
+    if (freq_str[0] != '\0') {
+        if (dev_iio_has_anglvel(iio)) {
+            dev_iio_change_anglvel_sampling_freq(iio, freq_str);
+        }
+
+        if (dev_iio_has_accel(iio)) {
+            dev_iio_change_accel_sampling_freq(iio, freq_str);
+        }
+    }
+
+    // what the driver settled on, whatever has been asked
+    rr = read_file(iio->path, prefix);
+    if (rr.buf != NULL) {
+        *out_freq_hz = (uint32_t)lround(strtod(rr.buf, NULL));
+        free(rr.buf);
+        res = 0;
+    }
+
+    return res;
+}
+
 void dev_iio_close(dev_iio_t *const iio) {
     if (iio == NULL) {
         return;
@@ -358,8 +421,37 @@ echo 1 > buffer0/enable
 
 static const char *const iio_path = "/sys/bus/iio/devices/";
 
+/**
+ * Make the sensor use the scale readings are reported in, when it can, so that samples only need their
+ * axes mapped: out_matrix converts from whatever scale the sensor ended up with.
+ */
+static void dev_iio_setup_scale(
+    const dev_iio_t *const iio,
+    const char *const scale_file,
+    const char *const preferred_scale_str,
+    double preferred_scale,
+    const int8_t mount_matrix[3][3],
+    imu_matrix_t *const out_matrix
+) {
+    write_file(iio->path, scale_file, preferred_scale_str, strlen(preferred_scale_str));
+
+    double scale = 0.0;
+    struct read_file_res rr = read_file(iio->path, scale_file);
+    if (rr.buf != NULL) {
+        scale = strtod(rr.buf, NULL);
+        free(rr.buf);
+    }
+
+    if (imu_matrix_compose(out_matrix, mount_matrix, scale, preferred_scale) != 0) {
+        fprintf(stderr, "Unusable %s %f for device %s: readings will not be scaled.\n", &scale_file[1], scale, iio->name);
+    } else if (fabs(scale - preferred_scale) > preferred_scale * 1e-4) {
+        printf("%s of device %s is %f instead of %s: readings will be scaled.\n", &scale_file[1], iio->name, scale, preferred_scale_str);
+    }
+}
+
 int dev_iio_open(
     const iio_filters_t *const in_filters,
+    const int8_t in_mount_matrix[3][3],
     dev_iio_t **const out_dev
 ) {
     int res = -ENOENT;
@@ -395,7 +487,19 @@ int dev_iio_open(
                 continue;
             }
 
-            // the device has been found
+            // the device has been found: a channel it does not have keeps the bare mount matrix
+            if (dev_iio_has_anglvel(*out_dev)) {
+                dev_iio_setup_scale(*out_dev, "/in_anglvel_scale", LSB_PER_RAD_S_2000_DEG_S_STR, LSB_PER_RAD_S_2000_DEG_S, in_mount_matrix, &(*out_dev)->anglvel_matrix);
+            } else {
+                imu_matrix_compose(&(*out_dev)->anglvel_matrix, in_mount_matrix, LSB_PER_RAD_S_2000_DEG_S, LSB_PER_RAD_S_2000_DEG_S);
+            }
+
+            if (dev_iio_has_accel(*out_dev)) {
+                dev_iio_setup_scale(*out_dev, "/in_accel_scale", LSB_PER_16G_STR, LSB_PER_16G, in_mount_matrix, &(*out_dev)->accel_matrix);
+            } else {
+                imu_matrix_compose(&(*out_dev)->accel_matrix, in_mount_matrix, LSB_PER_16G, LSB_PER_16G);
+            }
+
             res = 0;
             break;
         }
@@ -413,6 +517,14 @@ int dev_iio_has_accel(const dev_iio_t* iio) {
     return (iio->flags & DEV_IIO_HAS_ACCEL) != 0;
 }
 
+const imu_matrix_t* dev_iio_get_accel_matrix(const dev_iio_t *const iio) {
+    return &iio->accel_matrix;
+}
+
+const imu_matrix_t* dev_iio_get_anglvel_matrix(const dev_iio_t *const iio) {
+    return &iio->anglvel_matrix;
+}
+
 int dev_iio_get_buffer_fd(const dev_iio_t *const iio) {
     return iio->fd;
 }
@@ -1,15 +1,13 @@
 #pragma once
 
 #include "imu_message.h"
+#include "imu_matrix.h"
 
 #include "input_dev.h"
 
 #define DEV_IIO_HAS_ACCEL   0x00000001U
 #define DEV_IIO_HAS_ANGLVEL 0x00000002U
 
-#define ACCEL_SCALE     ((double)(255.0)/(double)(9.81)) // convert m/s^2 to g's, and scale x255 to increase precision when passed to evdev as an int
-#define GYRO_SCALE      ((double)(180.0)/(double)(M_PI))  // convert radians/s to degrees/s
-
 typedef struct dev_iio {
     char* path;
     char* dev_path;
@@ -17,29 +15,17 @@ typedef struct dev_iio {
     uint32_t flags;
     int fd;
 
-    double accel_scale_x;
-    double accel_scale_y;
-    double accel_scale_z;
-
-    double outer_accel_scale_x;
-    double outer_accel_scale_y;
-    double outer_accel_scale_z;
-
-    double anglvel_scale_x;
-    double anglvel_scale_y;
-    double anglvel_scale_z;
-
-    double outer_anglvel_scale_x;
-    double outer_anglvel_scale_y;
-    double outer_anglvel_scale_z;
-
-    double temp_scale;
-    
-    double outer_temp_scale;
+    // sensor readings to reported units, built from in_accel_scale, in_anglvel_scale and the mount matrix
+    imu_matrix_t accel_matrix;
+    imu_matrix_t anglvel_matrix;
 } dev_iio_t;
 
+/**
+ * Open the iio device matching in_filters: in_mount_matrix maps sensor axes to gamepad axes.
+ */
 int dev_iio_open(
     const iio_filters_t *const in_filters,
+    const int8_t in_mount_matrix[3][3],
     dev_iio_t **const out_dev
 );
 
@@ -55,6 +41,22 @@ int dev_iio_has_anglvel(const dev_iio_t* iio);
 
 int dev_iio_has_accel(const dev_iio_t* iio);
 
+const imu_matrix_t* dev_iio_get_accel_matrix(const dev_iio_t *const iio);
+
+const imu_matrix_t* dev_iio_get_anglvel_matrix(const dev_iio_t *const iio);
+
 int dev_iio_change_anglvel_sampling_freq(const dev_iio_t *const iio, const char *const freq_str_hz);
 
 int dev_iio_change_accel_sampling_freq(const dev_iio_t *const iio, const char *const freq_str_hz);
+
+/**
+ * Set the sampling frequency of every sensor to the lowest available one that is at least wanted_hz
+ * (the highest available otherwise, fallback_freq_str_hz when the driver does not list them) and
+ * write to out_freq_hz the one the device is actually sampling at.
+ */
+int dev_iio_negotiate_sampling_freq(
+    const dev_iio_t *const iio,
+    uint32_t wanted_hz,
+    const char *const fallback_freq_str_hz,
+    uint32_t *const out_freq_hz
+);
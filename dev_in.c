@@ -3,9 +3,11 @@
 #include "input_dev.h"
 #include "ipc.h"
 #include "message.h"
+#include "devices_status.h"
 #include "dev_evdev.h"
 #include "dev_iio.h"
 #include "dev_timer.h"
+#include "imu_filter.h"
 
 #include <libconfig.h>
 
@@ -21,8 +23,23 @@ typedef struct dev_in_iio {
 
     dev_iio_t *iiodev;
 
+    // sampling frequency the device has been declared with, used until dev_out tells the one it needs
+    const char *sampling_freq_hz;
+
+    // the one the device has been set to, 0 when unknown
+    uint32_t sampling_rate_hz;
+
 } dev_in_iio_t;
 
+/**
+ * Axes of the iio buffer scan elements to gamepad axes: y and z are swapped and y is inverted.
+ */
+static const int8_t iio_mount_matrix[3][3] = {
+    {1, 0, 0},
+    {0, 0, -1},
+    {0, 1, 0},
+};
+
 typedef struct dev_in_hidraw {
     dev_hidraw_t *hidrawdev;
 
@@ -46,6 +63,12 @@ typedef struct dev_in_ev {
 
     struct ff_effect ff_effect;
 
+    // events of the frame being read: it is only mapped once its SYN_REPORT has been read
+    evdev_collected_t frame;
+
+    // the kernel dropped events: libevdev is replaying what changed in the meantime
+    bool syncing;
+
     ev_callbacks_t callbacks;
 
     void* user_data;
@@ -53,8 +76,13 @@ typedef struct dev_in_ev {
 } dev_in_ev_t;
 
 typedef struct dev_in_timer {
-    
-    dev_timer_t* timer;
+
+    // every timer of the thread is behind the same fd
+    dev_timer_t* timers;
+
+    int slot;
+
+    uint32_t id;
 
     const char* name;
 
@@ -97,22 +125,26 @@ static int map_message_from_iio(dev_in_iio_t *const in_iio, in_message_t *const
         goto send_message_from_iio_err;
     }
 
-    uint16_t *const scan_elements = (uint16_t*)&data[0];
+    const int16_t *const scan_elements = (const int16_t*)&data[0];
     int64_t *const timestamp = (int64_t*)&data[16]; // either that or (int64_t*)&data[12]
 
+    int16_t accel[3], gyro[3];
+    imu_matrix_apply(dev_iio_get_accel_matrix(in_iio->iiodev), &scan_elements[0], accel);
+    imu_matrix_apply(dev_iio_get_anglvel_matrix(in_iio->iiodev), &scan_elements[3], gyro);
+
     messages[0].type = GAMEPAD_SET_ELEMENT;
     messages[0].data.gamepad_set.element = GAMEPAD_ACCELEROMETER;
-    messages[1].data.gamepad_set.status.accel.sample_timestamp_ns = *timestamp;
-    messages[0].data.gamepad_set.status.accel.x = scan_elements[0];
-    messages[0].data.gamepad_set.status.accel.y = (uint16_t)(-1) * scan_elements[2];
-    messages[0].data.gamepad_set.status.accel.z = scan_elements[1];
+    messages[0].data.gamepad_set.status.accel.sample_timestamp_ns = *timestamp;
+    messages[0].data.gamepad_set.status.accel.x = (uint16_t)accel[0];
+    messages[0].data.gamepad_set.status.accel.y = (uint16_t)accel[1];
+    messages[0].data.gamepad_set.status.accel.z = (uint16_t)accel[2];
 
     messages[1].type = GAMEPAD_SET_ELEMENT;
     messages[1].data.gamepad_set.element = GAMEPAD_GYROSCOPE;
     messages[1].data.gamepad_set.status.gyro.sample_timestamp_ns = *timestamp;
-    messages[1].data.gamepad_set.status.gyro.x = scan_elements[3];
-    messages[1].data.gamepad_set.status.gyro.y = (uint16_t)(-1) * scan_elements[5];
-    messages[1].data.gamepad_set.status.gyro.z = scan_elements[4];
+    messages[1].data.gamepad_set.status.gyro.x = (uint16_t)gyro[0];
+    messages[1].data.gamepad_set.status.gyro.y = (uint16_t)gyro[1];
+    messages[1].data.gamepad_set.status.gyro.z = (uint16_t)gyro[2];
 
     res = 2;
 
@@ -120,64 +152,110 @@ send_message_from_iio_err:
     return res;
 }
 
-static int fill_message_from_evdev(dev_in_ev_t *const in_evdev, evdev_collected_t *const out_coll) {
-    int res = 0;
+static void evdev_stats_print(const dev_in_evdev_stats_t *const stats) {
+    printf(
+        "evdev: %" PRIuFAST64 " frames mapped, %" PRIuFAST64 " split, %" PRIuFAST64 " kernel buffer overflows\n",
+        atomic_load_explicit(&stats->frames, memory_order_relaxed),
+        atomic_load_explicit(&stats->split_frames, memory_order_relaxed),
+        atomic_load_explicit(&stats->syn_dropped, memory_order_relaxed)
+    );
+}
 
-    struct input_event read_ev;
+/**
+ * Read the next frame of an evdev device into out_coll: returns 1 once a frame is complete, 0 when every
+ * queued event has been read (events of an incomplete frame are kept for the next call) or a negative errno.
+ *
+ * Frames longer than MAX_COLLECTED_EVDEV_EVENTS are returned in pieces. When the kernel buffer overflowed
+ * (SYN_DROPPED) the frame being read is discarded and libevdev replays what changed since, a release
+ * that got lost included.
+ */
+static int fill_message_from_evdev(dev_in_ev_t *const in_evdev, dev_in_evdev_stats_t *const stats, evdev_collected_t *const out_coll) {
+    for (;;) {
+        struct input_event read_ev;
+        const int read_res = libevdev_next_event(
+            in_evdev->evdev,
+            in_evdev->syncing ? LIBEVDEV_READ_FLAG_SYNC : LIBEVDEV_READ_FLAG_NORMAL,
+            &read_ev
+        );
 
-    // reset the events count
-    out_coll->ev_count = 0;
+        if (read_res == -EAGAIN) {
+            if (in_evdev->syncing) {
+                // the state has been replayed entirely: go on with events queued after the drop
+                in_evdev->syncing = false;
+                continue;
+            }
 
-    // if the device does not support syn reports read just one event and return
-    if (!in_evdev->has_syn_report) {
-        res = libevdev_next_event(in_evdev->evdev, LIBEVDEV_READ_FLAG_NORMAL, &read_ev);
-        if (res < 0) {
-            goto fill_message_from_evdev_err;
+            return 0;
+        } else if (read_res < 0) {
+            return read_res;
+        } else if ((read_res == LIBEVDEV_READ_STATUS_SYNC) && (!in_evdev->syncing)) {
+            // read_ev is the SYN_DROPPED itself: what was collected of the current frame is not reliable
+            in_evdev->syncing = true;
+            in_evdev->frame.ev_count = 0;
+
+            const uint_fast64_t dropped = atomic_fetch_add_explicit(&stats->syn_dropped, 1, memory_order_relaxed) + 1;
+            fprintf(stderr, "Events dropped by the kernel (%" PRIuFAST64 " times so far) -- resynchronizing the device\n", dropped);
+            continue;
         }
 
-        // just copy the input event
-        out_coll->ev[out_coll->ev_count++] = read_ev;
-        
-        goto fill_message_from_evdev_err_completed;
-    }
+        // without syn reports every event is a frame on its own
+        if (!in_evdev->has_syn_report) {
+            out_coll->ev[0] = read_ev;
+            out_coll->ev_count = 1;
+            out_coll->resync = false;
 
-    // the device does support syn reports so read every event until one is found
-    while (out_coll->ev_count < MAX_COLLECTED_EVDEV_EVENTS) {
-        res = libevdev_next_event(in_evdev->evdev, LIBEVDEV_READ_FLAG_BLOCKING, &read_ev);
-        if (res < 0) {
-            goto fill_message_from_evdev_err;
+            atomic_fetch_add_explicit(&stats->frames, 1, memory_order_relaxed);
+            return 1;
         }
 
-        // if the message is a syn_report exit the while as there are no more events
         if ((read_ev.type == EV_SYN) && (read_ev.code == SYN_REPORT)) {
-            break;
+            if (in_evdev->frame.ev_count == 0) {
+                continue;
+            }
+
+            *out_coll = in_evdev->frame;
+            in_evdev->frame.ev_count = 0;
+
+            atomic_fetch_add_explicit(&stats->frames, 1, memory_order_relaxed);
+            return 1;
         } else if ((in_evdev->ignore_msc_scan) && (read_ev.type == EV_MSC) && (read_ev.code == MSC_SCAN)) {
             continue;
         } else if ((in_evdev->ignore_timestamp) && (read_ev.type == EV_MSC) && (read_ev.code == MSC_TIMESTAMP)) {
             continue;
         }
 
-        // just copy the input event
-        out_coll->ev[out_coll->ev_count++] = read_ev;
-    }
+        in_evdev->frame.ev[in_evdev->frame.ev_count++] = read_ev;
 
-fill_message_from_evdev_err:
-fill_message_from_evdev_err_completed:
-    return res;
+        // too long to be mapped at once: hand over what is there and go on with the rest of the frame
+        if (in_evdev->frame.ev_count == MAX_COLLECTED_EVDEV_EVENTS) {
+            *out_coll = in_evdev->frame;
+            in_evdev->frame.ev_count = 0;
+
+            atomic_fetch_add_explicit(&stats->split_frames, 1, memory_order_relaxed);
+            return 1;
+        }
+    }
 }
 
 static int timer_open_device(
     const dev_in_settings_t *const in_settings,
     const timer_filters_t *const in_filters,
+    dev_timer_t *const timers,
     dev_in_timer_t *const out_dev
 ) {
-    int res = dev_timer_open(in_filters, &out_dev->timer);
-    if (res != 0) {
+    int res = dev_timer_add(timers, in_filters);
+    if (res < 0) {
         fprintf(stderr, "Unable to open the timer device: %d\n", res);
         goto timer_open_device_err;
     }
 
-    printf("Opened timer device: %s\n", in_filters->name);
+    out_dev->timers = timers;
+    out_dev->slot = res;
+    out_dev->id = in_filters->id;
+
+    printf("Opened timer device: %s (id %" PRIu32 ")\n", in_filters->name, in_filters->id);
+
+    res = 0;
 
 timer_open_device_err:
     return res;
@@ -207,14 +285,18 @@ iio_open_device_err:
 static int iio_open_device(
     const dev_in_settings_t *const in_settings,
     const iio_filters_t *const in_filters,
+    const iio_settings_t *const in_iio_settings,
     dev_in_iio_t *const out_dev
 ) {
-    int res = dev_iio_open(in_filters, &out_dev->iiodev);
+    int res = dev_iio_open(in_filters, iio_mount_matrix, &out_dev->iiodev);
     if (res != 0) {
         fprintf(stderr, "Unable to open the specified iio device: %d\n", res);
         goto iio_open_device_err;
     }
 
+    out_dev->sampling_freq_hz = in_iio_settings->sampling_freq_hz;
+    out_dev->sampling_rate_hz = 0;
+
     const char *const dev_name = dev_iio_get_name(out_dev->iiodev);
 
     printf(
@@ -241,6 +323,19 @@ static int evdev_open_device(
 
     out_dev->ignore_timestamp = true;
     out_dev->ignore_msc_scan = false;
+    out_dev->frame.ev_count = 0;
+    out_dev->frame.resync = false;
+    out_dev->syncing = false;
+
+    // events are read until none is left: libevdev buffers what it reads and select would not tell about that
+    const int evdev_fd = libevdev_get_fd(out_dev->evdev);
+    const int fd_flags = fcntl(evdev_fd, F_GETFL);
+    if ((fd_flags < 0) || (fcntl(evdev_fd, F_SETFL, fd_flags | O_NONBLOCK) < 0)) {
+        res = -errno;
+        fprintf(stderr, "Unable to make the ev device non-blocking: %d\n", res);
+        dev_evdev_close(out_dev->evdev);
+        goto evdev_open_device_err;
+    }
     out_dev->has_rumble_support = libevdev_has_event_type(out_dev->evdev, EV_FF) && libevdev_has_event_code(out_dev->evdev, EV_FF, FF_RUMBLE);
     out_dev->has_syn_report = libevdev_has_event_type(out_dev->evdev, EV_SYN) && libevdev_has_event_code(out_dev->evdev, EV_SYN, SYN_REPORT);
 
@@ -298,8 +393,8 @@ static void hidraw_close_device(dev_in_hidraw_t *const out_hidraw) {
     dev_hidraw_close(out_hidraw->hidrawdev);
 }
 
-static void timer_close_device(dev_in_timer_t *const out_hidraw) {
-    dev_timer_close(out_hidraw->timer);
+static void timer_close_device(dev_in_timer_t *const out_timer) {
+    dev_timer_remove(out_timer->timers, out_timer->slot);
 }
 
 static void handle_rumble_device(const dev_in_settings_t *const conf, dev_in_ev_t *const in_dev, const out_message_rumble_t *const in_rumble_msg) {
@@ -382,23 +477,29 @@ static void handle_timeout(
     const dev_in_settings_t *const conf,
     dev_in_t *const in_devs,
     size_t in_devs_count,
-    const char* name,
+    uint32_t timer_id,
     uint64_t expirations
 ) {
     for (size_t i = 0; i < in_devs_count; ++i) {
-        if (in_devs[i].type == DEV_IN_TYPE_EV) {
+        if (
+            (in_devs[i].type == DEV_IN_TYPE_EV) &&
+            (in_devs[i].dev.evdev.callbacks.timeout_callback != NULL) &&
+            (in_devs[i].dev.evdev.callbacks.timeout_timer_id == timer_id)
+        ) {
             in_devs[i].dev.evdev.callbacks.timeout_callback(
                 conf,
                 in_devs[i].dev.evdev.evdev,
-                name,
                 expirations,
                 in_devs[i].dev.evdev.user_data
             );
-        } else if (in_devs[i].type == DEV_IN_TYPE_HIDRAW) {
+        } else if (
+            (in_devs[i].type == DEV_IN_TYPE_HIDRAW) &&
+            (in_devs[i].dev.hidraw.callbacks.timeout_callback != NULL) &&
+            (in_devs[i].dev.hidraw.callbacks.timeout_timer_id == timer_id)
+        ) {
             in_devs[i].dev.hidraw.callbacks.timeout_callback(
                 conf,
                 dev_hidraw_get_fd(in_devs[i].dev.hidraw.hidrawdev),
-                name,
                 expirations,
                 in_devs[i].dev.hidraw.user_data
             );
@@ -406,18 +507,24 @@ static void handle_timeout(
     }
 }
 
-static int open_socket(struct sockaddr_un *serveraddr) {
+static int open_socket(struct sockaddr_un *serveraddr, int type) {
     int res = -ENODEV;
 
-    int sd = socket(AF_UNIX, SOCK_STREAM, 0);
+    int sd = socket(AF_UNIX, type | SOCK_CLOEXEC, 0);
     if (sd < 0)
     {
         res = sd;
         goto open_socket_err;
     }
 
+    if (type == SOCK_SEQPACKET) {
+        const int sndbuf = LATEST_LANE_SNDBUF;
+        setsockopt(sd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    }
+
     res = connect(sd, (struct sockaddr *)serveraddr, SUN_LEN(serveraddr));
     if (res < 0) {
+        close(sd);
         goto open_socket_err;
     }
 
@@ -427,6 +534,390 @@ open_socket_err:
     return res;
 }
 
+// joystick axes, in the order of in_gamepad_element_t starting from GAMEPAD_LEFT_JOYSTICK_X
+#define RESOLUTION_FILTER_AXES 4
+
+// full resolution of a joystick position
+#define RESOLUTION_FILTER_JOYSTICK_BITS 16
+
+/**
+ * Joystick positions are 16 bits but the emulated gamepad might keep less of them (8 for the DualSense and
+ * the DualShock): a position that would end up in the same report value is not worth a message.
+ *
+ * A position is only sent once it falls in another quantization step than the last one sent and is more
+ * than a quarter of a step away from it, so that a stick resting on a boundary does not flutter between two steps.
+ */
+typedef struct resolution_filter {
+    unsigned int shift; // low bits of a position the output discards: 0 until dev_out tells otherwise
+
+    bool sent_valid[RESOLUTION_FILTER_AXES];
+    int32_t sent[RESOLUTION_FILTER_AXES];
+
+    // newest position received, sent or not
+    bool last_valid[RESOLUTION_FILTER_AXES];
+    int32_t last[RESOLUTION_FILTER_AXES];
+} resolution_filter_t;
+
+/**
+ * Forget what has been sent and go back to full resolution: used when a new server is connected.
+ */
+static void resolution_filter_reset(resolution_filter_t *const filter) {
+    filter->shift = 0;
+
+    for (size_t i = 0; i < RESOLUTION_FILTER_AXES; ++i) {
+        filter->sent_valid[i] = false;
+        filter->last_valid[i] = false;
+    }
+}
+
+static bool resolution_filter_pass(resolution_filter_t *const filter, const in_message_t *const msg) {
+    if ((msg->type != GAMEPAD_SET_ELEMENT) ||
+        (msg->data.gamepad_set.element < GAMEPAD_LEFT_JOYSTICK_X) ||
+        (msg->data.gamepad_set.element > GAMEPAD_RIGHT_JOYSTICK_Y)) {
+        return true;
+    }
+
+    const size_t axis = (size_t)(msg->data.gamepad_set.element - GAMEPAD_LEFT_JOYSTICK_X);
+    const int32_t value = msg->data.gamepad_set.status.joystick_pos;
+
+    filter->last[axis] = value;
+    filter->last_valid[axis] = true;
+
+    if (filter->sent_valid[axis]) {
+        const int32_t sent = filter->sent[axis];
+
+        if (value == sent) {
+            return false;
+        }
+
+        if (filter->shift > 0) {
+            const int64_t step = (int64_t)1 << (int64_t)filter->shift;
+            const bool same_step = (((int64_t)value + 32768) >> filter->shift) == (((int64_t)sent + 32768) >> filter->shift);
+            if ((same_step) || (absolute_value((int64_t)value - (int64_t)sent) <= step / 4)) {
+                return false;
+            }
+        }
+    }
+
+    filter->sent[axis] = value;
+    filter->sent_valid[axis] = true;
+    return true;
+}
+
+/**
+ * Drop in place the messages that would not change what the emulated gamepad reports: returns how many are left.
+ */
+static int resolution_filter_apply(resolution_filter_t *const filter, in_message_t *const msgs, int count) {
+    int kept = 0;
+
+    for (int i = 0; i < count; ++i) {
+        if (resolution_filter_pass(filter, &msgs[i])) {
+            if (kept != i) {
+                msgs[kept] = msgs[i];
+            }
+
+            ++kept;
+        }
+    }
+
+    return kept;
+}
+
+/**
+ * Change the resolution the filter works at: positions held back by the previous one are written
+ * to out_msgs (RESOLUTION_FILTER_AXES at most) so that dev_out gets them; returns how many.
+ */
+static int resolution_filter_set(resolution_filter_t *const filter, unsigned int joystick_bits, in_message_t *const out_msgs) {
+    joystick_bits = (joystick_bits == 0) || (joystick_bits > RESOLUTION_FILTER_JOYSTICK_BITS) ? RESOLUTION_FILTER_JOYSTICK_BITS : joystick_bits;
+    filter->shift = RESOLUTION_FILTER_JOYSTICK_BITS - joystick_bits;
+
+    int count = 0;
+    for (size_t i = 0; i < RESOLUTION_FILTER_AXES; ++i) {
+        if ((!filter->last_valid[i]) || ((filter->sent_valid[i]) && (filter->sent[i] == filter->last[i]))) {
+            continue;
+        }
+
+        filter->sent[i] = filter->last[i];
+        filter->sent_valid[i] = true;
+
+        out_msgs[count].type = GAMEPAD_SET_ELEMENT;
+        out_msgs[count].data.gamepad_set.element = (in_gamepad_element_t)(GAMEPAD_LEFT_JOYSTICK_X + i);
+        out_msgs[count].data.gamepad_set.status.joystick_pos = filter->last[i];
+        ++count;
+    }
+
+    return count;
+}
+
+// every code whose state evdev_collect_state reports: keys first, then absolute axes
+#define EVDEV_STATE_CODES (KEY_CNT + ABS_CNT)
+
+/**
+ * Fill out_coll with up to max_events events describing the state of an evdev device, as if every key being
+ * held and every absolute axis had just been reported: starts from the code *inout_next and updates it,
+ * the whole state has been collected once it reaches EVDEV_STATE_CODES.
+ *
+ * libevdev state is the one of the last event read: events still queued in the kernel are read and sent
+ * afterwards as usual, so the server ends up with the current state either way.
+ */
+static void evdev_collect_state(dev_in_ev_t *const in_evdev, unsigned int *const inout_next, size_t max_events, evdev_collected_t *const out_coll) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    out_coll->ev_count = 0;
+    out_coll->resync = true;
+
+    for (; (*inout_next < EVDEV_STATE_CODES) && (out_coll->ev_count < max_events); ++(*inout_next)) {
+        const bool is_key = *inout_next < KEY_CNT;
+        const unsigned int type = is_key ? EV_KEY : EV_ABS;
+        const unsigned int code = is_key ? *inout_next : *inout_next - KEY_CNT;
+
+        // multitouch slots only make sense inside the frame that reported them
+        if ((!is_key) && (code >= ABS_MT_SLOT)) {
+            continue;
+        }
+
+        int value;
+        if (!libevdev_fetch_event_value(in_evdev->evdev, type, code, &value)) {
+            continue;
+        }
+
+        // the server starts from every key released
+        if ((is_key) && (value == 0)) {
+            continue;
+        }
+
+        struct input_event *const ev = &out_coll->ev[out_coll->ev_count++];
+        ev->time = now;
+        ev->type = (uint16_t)type;
+        ev->code = (uint16_t)code;
+        ev->value = value;
+    }
+}
+
+/**
+ * Send the whole input state on a freshly connected reliable lane: the server released everything
+ * the previous connection was holding when it went away.
+ */
+static int resync_server(dev_in_data_t *const dev_in_data, dev_in_t *const devices, size_t max_devices) {
+    int res = 0;
+
+    const int fd = dev_in_data->communication.endpoint.socket.fd;
+
+    for (size_t i = 0; i < max_devices; ++i) {
+        if (devices[i].type != DEV_IN_TYPE_EV) {
+            continue;
+        }
+
+        unsigned int next = 0;
+        while (next < EVDEV_STATE_CODES) {
+            // map functions write at most a message per event and keep the last slot free
+            evdev_collected_t coll;
+            evdev_collect_state(&devices[i].dev.evdev, &next, MAX_IN_MESSAGES - 1, &coll);
+            if (coll.ev_count == 0) {
+                continue;
+            }
+
+            in_message_t controller_msg[MAX_IN_MESSAGES];
+            const int controller_msg_count = devices[i].dev.evdev.callbacks.input_map_fn(
+                &dev_in_data->settings,
+                &coll,
+                &controller_msg[0],
+                sizeof(controller_msg) / sizeof(in_message_t),
+                devices[i].dev.evdev.user_data
+            );
+
+            for (int msg_idx = 0; msg_idx < controller_msg_count; ++msg_idx) {
+                const ssize_t write_res = write(fd, (void*)&controller_msg[msg_idx], sizeof(in_message_t));
+                if (write_res != sizeof(in_message_t)) {
+                    res = write_res < 0 ? -errno : -EIO;
+                    goto resync_server_err;
+                }
+            }
+        }
+    }
+
+resync_server_err:
+    return res;
+}
+
+/**
+ * Continuous samples waiting to be sent on the latest lane: only the newest value of each element is kept,
+ * mouse movements are relative and are summed instead.
+ */
+typedef struct latest_lane {
+    in_message_t slots[LATEST_LANE_SLOTS];
+    uint64_t pending; // bit i set: slots[i] has not been sent yet
+    bool blocked; // the socket was full on the last flush: wait for it to be writable
+} latest_lane_t;
+
+static int latest_lane_slot(const in_message_t *const msg) {
+    if (msg->type == GAMEPAD_SET_ELEMENT) {
+        switch (msg->data.gamepad_set.element) {
+            case GAMEPAD_LEFT_JOYSTICK_X:
+            case GAMEPAD_LEFT_JOYSTICK_Y:
+            case GAMEPAD_RIGHT_JOYSTICK_X:
+            case GAMEPAD_RIGHT_JOYSTICK_Y:
+            case GAMEPAD_BTN_L2_TRIGGER:
+            case GAMEPAD_BTN_R2_TRIGGER:
+            case GAMEPAD_GYROSCOPE:
+            case GAMEPAD_ACCELEROMETER:
+            case GAMEPAD_TOUCHPAD_X:
+            case GAMEPAD_TOUCHPAD_Y:
+                return (int)msg->data.gamepad_set.element;
+            default:
+                return -1;
+        }
+    } else if (msg->type == MOUSE_EVENT) {
+        if (msg->data.mouse_event.type == MOUSE_ELEMENT_X) {
+            return IN_GAMEPAD_ELEMENTS_COUNT;
+        } else if (msg->data.mouse_event.type == MOUSE_ELEMENT_Y) {
+            return IN_GAMEPAD_ELEMENTS_COUNT + 1;
+        }
+    }
+
+    return -1;
+}
+
+static void latest_lane_push(latest_lane_t *const lane, int slot, const in_message_t *const msg) {
+    const uint64_t bit = (uint64_t)1 << (uint64_t)slot;
+
+    if ((msg->type == MOUSE_EVENT) && (lane->pending & bit)) {
+        lane->slots[slot].data.mouse_event.value += msg->data.mouse_event.value;
+
+        // the summed delta is complete as of the newest event
+        if (msg->data.mouse_event.flags & EV_MESSAGE_FLAGS_PRESERVE_TIME) {
+            lane->slots[slot].data.mouse_event.flags |= EV_MESSAGE_FLAGS_PRESERVE_TIME;
+            lane->slots[slot].data.mouse_event.time = msg->data.mouse_event.time;
+        }
+    } else {
+        lane->slots[slot] = *msg;
+    }
+
+    lane->pending |= bit;
+}
+
+/**
+ * Copy every pending sample to out_msgs (LATEST_LANE_SLOTS long), in slot order: returns how many there are.
+ */
+static size_t latest_lane_collect(const latest_lane_t *const lane, in_message_t *const out_msgs) {
+    size_t count = 0;
+
+    for (uint64_t pending = lane->pending; pending != 0; pending &= pending - 1) {
+        out_msgs[count++] = lane->slots[__builtin_ctzll(pending)];
+    }
+
+    return count;
+}
+
+/**
+ * Send every pending sample as a single packet: returns 0 on success or when the socket is full
+ * (samples stay pending and keep being replaced), a negative errno if the lane is broken.
+ */
+static int latest_lane_flush(latest_lane_t *const lane, int fd) {
+    in_message_t packet[LATEST_LANE_SLOTS];
+    const size_t count = latest_lane_collect(lane, packet);
+
+    if (count == 0) {
+        return 0;
+    }
+
+    const ssize_t send_res = send(fd, (void*)packet, count * sizeof(in_message_t), MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (send_res < 0) {
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            lane->blocked = true;
+            return 0;
+        }
+
+        return -errno;
+    }
+
+    lane->pending = 0;
+    lane->blocked = false;
+    return 0;
+}
+
+/**
+ * Hand messages to dev_out with the ipc in use: continuous samples go through the latest lane when connected.
+ */
+static void send_messages(dev_in_data_t *const dev_in_data, latest_lane_t *const latest, const in_message_t *const msgs, int count) {
+    if (count <= 0) {
+        return;
+    }
+
+    if (dev_in_data->communication.type == ipc_client_socket) {
+        for (int msg_idx = 0; msg_idx < count; ++msg_idx) {
+            if (dev_in_data->communication.endpoint.socket.fd < 0) {
+                break;
+            }
+
+            const int slot = latest_lane_slot(&msgs[msg_idx]);
+            if ((slot >= 0) && (dev_in_data->communication.endpoint.socket.latest_fd >= 0)) {
+                latest_lane_push(latest, slot, &msgs[msg_idx]);
+                continue;
+            }
+
+            const int write_res = write(dev_in_data->communication.endpoint.socket.fd, (void*)&msgs[msg_idx], sizeof(in_message_t));
+            if (write_res < 0) {
+                fprintf(stderr, "Error in writing input event messages: %d -- connection will be drop and retried\n", write_res);
+
+                // in case of an error reschedule to socket for reconnection
+                close(dev_in_data->communication.endpoint.socket.fd);
+                dev_in_data->communication.endpoint.socket.fd = -1;
+            }
+        }
+    } else if (dev_in_data->communication.type == ipc_unix_pipe) {
+        for (int msg_idx = 0; msg_idx < count; ++msg_idx) {
+            const int write_res = write(dev_in_data->communication.endpoint.pipe.in_message_pipe_fd, (void*)&msgs[msg_idx], sizeof(in_message_t));
+            if (write_res < 0) {
+                fprintf(stderr, "Error in writing input event messages: %d\n", write_res);
+            }
+        }
+    } else if (dev_in_data->communication.type == ipc_shared_state) {
+        devices_status_shared_publish(
+            dev_in_data->communication.endpoint.shared.state,
+            &msgs[0],
+            (size_t)count
+        );
+    }
+}
+
+/**
+ * Set the iio device to the sampling frequency the emulated gamepad needs (the one it has been declared
+ * with while that is not known) and tell dev_out the one it is actually sampling at.
+ */
+static void iio_negotiate_sampling_rate(dev_in_data_t *const dev_in_data, latest_lane_t *const latest, dev_in_iio_t *const in_iio, uint32_t wanted_hz) {
+    if ((wanted_hz == 0) && (in_iio->sampling_freq_hz != NULL)) {
+        wanted_hz = (uint32_t)lround(strtod(in_iio->sampling_freq_hz, NULL));
+    }
+
+    uint32_t rate_hz = in_iio->sampling_rate_hz;
+    if ((rate_hz == 0) || (rate_hz < wanted_hz) || (rate_hz >= 2 * wanted_hz)) {
+        const int negotiate_res = dev_iio_negotiate_sampling_freq(in_iio->iiodev, wanted_hz, in_iio->sampling_freq_hz, &rate_hz);
+        if (negotiate_res != 0) {
+            fprintf(stderr, "Unable to negotiate the sampling frequency of iio device %s: %d\n", dev_iio_get_name(in_iio->iiodev), negotiate_res);
+        } else if (rate_hz != in_iio->sampling_rate_hz) {
+            printf("iio device %s samples at %" PRIu32 " Hz (%" PRIu32 " Hz wanted)\n", dev_iio_get_name(in_iio->iiodev), rate_hz, wanted_hz);
+        }
+
+        in_iio->sampling_rate_hz = rate_hz;
+    }
+
+    const in_message_t msg = {
+        .type = GAMEPAD_SET_ELEMENT,
+        .data = {
+            .gamepad_set = {
+                .element = GAMEPAD_IMU_SAMPLING_RATE,
+                .status = {
+                    .sampling_rate_hz = in_iio->sampling_rate_hz,
+                }
+            }
+        }
+    };
+
+    send_messages(dev_in_data, latest, &msg, 1);
+}
+
 void* dev_in_thread_func(void *ptr) {
     dev_in_data_t *const dev_in_data = (dev_in_data_t*)ptr;
 
@@ -437,12 +928,39 @@ void* dev_in_thread_func(void *ptr) {
     }
 
     fd_set read_fds;
-    
+    fd_set write_fds;
+
+    latest_lane_t latest = {
+        .pending = 0,
+        .blocked = false,
+    };
+
+    useconds_t reconnect_backoff_us = RECONNECT_BACKOFF_MIN_US;
+
+    resolution_filter_t resolution;
+    resolution_filter_reset(&resolution);
+
+    // IMU sampling frequency the emulated gamepad needs: 0 until dev_out tells it
+    uint32_t imu_sampling_rate_wanted_hz = 0;
+
+    imu_filter_t imu_filter;
+    const int imu_filter_res = imu_filter_init(&imu_filter, &dev_in_data->settings);
+    if (imu_filter_res != 0) {
+        fprintf(stderr, "Invalid IMU filter settings: %d -- IMU samples will not be filtered\n", imu_filter_res);
+    }
+
+    dev_timer_t timers;
+    const int timers_init_res = dev_timer_init(&timers);
+    if (timers_init_res != 0) {
+        fprintf(stderr, "Unable to create the timer: %d -- timer devices won't be available\n", timers_init_res);
+    }
+
     const size_t max_devices = dev_in_data->input_dev_decl->dev_count;
 
     dev_in_t* const devices = malloc(sizeof(dev_in_t) * max_devices);
     if (devices == NULL) {
         fprintf(stderr, "Unable to allocate memory to hold devices -- aborting input thread\n");
+        dev_timer_close(&timers);
         return NULL;
     }
 
@@ -458,23 +976,61 @@ void* dev_in_thread_func(void *ptr) {
         }
 
         FD_ZERO(&read_fds);
+        FD_ZERO(&write_fds);
 
         if (dev_in_data->communication.type == ipc_unix_pipe) {
             FD_SET(dev_in_data->communication.endpoint.pipe.out_message_pipe_fd, &read_fds);
+        } else if (dev_in_data->communication.type == ipc_shared_state) {
+            FD_SET(dev_in_data->communication.endpoint.shared.out_message_pipe_fd, &read_fds);
         } else if (dev_in_data->communication.type == ipc_client_socket) {
             // only reconnect if the fd is invalid
             if (dev_in_data->communication.endpoint.socket.fd < 0) {
-                dev_in_data->communication.endpoint.socket.fd = open_socket(&dev_in_data->communication.endpoint.socket.serveraddr);
+                dev_in_data->communication.endpoint.socket.fd = open_socket(&dev_in_data->communication.endpoint.socket.serveraddr, SOCK_STREAM);
 
                 // do not do a thing! that will consume messages and they won't be available anymore!
                 if (dev_in_data->communication.endpoint.socket.fd < 0) {
-                    fprintf(stderr, "Unable to connect to server: %d -- will retry connection\n", dev_in_data->communication.endpoint.socket.fd);
-                    usleep(500000);
+                    if (reconnect_backoff_us == RECONNECT_BACKOFF_MIN_US) {
+                        fprintf(stderr, "Unable to connect to server: %d -- will retry connection\n", dev_in_data->communication.endpoint.socket.fd);
+                    }
+
+                    usleep(reconnect_backoff_us);
+                    reconnect_backoff_us = (reconnect_backoff_us * 2 > RECONNECT_BACKOFF_MAX_US) ? RECONNECT_BACKOFF_MAX_US : reconnect_backoff_us * 2;
+                    continue;
+                }
+
+                reconnect_backoff_us = RECONNECT_BACKOFF_MIN_US;
+
+                // the latest lane is optional: without it continuous samples go on the reliable lane
+                if (dev_in_data->communication.endpoint.socket.latest_fd >= 0) {
+                    close(dev_in_data->communication.endpoint.socket.latest_fd);
+                }
+
+                dev_in_data->communication.endpoint.socket.latest_fd = open_socket(&dev_in_data->communication.endpoint.socket.latest_serveraddr, SOCK_SEQPACKET);
+                if (dev_in_data->communication.endpoint.socket.latest_fd < 0) {
+                    fprintf(stderr, "Unable to connect the latest lane: %d -- every message will be sent on the reliable lane\n", dev_in_data->communication.endpoint.socket.latest_fd);
+                }
+
+                latest.pending = 0;
+                latest.blocked = false;
+
+                // the new server tells its resolution right away, until then everything is sent
+                resolution_filter_reset(&resolution);
+
+                const int resync_res = resync_server(dev_in_data, devices, max_devices);
+                if (resync_res != 0) {
+                    fprintf(stderr, "Unable to send the current state to the server: %d -- connection will be dropped and retried\n", resync_res);
+
+                    close(dev_in_data->communication.endpoint.socket.fd);
+                    dev_in_data->communication.endpoint.socket.fd = -1;
                     continue;
                 }
             }
 
             FD_SET(dev_in_data->communication.endpoint.socket.fd, &read_fds);
+
+            if ((dev_in_data->communication.endpoint.socket.latest_fd >= 0) && (latest.blocked)) {
+                FD_SET(dev_in_data->communication.endpoint.socket.latest_fd, &write_fds);
+            }
         }
 
         for (size_t i = 0; i < max_devices; ++i) {
@@ -486,7 +1042,7 @@ void* dev_in_thread_func(void *ptr) {
             } else if (devices[i].type == DEV_IN_TYPE_HIDRAW) {
                 FD_SET(dev_hidraw_get_fd(devices[i].dev.hidraw.hidrawdev), &read_fds);
             } else if (devices[i].type == DEV_IN_TYPE_TIMER) {
-                FD_SET(dev_timer_get_fd(devices[i].dev.timer.timer), &read_fds);
+                // every timer is behind the same fd: queried once, below
             } else if (devices[i].type == DEV_IN_TYPE_NONE) {
                 const input_dev_type_t d_type = dev_in_data->input_dev_decl->dev[i]->dev_type;
                 if (d_type == input_dev_type_uinput) {
@@ -512,12 +1068,15 @@ void* dev_in_thread_func(void *ptr) {
                     const int open_res = iio_open_device(
                         &dev_in_data->settings,
                         &dev_in_data->input_dev_decl->dev[i]->filters.iio,
+                        &dev_in_data->input_dev_decl->dev[i]->map.iio_settings,
                         &devices[i].dev.iio
                     );
 
                     if (open_res == 0) {
                         devices[i].type = DEV_IN_TYPE_IIO;
 
+                        iio_negotiate_sampling_rate(dev_in_data, &latest, &devices[i].dev.iio, imu_sampling_rate_wanted_hz);
+
                         // device is now connected, query it in select
                         FD_SET(dev_iio_get_buffer_fd(devices[i].dev.iio.iiodev), &read_fds);
                     }
@@ -544,6 +1103,7 @@ void* dev_in_thread_func(void *ptr) {
                     const int open_res = timer_open_device(
                         &dev_in_data->settings,
                         &dev_in_data->input_dev_decl->dev[i]->filters.timer,
+                        &timers,
                         &devices[i].dev.timer
                     );
 
@@ -552,35 +1112,45 @@ void* dev_in_thread_func(void *ptr) {
                         devices[i].dev.timer.user_data = dev_in_data->input_dev_decl->dev[i]->user_data;
                         devices[i].dev.timer.name = dev_in_data->input_dev_decl->dev[i]->filters.timer.name;
                         devices[i].type = DEV_IN_TYPE_TIMER;
-
-                        // device is now connected, query it in select
-                        FD_SET(dev_timer_get_fd(devices[i].dev.timer.timer), &read_fds);
                     }
                 }
             }
         }
 
+        if (dev_timer_get_fd(&timers) >= 0) {
+            FD_SET(dev_timer_get_fd(&timers), &read_fds);
+        }
+
         struct timeval timeout = {
             .tv_sec = (__time_t)dev_in_data->timeout_ms / (__time_t)1000,
-            .tv_usec = ((__suseconds_t)dev_in_data->timeout_ms % (__suseconds_t)1000) * (__suseconds_t)1000000,
+            .tv_usec = ((__suseconds_t)dev_in_data->timeout_ms % (__suseconds_t)1000) * (__suseconds_t)1000,
         };
 
-        int ready_fds = select(FD_SETSIZE, &read_fds, NULL, NULL, &timeout);
+        int ready_fds = select(FD_SETSIZE, &read_fds, &write_fds, NULL, &timeout);
 
         if (ready_fds == -1) {
             const int err = errno;
             fprintf(stderr, "Error reading devices: %d\n", err);
             continue;
         } else if (ready_fds == 0) {
-            // Timeout... simply retry
-            printf("TIMEOUT\n");
+            // Timeout... simply retry: this is normal when no timer is running and no input is received
             continue;
         }
 
+        // account expirations of every timer at once: each timer device then takes its own
+        if ((dev_timer_get_fd(&timers) >= 0) && (FD_ISSET(dev_timer_get_fd(&timers), &read_fds))) {
+            const int expire_res = dev_timer_expire(&timers);
+            if (expire_res != 0) {
+                fprintf(stderr, "Error in reading expirations of timers: %d\n", expire_res);
+            }
+        }
+
         // check for messages incoming like set leds or activate rumble
         int out_message_fd = -1;
         if (dev_in_data->communication.type == ipc_unix_pipe) {
             out_message_fd = dev_in_data->communication.endpoint.pipe.out_message_pipe_fd;
+        } else if (dev_in_data->communication.type == ipc_shared_state) {
+            out_message_fd = dev_in_data->communication.endpoint.shared.out_message_pipe_fd;
         } else if (dev_in_data->communication.type == ipc_client_socket) {
             out_message_fd = dev_in_data->communication.endpoint.socket.fd;
         }
@@ -603,6 +1173,19 @@ void* dev_in_thread_func(void *ptr) {
                     }
 
                     handle_leds(&dev_in_data->settings, devices, max_devices, &out_msg.data.leds);
+                } else if (out_msg.type == OUT_MSG_TYPE_RESOLUTION) {
+                    in_message_t held_back[RESOLUTION_FILTER_AXES];
+                    const int held_back_count = resolution_filter_set(&resolution, out_msg.data.resolution.joystick_bits, &held_back[0]);
+
+                    send_messages(dev_in_data, &latest, &held_back[0], held_back_count);
+
+                    // this is also how a new server learns the sampling frequency: it is told again even if unchanged
+                    imu_sampling_rate_wanted_hz = out_msg.data.resolution.imu_sampling_rate_hz;
+                    for (size_t i = 0; i < max_devices; ++i) {
+                        if (devices[i].type == DEV_IN_TYPE_IIO) {
+                            iio_negotiate_sampling_rate(dev_in_data, &latest, &devices[i].dev.iio, imu_sampling_rate_wanted_hz);
+                        }
+                    }
                 }
             } else {
                 fprintf(stderr, "Error reading from out_message_pipe_fd: got %zu bytes, expected %zu bytes\n", out_message_pipe_read_res, sizeof(out_message_t));
@@ -625,7 +1208,7 @@ void* dev_in_thread_func(void *ptr) {
             } else if (devices[i].type == DEV_IN_TYPE_HIDRAW) {
                 fd = dev_hidraw_get_fd(devices[i].dev.hidraw.hidrawdev);
             } else if (devices[i].type == DEV_IN_TYPE_TIMER) {
-                fd = dev_timer_get_fd(devices[i].dev.timer.timer);
+                fd = dev_timer_get_fd(devices[i].dev.timer.timers);
             } else {
                 continue;
             }
@@ -640,25 +1223,36 @@ void* dev_in_thread_func(void *ptr) {
 
             // the following part fills controller_msg and writes in controller_msg_count an error or the number of messages to be sent to the output device
             if (devices[i].type == DEV_IN_TYPE_EV) {
-                evdev_collected_t coll = {
-                    .ev_count = 0
-                };
+                // every queued frame is mapped and sent now, in order
+                evdev_collected_t coll;
+                int fill_res;
+                while ((fill_res = fill_message_from_evdev(&devices[i].dev.evdev, &dev_in_data->evdev_stats, &coll)) > 0) {
+                    controller_msg_count = devices[i].dev.evdev.callbacks.input_map_fn(
+                        &dev_in_data->settings,
+                        &coll,
+                        &controller_msg[0],
+                        controller_msg_avail,
+                        devices[i].dev.evdev.user_data
+                    );
+
+                    if (controller_msg_count <= 0) {
+                        continue;
+                    }
+
+                    imu_filter_apply(&imu_filter, &controller_msg[0], controller_msg_count);
+
+                    controller_msg_count = resolution_filter_apply(&resolution, &controller_msg[0], controller_msg_count);
 
-                controller_msg_count = fill_message_from_evdev(&devices[i].dev.evdev, &coll);
-                if (controller_msg_count != 0) {
-                    fprintf(stderr, "Unable to fill input_event(s) for device %zd: %d -- Will reconnect the device\n", i, controller_msg_count);
+                    send_messages(dev_in_data, &latest, &controller_msg[0], controller_msg_count);
+                }
+
+                if (fill_res < 0) {
+                    fprintf(stderr, "Unable to fill input_event(s) for device %zd: %d -- Will reconnect the device\n", i, fill_res);
                     evdev_close_device(&devices[i].dev.evdev);
                     devices[i].type = DEV_IN_TYPE_NONE;
-                    continue;
                 }
 
-                controller_msg_count = devices[i].dev.evdev.callbacks.input_map_fn(
-                    &dev_in_data->settings,
-                    &coll,
-                    &controller_msg[0],
-                    controller_msg_avail,
-                    devices[i].dev.evdev.user_data
-                );
+                continue;
             } else if (devices[i].type == DEV_IN_TYPE_IIO) {
                 controller_msg_count = map_message_from_iio(
                     &devices[i].dev.iio,
@@ -688,18 +1282,14 @@ void* dev_in_thread_func(void *ptr) {
                     continue;
                 }
             } else if (devices[i].type == DEV_IN_TYPE_TIMER) {
-                uint64_t expirations;
-                ssize_t num_read = read(fd, &expirations, sizeof(uint64_t));
-                if (num_read != sizeof(uint64_t)) {
-                    fprintf(stderr, "Error in reading expirations from timer device %zd: %d -- Will reconnect to the device\n", i, controller_msg_count);
-                    timer_close_device(&devices[i].dev.timer);
-                    devices[i].type = DEV_IN_TYPE_NONE;
+                // the fd being readable means some timer expired, not necessarily this one
+                const uint64_t expirations = dev_timer_take(devices[i].dev.timer.timers, devices[i].dev.timer.slot);
+                if (expirations == 0) {
                     continue;
                 }
 
                 controller_msg_count = devices[i].dev.timer.callbacks.map_fn(
                     &dev_in_data->settings,
-                    fd,
                     expirations,
                     &controller_msg[0],
                     controller_msg_avail,
@@ -717,7 +1307,7 @@ void* dev_in_thread_func(void *ptr) {
                     &dev_in_data->settings,
                     devices,
                     max_devices,
-                    devices[i].dev.timer.name,
+                    devices[i].dev.timer.id,
                     expirations
                 );
             }
@@ -727,45 +1317,81 @@ void* dev_in_thread_func(void *ptr) {
                 continue;
             }
 
-            if (dev_in_data->communication.type == ipc_client_socket) {
-                for (int msg_idx = 0; msg_idx < controller_msg_count; ++msg_idx) {
-                    const int write_res = write(dev_in_data->communication.endpoint.socket.fd, (void*)&controller_msg[msg_idx], sizeof(in_message_t));
-                    if (write_res < 0) {
-                        fprintf(stderr, "Error in writing input event messages: %d -- connection will be drop and retried\n", write_res);
+            imu_filter_apply(&imu_filter, &controller_msg[0], controller_msg_count);
 
-                        // in case of an error reschedule to socket for reconnection
-                        close(dev_in_data->communication.endpoint.socket.fd);
-                        dev_in_data->communication.endpoint.socket.fd = -1;
-                    }
-                }
-            } else if (dev_in_data->communication.type == ipc_unix_pipe) {
-                for (int msg_idx = 0; msg_idx < controller_msg_count; ++msg_idx) {
-                    const int write_res = write(dev_in_data->communication.endpoint.pipe.in_message_pipe_fd, (void*)&controller_msg[msg_idx], sizeof(in_message_t));
-                    if (write_res < 0) {
-                        fprintf(stderr, "Error in writing input event messages: %d\n", write_res);
-                    }
+            controller_msg_count = resolution_filter_apply(&resolution, &controller_msg[0], controller_msg_count);
+
+            send_messages(dev_in_data, &latest, &controller_msg[0], controller_msg_count);
+        }
+
+        // everything read in this iteration has been collected: send the newest samples in a single packet
+        if ((dev_in_data->communication.type == ipc_client_socket) && (dev_in_data->communication.endpoint.socket.latest_fd >= 0)) {
+            if ((latest.blocked) && (FD_ISSET(dev_in_data->communication.endpoint.socket.latest_fd, &write_fds))) {
+                latest.blocked = false;
+            }
+
+            if ((latest.pending != 0) && (!latest.blocked)) {
+                const int flush_res = latest_lane_flush(&latest, dev_in_data->communication.endpoint.socket.latest_fd);
+                if (flush_res < 0) {
+                    fprintf(stderr, "Error in writing on the latest lane: %d -- it will be reconnected with the reliable one\n", flush_res);
+
+                    close(dev_in_data->communication.endpoint.socket.latest_fd);
+                    dev_in_data->communication.endpoint.socket.latest_fd = -1;
+
+                    // the newest values are not sent again until they change: a released stick would stay deflected
+                    in_message_t pending_msgs[LATEST_LANE_SLOTS];
+                    const size_t pending_count = latest_lane_collect(&latest, pending_msgs);
+                    latest.pending = 0;
+                    latest.blocked = false;
+
+                    send_messages(dev_in_data, &latest, pending_msgs, (int)pending_count);
                 }
             }
         }
+
+        // stop timers that have nothing left to do and restart those that got something to do
+        for (size_t i = 0; i < max_devices; ++i) {
+            if ((devices[i].type != DEV_IN_TYPE_TIMER) || (devices[i].dev.timer.callbacks.busy_fn == NULL)) {
+                continue;
+            }
+
+            const bool busy = devices[i].dev.timer.callbacks.busy_fn(&dev_in_data->settings, devices[i].dev.timer.user_data);
+            const bool running = dev_timer_is_running(devices[i].dev.timer.timers, devices[i].dev.timer.slot);
+            if (busy == running) {
+                continue;
+            }
+
+            const int switch_res = busy ?
+                dev_timer_start(devices[i].dev.timer.timers, devices[i].dev.timer.slot) :
+                dev_timer_stop(devices[i].dev.timer.timers, devices[i].dev.timer.slot);
+            if (switch_res != 0) {
+                fprintf(stderr, "Unable to %s timer device %zd: %d\n", busy ? "start" : "stop", i, switch_res);
+            }
+        }
     }
 
     // end communication
     if (dev_in_data->communication.type == ipc_server_sockets) {
         // close every client socket
-        if (pthread_mutex_lock(&dev_in_data->communication.endpoint.ssocket.mutex) == 0) {
-            for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
-                close(dev_in_data->communication.endpoint.ssocket.clients[i]);
-                dev_in_data->communication.endpoint.ssocket.clients[i] = -1;
+        for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
+            const int fd = atomic_exchange(&dev_in_data->communication.endpoint.ssocket.clients[i], -1);
+            if (fd >= 0) {
+                close(fd);
             }
-
-            pthread_mutex_unlock(&dev_in_data->communication.endpoint.ssocket.mutex);
         }
     } else if (dev_in_data->communication.type == ipc_unix_pipe) {
         close(dev_in_data->communication.endpoint.pipe.in_message_pipe_fd);
         close(dev_in_data->communication.endpoint.pipe.out_message_pipe_fd);
+    } else if (dev_in_data->communication.type == ipc_shared_state) {
+        close(dev_in_data->communication.endpoint.shared.out_message_pipe_fd);
     } else if (dev_in_data->communication.type == ipc_client_socket) {
         close(dev_in_data->communication.endpoint.socket.fd);
         dev_in_data->communication.endpoint.socket.fd = -1;
+
+        if (dev_in_data->communication.endpoint.socket.latest_fd >= 0) {
+            close(dev_in_data->communication.endpoint.socket.latest_fd);
+            dev_in_data->communication.endpoint.socket.latest_fd = -1;
+        }
     }
 
     // close every opened device
@@ -787,6 +1413,10 @@ void* dev_in_thread_func(void *ptr) {
 
     free(devices);
 
+    dev_timer_close(&timers);
+
+    evdev_stats_print(&dev_in_data->evdev_stats);
+
     if (platform_init_res != 0) {
         dev_in_data->input_dev_decl->deinit_fn(&dev_in_data->settings, &platform_data);
     }
@@ -9,6 +9,21 @@
 
 #define DEV_IN_FLAG_EXIT 0x00000001U
 
+/**
+ * Counters of the evdev input path: written by the input thread, can be read from any thread.
+ * The input thread prints them when it exits.
+ */
+typedef struct dev_in_evdev_stats {
+    // frames read and mapped
+    atomic_uint_fast64_t frames;
+
+    // the kernel buffer of a device overflowed (SYN_DROPPED): libevdev resynchronized the state
+    atomic_uint_fast64_t syn_dropped;
+
+    // frames with more than MAX_COLLECTED_EVDEV_EVENTS events: mapped in more than one go
+    atomic_uint_fast64_t split_frames;
+} dev_in_evdev_stats_t;
+
 typedef struct dev_in_data {
     size_t max_messages_in_flight;
 
@@ -24,6 +39,8 @@ typedef struct dev_in_data {
 
     volatile uint32_t flags;
 
+    dev_in_evdev_stats_t evdev_stats;
+
 } dev_in_data_t;
 
 void *dev_in_thread_func(void *ptr);
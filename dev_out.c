@@ -1,390 +1,478 @@
 #include "dev_out.h"
 
 #include "devices_status.h"
+#include "gamepad_response.h"
+#include "gamepad_sequence.h"
+#include "gyro_mouse.h"
 #include "ipc.h"
 #include "message.h"
+#include "motion_predictor.h"
 #include "virt_ds4.h"
 #include "virt_ds5.h"
+#include "virt_xbox.h"
+#include "virt_deck.h"
 #include "virt_mouse.h"
 #include "virt_kbd.h"
 
-static void handle_incoming_message_gamepad_action(
-    const dev_out_settings_t *const in_settings,
-    const in_message_gamepad_action_t *const msg_payload,
-    gamepad_status_t *const inout_gamepad
-) {
-    if (*msg_payload == GAMEPAD_ACTION_PRESS_AND_RELEASE_CENTER) {
-        inout_gamepad->flags |= GAMEPAD_STATUS_FLAGS_PRESS_AND_REALEASE_CENTER;
-    } else if (*msg_payload == GAMEPAD_ACTION_OPEN_STEAM_QAM) {
-        inout_gamepad->flags |= GAMEPAD_STATUS_FLAGS_OPEN_STEAM_QAM;
-    } 
-}
-
-static void handle_incoming_message_mouse_event(
-    const dev_out_settings_t *const in_settings,
-    const in_message_mouse_event_t *const msg_payload,
-    mouse_status_t *const inout_mouse
-) {
-    if (msg_payload->type == MOUSE_ELEMENT_X) {
-        inout_mouse->x += msg_payload->value;
-    } else if (msg_payload->type == MOUSE_ELEMENT_Y) {
-        inout_mouse->y += msg_payload->value;
-    } else if (msg_payload->type == MOUSE_BTN_LEFT) {
-        inout_mouse->btn_left = msg_payload->value;
-    } else if (msg_payload->type == MOUSE_BTN_MIDDLE) {
-        inout_mouse->btn_middle = msg_payload->value;
-    } else if (msg_payload->type == MOUSE_BTN_RIGHT) {
-        inout_mouse->btn_right = msg_payload->value;
+#include <sys/eventfd.h>
+
+typedef union virt_gamepad {
+    virt_dualshock_t ds4;
+    virt_dualsense_t ds5;
+    virt_xbox_t xbox;
+    virt_deck_t deck;
+} virt_gamepad_t;
+
+/**
+ * A new emulated gamepad is created by a background thread while the current one keeps sending reports:
+ * dev_out is woken up by done_fd and flips to the new device before destroying the old one.
+ */
+typedef struct gamepad_switch {
+    pthread_t thread;
+    int done_fd;
+    bool in_progress;
+
+    const dev_out_settings_t *settings;
+    const gamepad_response_t *response;
+    dev_out_gamepad_device_t target;
+    virt_gamepad_t *slot;
+    int result_fd;
+} gamepad_switch_t;
+
+// messages read from the reliable lane of a client with a single recv
+#define CLIENT_RX_MESSAGES 32
+
+// messages (or latest lane packets) applied from a single client per iteration: a busy client
+// can neither starve the other ones nor delay the reports, what is left is read on the next one
+#define CLIENT_DRAIN_BUDGET 128
+
+/**
+ * Bytes received on the reliable lane of a client that do not make a whole message yet.
+ */
+typedef struct client_rx {
+    int fd; // a slot taken over by a new client starts empty
+    size_t len;
+    in_message_t buf[CLIENT_RX_MESSAGES];
+} client_rx_t;
+
+/**
+ * Apply the messages queued on the reliable lane of a client, in order and up to CLIENT_DRAIN_BUDGET:
+ * returns 0 once the socket is empty or the budget is spent, a negative errno if the client has to be dropped.
+ */
+static int drain_reliable_lane(client_rx_t *const rx, int fd, const dev_out_settings_t *const in_settings, devices_status_t *const dev_stats) {
+    if (rx->fd != fd) {
+        rx->fd = fd;
+        rx->len = 0;
     }
-}
 
-static void handle_incoming_message_gamepad_set(
-    const dev_out_settings_t *const in_settings,
-    const in_message_gamepad_set_element_t *const msg_payload,
-    gamepad_status_t *const inout_gamepad
-) {
-    switch (msg_payload->element) {
-        case GAMEPAD_BTN_CROSS: {
-            if (!in_settings->nintendo_layout) {
-                inout_gamepad->cross = msg_payload->status.btn;
-            } else {
-                inout_gamepad->circle = msg_payload->status.btn;
+    uint8_t *const buf = (uint8_t*)rx->buf;
+
+    for (size_t applied = 0; applied < CLIENT_DRAIN_BUDGET;) {
+        const size_t avail = sizeof(rx->buf) - rx->len;
+        const ssize_t read_res = recv(fd, (void*)(buf + rx->len), avail, MSG_DONTWAIT);
+        if (read_res == 0) {
+            return -ECONNRESET;
+        } else if (read_res < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                return 0;
+            } else if (errno != EINTR) {
+                return -errno;
             }
-            
-            break;
+
+            continue;
         }
-        case GAMEPAD_BTN_CIRCLE: {
-            if (in_settings->nintendo_layout) {
-                inout_gamepad->cross = msg_payload->status.btn;
-            } else {
-                inout_gamepad->circle = msg_payload->status.btn;
-            }
 
-            break;
+        rx->len += (size_t)read_res;
+
+        const size_t count = rx->len / sizeof(in_message_t);
+        for (size_t i = 0; i < count; ++i) {
+            devices_status_apply_message(in_settings, &rx->buf[i], dev_stats);
         }
-        case GAMEPAD_BTN_SQUARE: {
-            if (in_settings->nintendo_layout) {
-                inout_gamepad->triangle = msg_payload->status.btn;
-            } else {
-                inout_gamepad->square = msg_payload->status.btn;
-            }
-            
-            break;
+
+        // keep the beginning of a message split across two reads
+        rx->len -= count * sizeof(in_message_t);
+        memmove(buf, buf + count * sizeof(in_message_t), rx->len);
+
+        applied += count;
+
+        // a stream socket fills the buffer whenever it can: a short read means it is empty now
+        if ((size_t)read_res < avail) {
+            return 0;
         }
-        case GAMEPAD_BTN_TRIANGLE: {
-            if (!in_settings->nintendo_layout) {
-                inout_gamepad->triangle = msg_payload->status.btn;
-            } else {
-                inout_gamepad->square = msg_payload->status.btn;
+    }
+
+    return 0;
+}
+
+/**
+ * Apply the packets queued on the latest lane of a client, up to CLIENT_DRAIN_BUDGET: each one holds
+ * the newest value of some elements, so a backlog is applied in a single pass and only the last values survive.
+ */
+static int drain_latest_lane(int fd, const dev_out_settings_t *const in_settings, devices_status_t *const dev_stats) {
+    in_message_t packet[LATEST_LANE_SLOTS];
+
+    for (size_t packets = 0; packets < CLIENT_DRAIN_BUDGET;) {
+        const ssize_t read_res = recv(fd, (void*)packet, sizeof(packet), MSG_DONTWAIT);
+        if (read_res == 0) {
+            return -ECONNRESET;
+        } else if (read_res < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                return 0;
+            } else if (errno != EINTR) {
+                return -errno;
+            }
+        } else if ((read_res % sizeof(in_message_t)) != 0) {
+            fprintf(stderr, "Malformed packet on the latest lane: %zd bytes\n", read_res);
+            return -EIO;
+        } else {
+            for (size_t i = 0; i < (size_t)read_res / sizeof(in_message_t); ++i) {
+                devices_status_apply_message(in_settings, &packet[i], dev_stats);
             }
 
-            break;
-        }
-        case GAMEPAD_BTN_OPTION: {
-            inout_gamepad->option = msg_payload->status.btn;
-            break;
-        }
-        case GAMEPAD_BTN_SHARE: {
-            inout_gamepad->share = msg_payload->status.btn;
-            break;
-        }
-        case GAMEPAD_BTN_L1: {
-            inout_gamepad->l1 = msg_payload->status.btn;
-            break;
-        }
-        case GAMEPAD_BTN_R1: {
-            inout_gamepad->r1 = msg_payload->status.btn;
-            break;
+            ++packets;
         }
-        case GAMEPAD_BTN_L2_TRIGGER: {
-            inout_gamepad->l2_trigger = msg_payload->status.btn;
-            break;
-        }
-        case GAMEPAD_BTN_R2_TRIGGER: {
-            inout_gamepad->r2_trigger = msg_payload->status.btn;
-            break;
-        }
-        case GAMEPAD_BTN_L3: {
-            inout_gamepad->l3 = msg_payload->status.btn;
-            break;
-        }
-        case GAMEPAD_BTN_R3: {
-            inout_gamepad->r3 = msg_payload->status.btn;
-            break;
-        }
-        case GAMEPAD_BTN_L4: {
-            inout_gamepad->l4 = msg_payload->status.btn;
-            break;
-        }
-        case GAMEPAD_BTN_R4: {
-            inout_gamepad->r4 = msg_payload->status.btn;
-            break;
-        }
-        case GAMEPAD_BTN_L5: {
-            inout_gamepad->l5 = msg_payload->status.btn;
-            break;
-        }
-        case GAMEPAD_BTN_R5: {
-            inout_gamepad->r5 = msg_payload->status.btn;
-            break;
-        }
-        case GAMEPAD_BTN_TOUCHPAD: {
-            inout_gamepad->touchpad_press = msg_payload->status.btn;
-            break;
-        }
-        case GAMEPAD_BTN_JOIN_LEFT_ANALOG_AND_GYROSCOPE: {
-            inout_gamepad->join_left_analog_and_gyroscope = msg_payload->status.btn;
-            break;
-        }
-        case GAMEPAD_BTN_JOIN_RIGHT_ANALOG_AND_GYROSCOPE: {
-            inout_gamepad->join_right_analog_and_gyroscope = msg_payload->status.btn;
-            break;
-        }
-        case GAMEPAD_LEFT_JOYSTICK_X: {
-            inout_gamepad->joystick_positions[0][0] = msg_payload->status.joystick_pos;
-            break;
-        }
-        case GAMEPAD_LEFT_JOYSTICK_Y: {
-            inout_gamepad->joystick_positions[0][1] = msg_payload->status.joystick_pos;
-            break;
-        }
-        case GAMEPAD_RIGHT_JOYSTICK_X: {
-            inout_gamepad->joystick_positions[1][0] = msg_payload->status.joystick_pos;
-            break;
-        }
-        case GAMEPAD_RIGHT_JOYSTICK_Y: {
-            inout_gamepad->joystick_positions[1][1] = msg_payload->status.joystick_pos;
-            break;
-        }
-        case GAMEPAD_DPAD_X: {
-            const int8_t v = msg_payload->status.dpad;
+    }
+
+    return 0;
+}
+
+int64_t get_timediff_nsec(const struct timespec *const start, const struct timespec *const end) {
+    return (end->tv_sec - start->tv_sec) * 1000000000LL + (end->tv_nsec - start->tv_nsec);
+}
+
+// out messages waiting for a client: one per type, a newer one replaces the one not sent yet
+#define CLIENT_TX_SLOTS (OUT_MSG_TYPE_RESOLUTION + 1)
+
+// a client whose socket stays full this long is not reading what it is sent and gets dropped
+#define CLIENT_TX_STUCK_NS 500000000LL
+
+/**
+ * Out messages waiting for the reliable lane of a client to be writable: rumble, leds and resolution
+ * describe a state so only the newest of each type is worth sending, a slow client gets the latest values
+ * instead of a backlog and dev_out never blocks on it.
+ */
+typedef struct client_tx {
+    int fd; // a slot taken over by a new client starts empty
+    uint32_t pending; // bit i set: slots[i] has to be sent
+    out_message_t slots[CLIENT_TX_SLOTS];
+
+    // a stream socket can take part of a message: the rest is written first on the next flush
+    out_message_t inflight;
+    size_t inflight_off; // sizeof(out_message_t) when there is nothing in flight
+
+    bool blocked; // the socket was full on the last flush: wait for it to be writable
+    struct timespec blocked_since;
+} client_tx_t;
+
+static void client_tx_reset(client_tx_t *const tx, int fd) {
+    tx->fd = fd;
+    tx->pending = 0;
+    tx->inflight_off = sizeof(out_message_t);
+    tx->blocked = false;
+}
+
+static void client_tx_push(client_tx_t *const tx, const out_message_t *const msg) {
+    tx->slots[msg->type] = *msg;
+    tx->pending |= (uint32_t)1 << (uint32_t)msg->type;
+}
 
-            inout_gamepad->dpad &= 0xF0;
-            if (v == 0) {
-                inout_gamepad->dpad |= 0x00;
-            } else if (v == 1) {
-                inout_gamepad->dpad |= 0x01;
-            } else if (v == -1) {
-                inout_gamepad->dpad |= 0x02;
+static bool client_tx_has_data(const client_tx_t *const tx) {
+    return (tx->pending != 0) || (tx->inflight_off < sizeof(out_message_t));
+}
+
+/**
+ * Write what the socket takes without blocking: returns 0 once everything has been written or the socket
+ * is full, a negative errno if the client has to be dropped (also when it has been stuck for too long).
+ */
+static int client_tx_flush(client_tx_t *const tx, const struct timespec *const now) {
+    for (;;) {
+        if (tx->inflight_off == sizeof(out_message_t)) {
+            if (tx->pending == 0) {
+                tx->blocked = false;
+                return 0;
             }
 
-            break;
+            const uint32_t type = (uint32_t)__builtin_ctz(tx->pending);
+            tx->pending &= tx->pending - 1;
+            tx->inflight = tx->slots[type];
+            tx->inflight_off = 0;
         }
-        case GAMEPAD_DPAD_Y: {
-            const int8_t v = msg_payload->status.dpad;
 
-            inout_gamepad->dpad &= 0x0F;
-            if (v == 0) {
-                inout_gamepad->dpad |= 0x00;
-            } else if (v == 1) {
-                inout_gamepad->dpad |= 0x20;
-            } else if (v == -1) {
-                inout_gamepad->dpad |= 0x10;
+        const ssize_t write_res = send(
+            tx->fd,
+            (const void*)((const uint8_t*)&tx->inflight + tx->inflight_off),
+            sizeof(out_message_t) - tx->inflight_off,
+            MSG_DONTWAIT | MSG_NOSIGNAL
+        );
+
+        if (write_res < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                if (!tx->blocked) {
+                    tx->blocked = true;
+                    tx->blocked_since = *now;
+                }
+
+                return 0;
             }
 
-            break;
-        }
-        case GAMEPAD_GYROSCOPE: {
-            inout_gamepad->last_gyro_motion_timestamp_ns = msg_payload->status.gyro.sample_timestamp_ns;
-            inout_gamepad->raw_gyro[0] = in_settings->invert_x ? (int16_t)(-1) * msg_payload->status.gyro.x : msg_payload->status.gyro.x;
-            inout_gamepad->raw_gyro[1] = in_settings->swap_y_z ? msg_payload->status.gyro.z : msg_payload->status.gyro.y;
-            inout_gamepad->raw_gyro[2] = in_settings->swap_y_z ? msg_payload->status.gyro.y : msg_payload->status.gyro.z;
-            break;
+            return -errno;
         }
-        case GAMEPAD_ACCELEROMETER: {
-            inout_gamepad->last_accel_motion_timestamp_ns = msg_payload->status.accel.sample_timestamp_ns;
-            inout_gamepad->raw_accel[0] = in_settings->invert_x ? (int16_t)(-1) * msg_payload->status.accel.x : msg_payload->status.accel.x;
-            inout_gamepad->raw_accel[1] = in_settings->swap_y_z ? msg_payload->status.accel.z : msg_payload->status.accel.y;
-            inout_gamepad->raw_accel[2] = in_settings->swap_y_z ? msg_payload->status.accel.y : msg_payload->status.accel.z;
-            break;
-        }
-        case GAMEPAD_TOUCHPAD_TOUCH_ACTIVE: {
-            inout_gamepad->touchpad_touch_num = msg_payload->status.touchpad_active.status;
-            break;
+
+        // any progress means the client is reading
+        tx->inflight_off += (size_t)write_res;
+        tx->blocked = false;
+    }
+}
+
+static int gamepad_open(
+    const dev_out_settings_t *const in_settings,
+    const gamepad_response_t *const response,
+    dev_out_gamepad_device_t gamepad,
+    virt_gamepad_t *const out_controller
+) {
+    int res = -EINVAL;
+
+    if (gamepad == GAMEPAD_DUALSENSE) {
+        res = virt_dualsense_init(
+            &out_controller->ds5,
+            in_settings->controller_bluetooth,
+            in_settings->dualsense_edge,
+            response
+        );
+
+        if (res != 0) {
+            fprintf(stderr, "Unable to initialize the DualSense device: %d\n", res);
+        } else {
+            res = virt_dualsense_get_fd(&out_controller->ds5);
+            printf("DualSense initialized: fd=%d, bluetooth=%s\n", res, in_settings->controller_bluetooth ? "true" : "false");
         }
-        case GAMEPAD_TOUCHPAD_X: {
-            inout_gamepad->touchpad_x = msg_payload->status.touchpad_x.value;
-            break;
+    } else if (gamepad == GAMEPAD_DUALSHOCK) {
+        res = virt_dualshock_init(
+            &out_controller->ds4,
+            in_settings->controller_bluetooth,
+            response
+        );
+
+        if (res != 0) {
+            fprintf(stderr, "Unable to initialize the DualShock device: %d\n", res);
+        } else {
+            res = virt_dualshock_get_fd(&out_controller->ds4);
+            printf("DualShock initialized: fd=%d, bluetooth=%s\n", res, in_settings->controller_bluetooth ? "true" : "false");
         }
-        case GAMEPAD_TOUCHPAD_Y: {
-            inout_gamepad->touchpad_y = msg_payload->status.touchpad_y.value;
-            break;
+    } else if (gamepad == GAMEPAD_XBOX) {
+        res = virt_xbox_init(
+            &out_controller->xbox,
+            response
+        );
+
+        if (res != 0) {
+            fprintf(stderr, "Unable to initialize the Xbox device: %d\n", res);
+        } else {
+            res = virt_xbox_get_fd(&out_controller->xbox);
+            printf("Xbox initialized: fd=%d\n", res);
         }
-        default: {
-            fprintf(stderr, "Unknown gamepad element: %d\n", msg_payload->element);
-            break;
+    } else if (gamepad == GAMEPAD_STEAM_DECK) {
+        res = virt_deck_init(
+            &out_controller->deck,
+            response
+        );
+
+        if (res != 0) {
+            fprintf(stderr, "Unable to initialize the Steam Deck device: %d\n", res);
+        } else {
+            res = virt_deck_get_fd(&out_controller->deck);
+            printf("Steam Deck initialized: fd=%d\n", res);
         }
     }
+
+    return (res == 0) ? -EIO : res;
+}
+
+static void gamepad_close(dev_out_gamepad_device_t gamepad, virt_gamepad_t *const controller) {
+    if (gamepad == GAMEPAD_DUALSENSE) {
+        virt_dualsense_close(&controller->ds5);
+    } else if (gamepad == GAMEPAD_DUALSHOCK) {
+        virt_dualshock_close(&controller->ds4);
+    } else if (gamepad == GAMEPAD_XBOX) {
+        virt_xbox_close(&controller->xbox);
+    } else if (gamepad == GAMEPAD_STEAM_DECK) {
+        virt_deck_close(&controller->deck);
+    }
 }
 
-static void handle_incoming_message_keyboard_set(
+static void *gamepad_switch_thread_func(void *ptr) {
+    gamepad_switch_t *const sw = (gamepad_switch_t*)ptr;
+
+    sw->result_fd = gamepad_open(sw->settings, sw->response, sw->target, sw->slot);
+
+    const uint64_t done = 1;
+    if (write(sw->done_fd, &done, sizeof(done)) != sizeof(done)) {
+        fprintf(stderr, "Unable to signal the end of the gamepad switch: %d\n", errno);
+    }
+
+    return NULL;
+}
+
+static int gamepad_switch_start(
+    gamepad_switch_t *const sw,
     const dev_out_settings_t *const in_settings,
-    const in_message_keyboard_set_element_t *const msg_payload,
-    keyboard_status_t *const inout_kbd
+    const gamepad_response_t *const response,
+    dev_out_gamepad_device_t target,
+    virt_gamepad_t *const slot
 ) {
-    switch (msg_payload->type) {
-        case KEYBOARD_KEY_Q:
-            inout_kbd->q = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_W:
-            inout_kbd->w = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_E:
-            inout_kbd->e = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_R:
-            inout_kbd->r = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_T:
-            inout_kbd->t = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_Y:
-            inout_kbd->y = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_U:
-            inout_kbd->u = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_I:
-            inout_kbd->i = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_O:
-            inout_kbd->o = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_P:
-            inout_kbd->p = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_A:
-            inout_kbd->a = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_S:
-            inout_kbd->s = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_D:
-            inout_kbd->d = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_F:
-            inout_kbd->f = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_G:
-            inout_kbd->g = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_H:
-            inout_kbd->h = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_J:
-            inout_kbd->j = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_K:
-            inout_kbd->k = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_L:
-            inout_kbd->l = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_Z:
-            inout_kbd->z = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_X:
-            inout_kbd->x = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_C:
-            inout_kbd->c = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_V:
-            inout_kbd->v = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_B:
-            inout_kbd->b = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_N:
-            inout_kbd->n = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_M:
-            inout_kbd->m = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_UP:
-            inout_kbd->up = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_DOWN:
-            inout_kbd->down = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_LEFT:
-            inout_kbd->left = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_RIGHT:
-            inout_kbd->right = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_NUM_0:
-            inout_kbd->num_0 = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_NUM_1:
-            inout_kbd->num_1 = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_NUM_2:
-            inout_kbd->num_2 = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_NUM_3:
-            inout_kbd->num_3 = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_NUM_4:
-            inout_kbd->num_4 = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_NUM_5:
-            inout_kbd->num_5 = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_NUM_6:
-            inout_kbd->num_6 = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_NUM_7:
-            inout_kbd->num_7 = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_NUM_8:
-            inout_kbd->num_8 = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_NUM_9:
-            inout_kbd->num_9 = msg_payload->value;
-            break;
-        case KEYBOARD_KEY_LCRTL:
-            inout_kbd->lctrl = msg_payload->value;
+    if ((sw->in_progress) || (sw->done_fd < 0)) {
+        return -EBUSY;
+    }
+
+    sw->settings = in_settings;
+    sw->response = response;
+    sw->target = target;
+    sw->slot = slot;
+    sw->result_fd = -1;
+
+    const int res = pthread_create(&sw->thread, NULL, gamepad_switch_thread_func, (void*)sw);
+    if (res != 0) {
+        fprintf(stderr, "Unable to start the gamepad switch thread: %d\n", res);
+        return -1 * res;
+    }
+
+    sw->in_progress = true;
+    return 0;
+}
+
+static dev_out_gamepad_device_t gamepad_next(dev_out_gamepad_device_t gamepad) {
+    switch (gamepad) {
+        case GAMEPAD_DUALSENSE:
+            return GAMEPAD_DUALSHOCK;
+        case GAMEPAD_DUALSHOCK:
+            return GAMEPAD_XBOX;
+        case GAMEPAD_XBOX:
+            return GAMEPAD_STEAM_DECK;
+        default:
+            return GAMEPAD_DUALSENSE;
+    }
+}
+
+/**
+ * Significant bits of a joystick position, as input clients send it, in the reports of an emulated gamepad:
+ * a stick curve steeper than the identity needs finer input to fill every step of the report.
+ */
+static uint8_t gamepad_joystick_bits(dev_out_gamepad_device_t gamepad, const gamepad_response_t *const response) {
+    uint8_t report_bits;
+    switch (gamepad) {
+        case GAMEPAD_DUALSENSE:
+        case GAMEPAD_DUALSHOCK:
+            report_bits = 8;
             break;
         default:
-            fprintf(stderr, "key not implemented\n");
+            report_bits = 16;
+            break;
     }
+
+    const int64_t bits = (int64_t)report_bits + (int64_t)response->sticks_extra_bits;
+    return (bits > 16) ? 16 : (uint8_t)bits;
 }
 
-static void handle_incoming_message(
-    const dev_out_settings_t *const in_settings,
-    const in_message_t *const msg,
-    devices_status_t *const dev_stats
-) {
-    if (msg->type == GAMEPAD_SET_ELEMENT) {
-        handle_incoming_message_gamepad_set(
-            in_settings,
-            &msg->data.gamepad_set,
-            &dev_stats->gamepad
-        );
-    } else if (msg->type == GAMEPAD_ACTION) {
-        handle_incoming_message_gamepad_action(
-            in_settings,
-            &msg->data.action,
-            &dev_stats->gamepad
-        );
-    } else if (msg->type == MOUSE_EVENT) {
-        handle_incoming_message_mouse_event(
-            in_settings,
-            &msg->data.mouse_event,
-            &dev_stats->mouse
-        );
-    } else if (msg->type == KEYBOARD_SET_ELEMENT) {
-        handle_incoming_message_keyboard_set(
-            in_settings,
-            &msg->data.kbd_set,
-            &dev_stats->kbd
-        );
+// DualShock and DualSense send a report every 1250us (800Hz), the Steam Deck controller every 1000us
+#define GAMEPAD_HID_REPORT_TIMING_MIN_US ((int64_t)1250)
+#define DECK_REPORT_TIMING_US ((int64_t)1000)
+
+// never report less often than this, whatever the IMU does
+#define GAMEPAD_HID_REPORT_TIMING_MAX_US ((int64_t)2500)
+
+/**
+ * Shortest time between two reports of an emulated gamepad.
+ */
+static int64_t gamepad_native_report_timing_us(dev_out_gamepad_device_t gamepad) {
+    return (gamepad == GAMEPAD_STEAM_DECK) ? DECK_REPORT_TIMING_US : GAMEPAD_HID_REPORT_TIMING_MIN_US;
+}
+
+/**
+ * Time between two reports of an emulated gamepad for an IMU sampling at imu_sampling_rate_hz (0 when unknown):
+ * every report carries a new sample, as the real controller does with two samples per report.
+ */
+static int64_t gamepad_report_timing_for_imu_us(dev_out_gamepad_device_t gamepad, uint32_t imu_sampling_rate_hz) {
+    if (gamepad == GAMEPAD_STEAM_DECK) {
+        // the Steam Deck controller reports at 1kHz regardless of the IMU
+        return DECK_REPORT_TIMING_US;
+    } else if (imu_sampling_rate_hz == 0) {
+        return GAMEPAD_HID_REPORT_TIMING_MAX_US;
     }
+
+    return min_max_clamp(
+        (int64_t)2000000 / (int64_t)imu_sampling_rate_hz,
+        GAMEPAD_HID_REPORT_TIMING_MIN_US,
+        GAMEPAD_HID_REPORT_TIMING_MAX_US
+    );
 }
 
-int64_t get_timediff_nsec(const struct timespec *const start, const struct timespec *const end) {
-    return (end->tv_sec - start->tv_sec) * 1000000000LL + (end->tv_nsec - start->tv_nsec);
+static out_message_t resolution_message(dev_out_gamepad_device_t gamepad, const gamepad_response_t *const response) {
+    const out_message_t msg = {
+        .type = OUT_MSG_TYPE_RESOLUTION,
+        .data = {
+            .resolution = {
+                .joystick_bits = gamepad_joystick_bits(gamepad, response),
+                .imu_sampling_rate_hz = (uint32_t)((int64_t)2000000 / gamepad_native_report_timing_us(gamepad)),
+            }
+        }
+    };
+
+    return msg;
+}
+
+/**
+ * Forget a client of the reliable lane: it sends its whole state again on reconnection.
+ *
+ * The status is shared by every client, so what is being held is released only when the last one goes away:
+ * releasing on each disconnection would also drop buttons and keys still held through the clients left.
+ */
+static void drop_client(dev_out_data_t *const dev_out_data, int slot, client_rx_t *const rx, client_tx_t *const tx) {
+    const int fd = atomic_exchange(&dev_out_data->communication.endpoint.ssocket.clients[slot], -1);
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    // the fd number can be given to the next client: never mistake its buffers for the ones of the new one
+    rx->fd = -1;
+    rx->len = 0;
+    client_tx_reset(tx, -1);
+
+    for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
+        if (atomic_load(&dev_out_data->communication.endpoint.ssocket.clients[i]) >= 0) {
+            return;
+        }
+    }
+
+    devices_status_release_inputs(&dev_out_data->dev_stats);
+}
+
+/**
+ * Play gamepad actions requested by input clients, one at a time and in the order they were requested:
+ * to be called right before composing a gamepad report, does nothing unless an action is pending.
+ */
+static void gamepad_actions_run(gamepad_sequencer_t *const sequencer, gamepad_status_t *const gamepad, const struct timespec *const now) {
+    if (!gamepad_sequencer_active(sequencer)) {
+        const gamepad_sequence_t *sequence = NULL;
+        if (gamepad->flags & GAMEPAD_STATUS_FLAGS_PRESS_AND_REALEASE_CENTER) {
+            gamepad->flags &= ~GAMEPAD_STATUS_FLAGS_PRESS_AND_REALEASE_CENTER;
+            sequence = &gamepad_sequence_press_and_release_center;
+        } else if (gamepad->flags & GAMEPAD_STATUS_FLAGS_OPEN_STEAM_QAM) {
+            gamepad->flags &= ~GAMEPAD_STATUS_FLAGS_OPEN_STEAM_QAM;
+            sequence = &gamepad_sequence_open_steam_qam;
+        } else {
+            return;
+        }
+
+        const int start_res = gamepad_sequencer_start(sequencer, sequence, now);
+        if (start_res != 0) {
+            fprintf(stderr, "Unable to play gamepad sequence %s: %d\n", sequence->name, start_res);
+            return;
+        }
+    }
+
+    gamepad_sequencer_run(sequencer, gamepad, now);
 }
 
 void *dev_out_thread_func(void *ptr) {
@@ -402,20 +490,59 @@ void *dev_out_thread_func(void *ptr) {
         case 2:
             current_gamepad = GAMEPAD_DUALSHOCK;
             break;
+        case 3:
+            current_gamepad = GAMEPAD_XBOX;
+            break;
+        case 4:
+            current_gamepad = GAMEPAD_STEAM_DECK;
+            break;
 
         default:
             current_gamepad = GAMEPAD_DUALSENSE;
             break;
     }
 
+    // curves are compiled once: every emulated gamepad (including the ones created by a switch) shares them
+    gamepad_response_t response;
+    const int response_res = gamepad_response_compile(&response, &dev_out_data->settings);
+    if (response_res != 0) {
+        fprintf(stderr, "Invalid response curves settings: %d\n", response_res);
+        return NULL;
+    }
+
     int current_gamepad_fd = -1;
     int current_keyboard_fd = -1;
     int current_mouse_fd = -1;
 
-    union {
-        virt_dualshock_t ds4;
-        virt_dualsense_t ds5;
-    } controller_data;
+    // the active emulated gamepad lives in one slot, the other one is where a switch builds the next
+    virt_gamepad_t controllers[2];
+    int active_controller = 0;
+
+    gamepad_switch_t gamepad_switch = {
+        .done_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK),
+        .in_progress = false,
+    };
+
+    if (gamepad_switch.done_fd < 0) {
+        fprintf(stderr, "Unable to create the eventfd used to switch gamepad -- switching will not be available\n");
+    }
+
+    bool switch_chord_pressed = false;
+
+    gamepad_sequencer_t sequencer;
+    gamepad_sequencer_init(&sequencer);
+
+    gyro_mouse_t gyro_mouse;
+    const int gyro_mouse_res = gyro_mouse_init(&gyro_mouse, &dev_out_data->settings);
+    if (gyro_mouse_res != 0) {
+        fprintf(stderr, "Invalid gyro to mouse settings: %d -- gyro mouse will not be available\n", gyro_mouse_res);
+    }
+
+    motion_predictor_t motion_predictor;
+    const int motion_predictor_res = motion_predictor_init(&motion_predictor, &dev_out_data->settings);
+    if (motion_predictor_res != 0) {
+        fprintf(stderr, "Invalid motion prediction settings: %d -- motion prediction will not be available\n", motion_predictor_res);
+    }
 
     virt_mouse_t mouse_data;
     const int mouse_init_res = virt_mouse_init(&mouse_data);
@@ -435,47 +562,7 @@ void *dev_out_thread_func(void *ptr) {
         printf("Keyboard initialized: fd=%d\n", current_keyboard_fd);
     }
 
-    bool high_hz_avail = false;
-    const char *const avail_freq = inline_read_file("/sys/bus/iio/devices/iio:device0/", "name");
-    if ((avail_freq != NULL) && (strstr(avail_freq, "1600.0") != NULL)) {
-        printf("High iio sampling frequency available: 1600.0 Hz");
-        high_hz_avail = true;
-    }
-
-    const int64_t kbd_report_timing_us = high_hz_avail ? 1125 : 2025;
-    const int64_t mouse_report_timing_us = high_hz_avail ? 950 : 1650;
-    const int64_t gamepad_report_timing_us = high_hz_avail ? 1250 : 2500;
-
-    if (current_gamepad == GAMEPAD_DUALSENSE) {
-        const int ds5_init_res = virt_dualsense_init(
-            &controller_data.ds5,
-            dev_out_data->settings.controller_bluetooth,
-            dev_out_data->settings.dualsense_edge,
-            dev_out_data->settings.gyro_to_analog_activation_treshold,
-            dev_out_data->settings.gyro_to_analog_mapping       
-        );
-
-        if (ds5_init_res != 0) {
-            fprintf(stderr, "Unable to initialize the DualSense device: %d\n", ds5_init_res);
-        } else {
-            current_gamepad_fd = virt_dualsense_get_fd(&controller_data.ds5);
-            printf("DualSense initialized: fd=%d, bluetooth=%s\n", current_gamepad_fd, dev_out_data->settings.controller_bluetooth ? "true" : "false");
-        }
-    } else if (current_gamepad == GAMEPAD_DUALSHOCK) {
-        const int ds4_init_res = virt_dualshock_init(
-            &controller_data.ds4,
-            dev_out_data->settings.controller_bluetooth,
-            dev_out_data->settings.gyro_to_analog_activation_treshold,
-            dev_out_data->settings.gyro_to_analog_mapping  
-        );
-
-        if (ds4_init_res != 0) {
-            fprintf(stderr, "Unable to initialize the DualShock device: %d\n", ds4_init_res);
-        } else {
-            current_gamepad_fd = virt_dualshock_get_fd(&controller_data.ds4);
-            printf("DualShock initialized: fd=%d, bluetooth=%s\n", current_gamepad_fd, dev_out_data->settings.controller_bluetooth ? "true" : "false");
-        }
-    }
+    current_gamepad_fd = gamepad_open(&dev_out_data->settings, &response, current_gamepad, &controllers[active_controller]);
 
     struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
@@ -486,7 +573,37 @@ void *dev_out_thread_func(void *ptr) {
 
     uint8_t tmp_buf[256];
 
+    // in-process mode: what of the shared input state has been consumed and whether dev_in signalled an edge
+    devices_status_shared_reader_t shared_reader = {
+        .seq = 0,
+        .mouse_x = 0,
+        .mouse_y = 0,
+    };
+    bool wake_pending = false;
+
     fd_set read_fds;
+
+    client_rx_t clients_rx[MAX_CONNECTED_CLIENTS];
+    for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
+        clients_rx[i].fd = -1;
+        clients_rx[i].len = 0;
+    }
+
+    client_tx_t clients_tx[MAX_CONNECTED_CLIENTS];
+    for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
+        client_tx_reset(&clients_tx[i], -1);
+    }
+
+    // a socket full on the last flush is only written again once select reports it writable
+    fd_set write_fds;
+    FD_ZERO(&write_fds);
+
+    // the pipe (or in-process) input client has been told the resolution of the current gamepad
+    bool resolution_pending = true;
+
+    // rumble changes already forwarded to input clients: the emulated gamepad can also change it while sending a report
+    uint64_t rumble_events_forwarded = dev_out_data->dev_stats.gamepad.rumble_events_count;
+
     for (;;) {
         if (dev_out_data->flags & DEV_OUT_FLAG_EXIT) {
             printf("Termination signal received -- exiting dev_out\n");
@@ -495,25 +612,58 @@ void *dev_out_thread_func(void *ptr) {
 
         clock_gettime(CLOCK_MONOTONIC, &now);
 
+        // report cadence follows the sampling frequency dev_in negotiated for the IMU
+        const uint32_t imu_sampling_rate_hz = dev_out_data->dev_stats.gamepad.imu_sampling_rate_hz;
+        const bool high_hz = imu_sampling_rate_hz >= (uint32_t)((int64_t)2000000 / GAMEPAD_HID_REPORT_TIMING_MIN_US);
+        const int64_t kbd_report_timing_us = high_hz ? 1125 : 2025;
+        const int64_t mouse_report_timing_us = high_hz ? 950 : 1650;
+
         const int64_t gamepad_time_diff_usecs = get_timediff_nsec(&gamepad_last_hid_report_sent, &now) / 1000;
+        const int64_t gamepad_report_timing_us = gamepad_report_timing_for_imu_us(current_gamepad, imu_sampling_rate_hz);
         const int64_t mouse_time_diff_usecs = get_timediff_nsec(&mouse_last_hid_report_sent, &now) / 1000;
         const int64_t kbd_time_diff_usecs = get_timediff_nsec(&keyboard_last_hid_report_sent, &now) / 1000;
 
-        if ((current_gamepad_fd > 0) && (gamepad_time_diff_usecs >= gamepad_report_timing_us)) {
+        // a button edge is sent out right away instead of waiting for the next report
+        const bool gamepad_due = (gamepad_time_diff_usecs >= gamepad_report_timing_us) || (wake_pending);
+        const bool mouse_due = (mouse_time_diff_usecs >= mouse_report_timing_us) || (wake_pending);
+        const bool kbd_due = (kbd_time_diff_usecs >= kbd_report_timing_us) || (wake_pending);
+        wake_pending = false;
+
+        // the shared input state is only looked at right before composing reports
+        if ((dev_out_data->communication.type == ipc_shared_state) && ((gamepad_due) || (mouse_due) || (kbd_due))) {
+            devices_status_shared_sync(
+                dev_out_data->communication.endpoint.shared.state,
+                &shared_reader,
+                &dev_out_data->dev_stats
+            );
+        }
+
+        if ((current_gamepad_fd > 0) && (gamepad_due)) {
             gamepad_last_hid_report_sent = now;
-            
+
+            gamepad_actions_run(&sequencer, &dev_out_data->dev_stats.gamepad, &now);
+            motion_predictor_run(&motion_predictor, &dev_out_data->dev_stats.gamepad, &now);
+
+            virt_gamepad_t *const controller = &controllers[active_controller];
             if (current_gamepad == GAMEPAD_DUALSENSE) {
-                virt_dualsense_compose(&controller_data.ds5, &dev_out_data->dev_stats.gamepad, tmp_buf);
-                virt_dualsense_send(&controller_data.ds5, tmp_buf);
+                virt_dualsense_compose(&controller->ds5, &dev_out_data->dev_stats.gamepad, tmp_buf);
+                virt_dualsense_send(&controller->ds5, tmp_buf);
             } else if (current_gamepad == GAMEPAD_DUALSHOCK) {
-                virt_dualshock_compose(&controller_data.ds4, &dev_out_data->dev_stats.gamepad, tmp_buf);
-                virt_dualshock_send(&controller_data.ds4, tmp_buf);
+                virt_dualshock_compose(&controller->ds4, &dev_out_data->dev_stats.gamepad, tmp_buf);
+                virt_dualshock_send(&controller->ds4, tmp_buf);
+            } else if (current_gamepad == GAMEPAD_XBOX) {
+                virt_xbox_send(&controller->xbox, &dev_out_data->dev_stats.gamepad, NULL);
+            } else if (current_gamepad == GAMEPAD_STEAM_DECK) {
+                virt_deck_compose(&controller->deck, &dev_out_data->dev_stats.gamepad, tmp_buf);
+                virt_deck_send(&controller->deck, tmp_buf);
             }
         }
         
-        if ((current_mouse_fd > 0) && (mouse_time_diff_usecs >= mouse_report_timing_us)) {
+        if ((current_mouse_fd > 0) && (mouse_due)) {
             mouse_last_hid_report_sent = now;
 
+            gyro_mouse_run(&gyro_mouse, &dev_out_data->dev_stats.gamepad, &dev_out_data->dev_stats.mouse, &now);
+
             virt_mouse_send(&mouse_data, &dev_out_data->dev_stats.mouse, NULL);
             
             // reset mouse movements now
@@ -521,28 +671,83 @@ void *dev_out_thread_func(void *ptr) {
             dev_out_data->dev_stats.mouse.y = 0;
         }
         
-        if ((current_keyboard_fd > 0) && (kbd_time_diff_usecs >= kbd_report_timing_us)) {
+        if ((current_keyboard_fd > 0) && (kbd_due)) {
             keyboard_last_hid_report_sent = now;
 
             virt_kbd_send(&keyboard_data, &dev_out_data->dev_stats.kbd, NULL);
         }
 
+        // input clients drop messages that would not change the reports: tell them what the reports keep
+        if ((dev_out_data->communication.type == ipc_unix_pipe) || (dev_out_data->communication.type == ipc_shared_state)) {
+            if (resolution_pending) {
+                const int out_message_pipe_fd = (dev_out_data->communication.type == ipc_unix_pipe) ?
+                    dev_out_data->communication.endpoint.pipe.out_message_pipe_fd :
+                    dev_out_data->communication.endpoint.shared.out_message_pipe_fd;
+
+                const out_message_t msg = resolution_message(current_gamepad, &response);
+                const int write_res = write(out_message_pipe_fd, (const void*)&msg, sizeof(out_message_t));
+                if (write_res != sizeof(out_message_t)) {
+                    fprintf(stderr, "Error in writing the gamepad resolution to out_message_pipe: %d\n", write_res);
+                }
+
+                resolution_pending = false;
+            }
+        } else if (dev_out_data->communication.type == ipc_server_sockets) {
+            // flush what is queued for each client as far as its socket takes it
+            for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
+                const int fd = atomic_load_explicit(&dev_out_data->communication.endpoint.ssocket.clients[i], memory_order_acquire);
+                if (fd <= 0) {
+                    continue;
+                }
+
+                if (clients_tx[i].fd != fd) {
+                    client_tx_reset(&clients_tx[i], fd);
+
+                    const out_message_t msg = resolution_message(current_gamepad, &response);
+                    client_tx_push(&clients_tx[i], &msg);
+                }
+
+                if (!client_tx_has_data(&clients_tx[i])) {
+                    continue;
+                }
+
+                int flush_res = 0;
+                if ((!clients_tx[i].blocked) || (FD_ISSET(fd, &write_fds))) {
+                    flush_res = client_tx_flush(&clients_tx[i], &now);
+                } else if (get_timediff_nsec(&clients_tx[i].blocked_since, &now) > CLIENT_TX_STUCK_NS) {
+                    flush_res = -ETIMEDOUT;
+                }
+
+                if (flush_res < 0) {
+                    fprintf(stderr, "Error in writing out_message to socket number %d: %d -- client will be dropped\n", i, flush_res);
+                    drop_client(dev_out_data, i, &clients_rx[i], &clients_tx[i]);
+                }
+            }
+        }
 
         // once here no output device needs to send out its report
         FD_ZERO(&read_fds);
+        FD_ZERO(&write_fds);
 
         if (dev_out_data->communication.type == ipc_unix_pipe) {
             FD_SET(dev_out_data->communication.endpoint.pipe.in_message_pipe_fd, &read_fds);
+        } else if (dev_out_data->communication.type == ipc_shared_state) {
+            FD_SET(dev_out_data->communication.endpoint.shared.state->wake_fd, &read_fds);
         } else if (dev_out_data->communication.type == ipc_server_sockets) {
-            if (pthread_mutex_lock(&dev_out_data->communication.endpoint.ssocket.mutex) == 0) {
-                for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
-                    const int fd = dev_out_data->communication.endpoint.ssocket.clients[i];
-                    if (fd > 0) {
-                        FD_SET(fd, &read_fds);
+            for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
+                const int fd = atomic_load_explicit(&dev_out_data->communication.endpoint.ssocket.clients[i], memory_order_acquire);
+                if (fd > 0) {
+                    FD_SET(fd, &read_fds);
+
+                    if ((clients_tx[i].fd == fd) && (clients_tx[i].blocked)) {
+                        FD_SET(fd, &write_fds);
                     }
                 }
-            
-                pthread_mutex_unlock(&dev_out_data->communication.endpoint.ssocket.mutex);
+
+                const int latest_fd = atomic_load_explicit(&dev_out_data->communication.endpoint.ssocket.latest_clients[i], memory_order_acquire);
+                if (latest_fd > 0) {
+                    FD_SET(latest_fd, &read_fds);
+                }
             }
         }
 
@@ -558,6 +763,10 @@ void *dev_out_thread_func(void *ptr) {
             FD_SET(current_gamepad_fd, &read_fds);
         }
 
+        if (gamepad_switch.in_progress) {
+            FD_SET(gamepad_switch.done_fd, &read_fds);
+        }
+
         const int64_t timeout_gamepad_time_diff_usecs = (current_gamepad_fd > 0) ? gamepad_report_timing_us - gamepad_time_diff_usecs : 5000;
         const int64_t timeout_mouse_time_diff_usecs = (current_mouse_fd > 0) ? mouse_report_timing_us - mouse_time_diff_usecs : 5000;
         const int64_t timeout_kbd_time_diff_usecs = (current_keyboard_fd > 0) ? kbd_report_timing_us - kbd_time_diff_usecs : 5000;
@@ -582,8 +791,32 @@ void *dev_out_thread_func(void *ptr) {
             .tv_usec = (__suseconds_t)next_timing_out_device_diff_usecs % (__suseconds_t)1000000,
         };
 
-        int ready_fds = select(FD_SETSIZE, &read_fds, NULL, NULL, &timeout);
-        gamepad_status_qam_quirk_ext_time(&dev_out_data->dev_stats.gamepad);
+        int ready_fds = select(FD_SETSIZE, &read_fds, &write_fds, NULL, &timeout);
+
+        // center + share + option pressed together switch to the next emulated gamepad
+        const bool switch_chord = (dev_out_data->dev_stats.gamepad.center) &&
+            (dev_out_data->dev_stats.gamepad.share) &&
+            (dev_out_data->dev_stats.gamepad.option);
+        if ((switch_chord) && (!switch_chord_pressed)) {
+            dev_out_data->dev_stats.gamepad.flags |= GAMEPAD_STATUS_FLAGS_SWITCH_GAMEPAD;
+        }
+        switch_chord_pressed = switch_chord;
+
+        if (dev_out_data->dev_stats.gamepad.flags & GAMEPAD_STATUS_FLAGS_SWITCH_GAMEPAD) {
+            dev_out_data->dev_stats.gamepad.flags &= ~GAMEPAD_STATUS_FLAGS_SWITCH_GAMEPAD;
+
+            const int switch_res = gamepad_switch_start(
+                &gamepad_switch,
+                &dev_out_data->settings,
+                &response,
+                gamepad_next(current_gamepad),
+                &controllers[1 - active_controller]
+            );
+
+            if (switch_res != 0) {
+                fprintf(stderr, "Unable to start switching emulated gamepad: %d\n", switch_res);
+            }
+        }
 
         if (ready_fds == -1) {
             const int err = errno;
@@ -595,16 +828,67 @@ void *dev_out_thread_func(void *ptr) {
             continue;
         }
 
-        if ((current_gamepad_fd > 0) && (FD_ISSET(current_gamepad_fd, &read_fds))) {
+        if ((gamepad_switch.in_progress) && (FD_ISSET(gamepad_switch.done_fd, &read_fds))) {
+            uint64_t done;
+            if (read(gamepad_switch.done_fd, &done, sizeof(done)) != sizeof(done)) {
+                fprintf(stderr, "Error reading the gamepad switch eventfd: %d\n", errno);
+            }
+
+            pthread_join(gamepad_switch.thread, NULL);
+            gamepad_switch.in_progress = false;
+
+            if (gamepad_switch.result_fd > 0) {
+                // the new device is ready: make it the active one, then get rid of the previous
+                const dev_out_gamepad_device_t prev_gamepad = current_gamepad;
+                const int prev_gamepad_fd = current_gamepad_fd;
+                const int prev_controller = active_controller;
+
+                current_gamepad = gamepad_switch.target;
+                current_gamepad_fd = gamepad_switch.result_fd;
+                active_controller = 1 - active_controller;
+
+                // gamepad_status_t is shared: the new device starts with the current state
+                dev_out_data->dev_stats.gamepad.dirty = GAMEPAD_STATUS_DIRTY_ALL;
+
+                // and input clients have to learn its resolution
+                resolution_pending = true;
+                for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
+                    if (clients_tx[i].fd > 0) {
+                        const out_message_t msg = resolution_message(current_gamepad, &response);
+                        client_tx_push(&clients_tx[i], &msg);
+                    }
+                }
+
+                if (prev_gamepad_fd > 0) {
+                    gamepad_close(prev_gamepad, &controllers[prev_controller]);
+
+                    // the old fd might have been selected as readable: do not read from it
+                    FD_CLR(prev_gamepad_fd, &read_fds);
+                }
+
+                printf("Emulated gamepad switched: fd=%d\n", current_gamepad_fd);
+            } else {
+                fprintf(stderr, "Unable to switch emulated gamepad: %d\n", gamepad_switch.result_fd);
+            }
+        }
+
+        const bool gamepad_readable = (current_gamepad_fd > 0) && (FD_ISSET(current_gamepad_fd, &read_fds));
+        if ((gamepad_readable) || (dev_out_data->dev_stats.gamepad.rumble_events_count != rumble_events_forwarded)) {
             const uint64_t prev_leds_events_count = dev_out_data->dev_stats.gamepad.leds_events_count;
-            const uint64_t prev_motors_events_count = dev_out_data->dev_stats.gamepad.rumble_events_count;
 
             out_message_t out_msgs[4];
             size_t out_msgs_count = 0;
-            if (current_gamepad == GAMEPAD_DUALSENSE) {
-                virt_dualsense_event(&controller_data.ds5, &dev_out_data->dev_stats.gamepad);
+            virt_gamepad_t *const controller = &controllers[active_controller];
+            if (!gamepad_readable) {
+                // nothing to read: only a rumble change to forward
+            } else if (current_gamepad == GAMEPAD_DUALSENSE) {
+                virt_dualsense_event(&controller->ds5, &dev_out_data->dev_stats.gamepad);
             } else if (current_gamepad == GAMEPAD_DUALSHOCK) {
-                virt_dualshock_event(&controller_data.ds4, &dev_out_data->dev_stats.gamepad);
+                virt_dualshock_event(&controller->ds4, &dev_out_data->dev_stats.gamepad);
+            } else if (current_gamepad == GAMEPAD_XBOX) {
+                virt_xbox_event(&controller->xbox, &dev_out_data->dev_stats.gamepad);
+            } else if (current_gamepad == GAMEPAD_STEAM_DECK) {
+                virt_deck_event(&controller->deck, &dev_out_data->dev_stats.gamepad);
             }
 
             const uint64_t current_leds_events_count = dev_out_data->dev_stats.gamepad.leds_events_count;
@@ -627,7 +911,9 @@ void *dev_out_thread_func(void *ptr) {
                 }
             }
 
-            if (current_motors_events_count != prev_motors_events_count) {
+            if (current_motors_events_count != rumble_events_forwarded) {
+                rumble_events_forwarded = current_motors_events_count;
+
                 const out_message_t msg = {
                     .type = OUT_MSG_TYPE_RUMBLE,
                     .data = {
@@ -644,29 +930,27 @@ void *dev_out_thread_func(void *ptr) {
             }
 
             // send out game-generated events to sockets
-            if (dev_out_data->communication.type == ipc_unix_pipe) {
+            if ((dev_out_data->communication.type == ipc_unix_pipe) || (dev_out_data->communication.type == ipc_shared_state)) {
+                const int out_message_pipe_fd = (dev_out_data->communication.type == ipc_unix_pipe) ?
+                    dev_out_data->communication.endpoint.pipe.out_message_pipe_fd :
+                    dev_out_data->communication.endpoint.shared.out_message_pipe_fd;
+
                 for (int msg_idx = 0; msg_idx < out_msgs_count; ++msg_idx) {
-                    const int write_res = write(dev_out_data->communication.endpoint.pipe.out_message_pipe_fd, (void*)&out_msgs[msg_idx], sizeof(out_message_t));
+                    const int write_res = write(out_message_pipe_fd, (void*)&out_msgs[msg_idx], sizeof(out_message_t));
                     if (write_res != sizeof(out_message_t)) {
                         fprintf(stderr, "Error in writing out_message to out_message_pipe: %d\n", write_res);
                     }
                 }
             } else if (dev_out_data->communication.type == ipc_server_sockets) {
-                if (pthread_mutex_lock(&dev_out_data->communication.endpoint.ssocket.mutex) == 0) {
-                    for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
-                        if (dev_out_data->communication.endpoint.ssocket.clients[i] > 0) {
-                            for (int msg_idx = 0; msg_idx < out_msgs_count; ++msg_idx) {
-                                const int write_res = write(dev_out_data->communication.endpoint.ssocket.clients[i], (void*)&out_msgs[msg_idx], sizeof(out_message_t));
-                                if (write_res != sizeof(out_message_t)) {
-                                    fprintf(stderr, "Error in writing out_message to socket number %d: %d\n", i, write_res);
-                                    close(dev_out_data->communication.endpoint.ssocket.clients[i]);
-                                    dev_out_data->communication.endpoint.ssocket.clients[i] = -1;
-                                }
-                            }
-                        }
+                // queued only: flushed at the beginning of the next iteration, right after the reports
+                for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
+                    if (clients_tx[i].fd <= 0) {
+                        continue;
                     }
 
-                    pthread_mutex_unlock(&dev_out_data->communication.endpoint.ssocket.mutex);
+                    for (int msg_idx = 0; msg_idx < out_msgs_count; ++msg_idx) {
+                        client_tx_push(&clients_tx[i], &out_msgs[msg_idx]);
+                    }
                 }
             }
         }
@@ -685,7 +969,7 @@ void *dev_out_thread_func(void *ptr) {
                 in_message_t incoming_message;
                 const size_t in_message_pipe_read_res = read(dev_out_data->communication.endpoint.pipe.in_message_pipe_fd, (void*)&incoming_message, sizeof(in_message_t));
                 if (in_message_pipe_read_res == sizeof(in_message_t)) {
-                    handle_incoming_message(
+                    devices_status_apply_message(
                         &dev_out_data->settings,
                         &incoming_message,
                         &dev_out_data->dev_stats
@@ -694,39 +978,56 @@ void *dev_out_thread_func(void *ptr) {
                     fprintf(stderr, "Error reading from in_message_pipe_fd: got %zu bytes, expected %zu bytes\n", in_message_pipe_read_res, sizeof(in_message_t));
                 }
             }
+        } else if (dev_out_data->communication.type == ipc_shared_state) {
+            const int wake_fd = dev_out_data->communication.endpoint.shared.state->wake_fd;
+            if (FD_ISSET(wake_fd, &read_fds)) {
+                uint64_t edges;
+                if (read(wake_fd, &edges, sizeof(edges)) == sizeof(edges)) {
+                    wake_pending = true;
+                }
+            }
         } else if (dev_out_data->communication.type == ipc_server_sockets) {
-            if (pthread_mutex_lock(&dev_out_data->communication.endpoint.ssocket.mutex) == 0) {
-                for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
-                    const int fd = dev_out_data->communication.endpoint.ssocket.clients[i];
-                    if ((fd > 0) && (FD_ISSET(fd, &read_fds))) {
-                        in_message_t incoming_message;
-                        const size_t in_message_pipe_read_res = read(fd, (void*)&incoming_message, sizeof(in_message_t));
-                        if (in_message_pipe_read_res == sizeof(in_message_t)) {
-                            handle_incoming_message(
-                                &dev_out_data->settings,
-                                &incoming_message,
-                                &dev_out_data->dev_stats
-                            );
-                        } else {
-                            fprintf(stderr, "Error reading from socket number %d: got %zu bytes, expected %zu bytes\n", i, in_message_pipe_read_res, sizeof(in_message_t));
-                            close(dev_out_data->communication.endpoint.ssocket.clients[i]);
-                            dev_out_data->communication.endpoint.ssocket.clients[i] = -1;
-                        }
+            // discrete events first: they must never wait behind continuous samples
+            for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
+                const int fd = atomic_load_explicit(&dev_out_data->communication.endpoint.ssocket.clients[i], memory_order_acquire);
+                if ((fd > 0) && (FD_ISSET(fd, &read_fds))) {
+                    const int drain_res = drain_reliable_lane(&clients_rx[i], fd, &dev_out_data->settings, &dev_out_data->dev_stats);
+                    if (drain_res < 0) {
+                        fprintf(stderr, "Error reading from socket number %d: %d\n", i, drain_res);
+                        drop_client(dev_out_data, i, &clients_rx[i], &clients_tx[i]);
+                    }
+                }
+            }
+
+            for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
+                const int fd = atomic_load_explicit(&dev_out_data->communication.endpoint.ssocket.latest_clients[i], memory_order_acquire);
+                if ((fd > 0) && (FD_ISSET(fd, &read_fds))) {
+                    const int drain_res = drain_latest_lane(fd, &dev_out_data->settings, &dev_out_data->dev_stats);
+                    if (drain_res < 0) {
+                        fprintf(stderr, "Error reading from latest lane socket number %d: %d\n", i, drain_res);
+                        atomic_store_explicit(&dev_out_data->communication.endpoint.ssocket.latest_clients[i], -1, memory_order_release);
+                        close(fd);
                     }
                 }
-            
-                pthread_mutex_unlock(&dev_out_data->communication.endpoint.ssocket.mutex);
             }
         }
     }
 
+    // a gamepad being created in background must be waited for and then destroyed too
+    if (gamepad_switch.in_progress) {
+        pthread_join(gamepad_switch.thread, NULL);
+        if (gamepad_switch.result_fd > 0) {
+            gamepad_close(gamepad_switch.target, gamepad_switch.slot);
+        }
+    }
+
+    if (gamepad_switch.done_fd >= 0) {
+        close(gamepad_switch.done_fd);
+    }
+
     // close the gamepad output device
     if (current_gamepad_fd > 0) {
-        if (current_gamepad == GAMEPAD_DUALSENSE) {
-            virt_dualsense_close(&controller_data.ds5);
-        } else if (current_gamepad == GAMEPAD_DUALSHOCK) {
-            virt_dualshock_close(&controller_data.ds4);
-        }
+        gamepad_close(current_gamepad, &controllers[active_controller]);
     }
 
     // close the mouse device
@@ -742,17 +1043,22 @@ void *dev_out_thread_func(void *ptr) {
     // end communication
     if (dev_out_data->communication.type == ipc_server_sockets) {
         // close every client socket
-        if (pthread_mutex_lock(&dev_out_data->communication.endpoint.ssocket.mutex) == 0) {
-            for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
-                close(dev_out_data->communication.endpoint.ssocket.clients[i]);
-                dev_out_data->communication.endpoint.ssocket.clients[i] = -1;
+        for (int i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
+            const int fd = atomic_exchange(&dev_out_data->communication.endpoint.ssocket.clients[i], -1);
+            if (fd >= 0) {
+                close(fd);
             }
 
-            pthread_mutex_unlock(&dev_out_data->communication.endpoint.ssocket.mutex);
+            const int latest_fd = atomic_exchange(&dev_out_data->communication.endpoint.ssocket.latest_clients[i], -1);
+            if (latest_fd >= 0) {
+                close(latest_fd);
+            }
         }
     } else if (dev_out_data->communication.type == ipc_unix_pipe) {
         close(dev_out_data->communication.endpoint.pipe.in_message_pipe_fd);
         close(dev_out_data->communication.endpoint.pipe.out_message_pipe_fd);
+    } else if (dev_out_data->communication.type == ipc_shared_state) {
+        close(dev_out_data->communication.endpoint.shared.out_message_pipe_fd);
     } else if (dev_out_data->communication.type == ipc_client_socket) {
         close(dev_out_data->communication.endpoint.socket.fd);
         dev_out_data->communication.endpoint.socket.fd = -1;
@@ -11,6 +11,7 @@ typedef enum dev_out_gamepad_device {
     GAMEPAD_DUALSENSE,
     GAMEPAD_DUALSHOCK,
     GAMEPAD_XBOX,
+    GAMEPAD_STEAM_DECK,
 } dev_out_gamepad_device_t;
 
 typedef struct dev_out_data {
@@ -1,67 +1,210 @@
 #include "dev_timer.h"
 
-int dev_timer_open(
-    const timer_filters_t *const in_filters,
-    dev_timer_t **const out_dev
-) {
-    int res = -ENODEV;
-
-    *out_dev = malloc(sizeof(dev_timer_t));
-    if (*out_dev == NULL) {
-        res = -ENOMEM;
-        goto dev_timer_open_err;
-    }
+static uint64_t dev_timer_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
 
-    memset(*out_dev, 0, sizeof(dev_timer_t));
+    return ((uint64_t)now.tv_sec * (uint64_t)1000000000) + (uint64_t)now.tv_nsec;
+}
 
-    const int fd = timerfd_create(CLOCK_MONOTONIC, 0);
-    if (fd < 0) {
-        res = errno < 0 ? errno : -1 * errno;
-        if (res == 0) {
-            res = fd;
+static int dev_timer_arm(dev_timer_t *const inout_dev) {
+    uint64_t earliest_ns = 0;
+    for (size_t i = 0; i < DEV_TIMER_MAX_TIMERS; ++i) {
+        const dev_timer_entry_t *const t = &inout_dev->timers[i];
+        if ((t->id == 0) || (!t->running)) {
+            continue;
         }
-        goto dev_timer_open_err;
-    }
-
-    (*out_dev)->fd = fd;
-    if (in_filters->ticktime_ms != 0) {
-        (*out_dev)->timer_spec.it_value.tv_sec = in_filters->ticktime_ms / (__time_t)1000;
-        (*out_dev)->timer_spec.it_value.tv_nsec = (in_filters->ticktime_ms % (__syscall_slong_t)1000) * (__syscall_slong_t)1000000;
-        (*out_dev)->timer_spec.it_interval.tv_sec = in_filters->ticktime_ms / (__time_t)1000;
-        (*out_dev)->timer_spec.it_interval.tv_nsec = (in_filters->ticktime_ms % (__syscall_slong_t)1000) * (__syscall_slong_t)1000000;
-    } else {
-        (*out_dev)->timer_spec.it_value.tv_sec = 0;
-        (*out_dev)->timer_spec.it_value.tv_nsec = in_filters->ticktime_ns;
-        (*out_dev)->timer_spec.it_interval.tv_sec = 0;
-        (*out_dev)->timer_spec.it_interval.tv_nsec = in_filters->ticktime_ns;
-    }
-
-    if (timerfd_settime((*out_dev)->fd, 0, &(*out_dev)->timer_spec, NULL) < 0) {
-        res = errno < 0 ? errno : -1 * errno;
-        if (res == 0) {
-            res = -EIO;
+
+        if ((earliest_ns == 0) || (t->deadline_ns < earliest_ns)) {
+            earliest_ns = t->deadline_ns;
         }
-        goto dev_timer_open_err;
     }
 
-    res = 0;
+    if (earliest_ns == inout_dev->armed_ns) {
+        return 0;
+    }
 
-dev_timer_open_err:
-    if (res != 0) {
-        if (fd > 0) {
-            close(fd);
-        }
+    // a zeroed it_value disarms the timerfd: that happens when no timer is running
+    const struct itimerspec timer_spec = {
+        .it_interval = {
+            .tv_sec = 0,
+            .tv_nsec = 0,
+        },
+        .it_value = {
+            .tv_sec = (__time_t)(earliest_ns / (uint64_t)1000000000),
+            .tv_nsec = (__syscall_slong_t)(earliest_ns % (uint64_t)1000000000),
+        },
+    };
+
+    if (timerfd_settime(inout_dev->fd, TFD_TIMER_ABSTIME, &timer_spec, NULL) < 0) {
+        const int err = errno;
+        fprintf(stderr, "Unable to arm the timer: %d\n", err);
+        inout_dev->armed_ns = 0;
+        return err > 0 ? -err : -EIO;
+    }
+
+    inout_dev->armed_ns = earliest_ns;
 
-        free(*out_dev);
+    return 0;
+}
+
+int dev_timer_init(dev_timer_t *const out_dev) {
+    int res = -ENODEV;
+
+    memset(out_dev, 0, sizeof(dev_timer_t));
+
+    // the fd is non-blocking: it can be found readable and rearmed to a later deadline before being read
+    out_dev->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (out_dev->fd < 0) {
+        const int err = errno;
+        res = err > 0 ? -err : -EIO;
+        goto dev_timer_init_err;
     }
 
+    res = 0;
+
+dev_timer_init_err:
     return res;
 }
 
 void dev_timer_close(dev_timer_t *const inout_dev) {
-    close(inout_dev->fd);
+    if (inout_dev->fd >= 0) {
+        close(inout_dev->fd);
+    }
+
+    inout_dev->fd = -1;
 }
 
 int dev_timer_get_fd(const dev_timer_t *const in_dev) {
     return in_dev->fd;
 }
+
+int dev_timer_add(dev_timer_t *const inout_dev, const timer_filters_t *const in_filters) {
+    const uint64_t period_ns = (in_filters->ticktime_ms != 0) ?
+        in_filters->ticktime_ms * (uint64_t)1000000 :
+        in_filters->ticktime_ns;
+
+    if ((in_filters->id == 0) || (period_ns == 0)) {
+        return -EINVAL;
+    }
+
+    int slot = -ENOSPC;
+    for (size_t i = 0; i < DEV_TIMER_MAX_TIMERS; ++i) {
+        if (inout_dev->timers[i].id == in_filters->id) {
+            return -EEXIST;
+        } else if ((slot < 0) && (inout_dev->timers[i].id == 0)) {
+            slot = (int)i;
+        }
+    }
+
+    if (slot < 0) {
+        return slot;
+    }
+
+    inout_dev->timers[slot] = (dev_timer_entry_t) {
+        .id = in_filters->id,
+        .running = false,
+        .period_ns = period_ns,
+        .deadline_ns = 0,
+        .expirations = 0,
+    };
+
+    const int start_res = dev_timer_start(inout_dev, slot);
+    if (start_res != 0) {
+        inout_dev->timers[slot].id = 0;
+        return start_res;
+    }
+
+    return slot;
+}
+
+void dev_timer_remove(dev_timer_t *const inout_dev, int slot) {
+    if ((slot < 0) || (slot >= DEV_TIMER_MAX_TIMERS)) {
+        return;
+    }
+
+    inout_dev->timers[slot].id = 0;
+    inout_dev->timers[slot].running = false;
+
+    dev_timer_arm(inout_dev);
+}
+
+int dev_timer_start(dev_timer_t *const inout_dev, int slot) {
+    if ((slot < 0) || (slot >= DEV_TIMER_MAX_TIMERS) || (inout_dev->timers[slot].id == 0)) {
+        return -EINVAL;
+    }
+
+    dev_timer_entry_t *const t = &inout_dev->timers[slot];
+    if (t->running) {
+        return 0;
+    }
+
+    t->running = true;
+    t->deadline_ns = dev_timer_now_ns() + t->period_ns;
+    t->expirations = 0;
+
+    return dev_timer_arm(inout_dev);
+}
+
+int dev_timer_stop(dev_timer_t *const inout_dev, int slot) {
+    if ((slot < 0) || (slot >= DEV_TIMER_MAX_TIMERS) || (inout_dev->timers[slot].id == 0)) {
+        return -EINVAL;
+    }
+
+    dev_timer_entry_t *const t = &inout_dev->timers[slot];
+    if (!t->running) {
+        return 0;
+    }
+
+    t->running = false;
+    t->expirations = 0;
+
+    return dev_timer_arm(inout_dev);
+}
+
+bool dev_timer_is_running(const dev_timer_t *const in_dev, int slot) {
+    if ((slot < 0) || (slot >= DEV_TIMER_MAX_TIMERS)) {
+        return false;
+    }
+
+    return (in_dev->timers[slot].id != 0) && (in_dev->timers[slot].running);
+}
+
+int dev_timer_expire(dev_timer_t *const inout_dev) {
+    // the count is meaningless here: every timer accounts its own expirations from its deadline
+    uint64_t fd_expirations;
+    const ssize_t num_read = read(inout_dev->fd, &fd_expirations, sizeof(fd_expirations));
+    if ((num_read < 0) && (errno != EAGAIN)) {
+        const int err = errno;
+        return err > 0 ? -err : -EIO;
+    }
+
+    const uint64_t now_ns = dev_timer_now_ns();
+    for (size_t i = 0; i < DEV_TIMER_MAX_TIMERS; ++i) {
+        dev_timer_entry_t *const t = &inout_dev->timers[i];
+        if ((t->id == 0) || (!t->running) || (now_ns < t->deadline_ns)) {
+            continue;
+        }
+
+        // a late wakeup counts every period missed, keeping the original phase
+        const uint64_t expired = ((now_ns - t->deadline_ns) / t->period_ns) + 1;
+        t->expirations += expired;
+        t->deadline_ns += expired * t->period_ns;
+    }
+
+    // the timerfd has fired: it is disarmed until armed again
+    inout_dev->armed_ns = 0;
+
+    return dev_timer_arm(inout_dev);
+}
+
+uint64_t dev_timer_take(dev_timer_t *const inout_dev, int slot) {
+    if ((slot < 0) || (slot >= DEV_TIMER_MAX_TIMERS)) {
+        return 0;
+    }
+
+    const uint64_t expirations = inout_dev->timers[slot].expirations;
+    inout_dev->timers[slot].expirations = 0;
+
+    return expirations;
+}
@@ -2,17 +2,67 @@
 
 #include "input_dev.h"
 
+// timers are declared as input devices: a composite can never have more than this
+#define DEV_TIMER_MAX_TIMERS MAX_INPUT_DEVICES
+
+typedef struct dev_timer_entry {
+    // 0 when the entry is free
+    uint32_t id;
+
+    bool running;
+
+    uint64_t period_ns;
+
+    // CLOCK_MONOTONIC time of the next expiration
+    uint64_t deadline_ns;
+
+    // expirations not yet taken with dev_timer_take
+    uint64_t expirations;
+} dev_timer_entry_t;
+
+/**
+ * Every periodic timer of an input thread behind a single timerfd, armed at the earliest
+ * deadline among the running timers: adding a timer does not cost another fd and a stopped
+ * timer does not cause any wakeup.
+ */
 typedef struct dev_timer {
-    struct itimerspec timer_spec;
-    
     int fd;
+
+    // deadline the timerfd is currently armed at, 0 when disarmed
+    uint64_t armed_ns;
+
+    dev_timer_entry_t timers[DEV_TIMER_MAX_TIMERS];
 } dev_timer_t;
 
-int dev_timer_open(
-    const timer_filters_t *const in_filters,
-    dev_timer_t **const out_dev
-);
+int dev_timer_init(dev_timer_t *const out_dev);
 
 void dev_timer_close(dev_timer_t *const inout_dev);
 
 int dev_timer_get_fd(const dev_timer_t *const in_dev);
+
+/**
+ * Add a running timer: returns the slot used to refer to it or a negative errno.
+ */
+int dev_timer_add(dev_timer_t *const inout_dev, const timer_filters_t *const in_filters);
+
+void dev_timer_remove(dev_timer_t *const inout_dev, int slot);
+
+/**
+ * Start a stopped timer: its first expiration is one period from now.
+ */
+int dev_timer_start(dev_timer_t *const inout_dev, int slot);
+
+int dev_timer_stop(dev_timer_t *const inout_dev, int slot);
+
+bool dev_timer_is_running(const dev_timer_t *const in_dev, int slot);
+
+/**
+ * To be called when the fd is readable: account expirations of every running timer
+ * and arm the fd for the next deadline.
+ */
+int dev_timer_expire(dev_timer_t *const inout_dev);
+
+/**
+ * Return (and reset) the number of expirations of the given timer since the last call.
+ */
+uint64_t dev_timer_take(dev_timer_t *const inout_dev, int slot);
@@ -1,53 +1,32 @@
 #include "devices_status.h"
 #include <pthread.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 void kbd_status_init(keyboard_status_t *const stats) {
     stats->connected = true;
 
-    stats->q = 0;
-    stats->w = 0;
-    stats->e = 0;
-    stats->r = 0;
-    stats->t = 0;
-    stats->y = 0;
-    stats->u = 0;
-    stats->i = 0;
-    stats->o = 0;
-    stats->p = 0;
-    stats->a = 0;
-    stats->s = 0;
-    stats->d = 0;
-    stats->f = 0;
-    stats->g = 0;
-    stats->h = 0;
-    stats->j = 0;
-    stats->k = 0;
-    stats->l = 0;
-    stats->z = 0;
-    stats->x = 0;
-    stats->c = 0;
-    stats->v = 0;
-    stats->b = 0;
-    stats->n = 0;
-    stats->m = 0;
-
-    stats->num_1 = 0;
-    stats->num_2 = 0;
-    stats->num_3 = 0;
-    stats->num_4 = 0;
-    stats->num_5 = 0;
-    stats->num_6 = 0;
-    stats->num_7 = 0;
-    stats->num_8 = 0;
-    stats->num_9 = 0;
-    stats->num_0 = 0;
-
-    stats->up = 0;
-    stats->down = 0;
-    stats->left = 0;
-    stats->right = 0;
-
-    stats->lctrl = 0;
+    memset(stats->keys, 0, sizeof(stats->keys));
+
+    stats->time_valid = false;
+    timerclear(&stats->time);
+}
+
+int kbd_status_set_key(keyboard_status_t *const stats, uint16_t code, bool pressed) {
+    if (code >= KEYBOARD_STATUS_KEYS_COUNT) {
+        return -EINVAL;
+    }
+
+    const uint64_t mask = (uint64_t)1 << (code % 64);
+    if (pressed) {
+        stats->keys[code / 64] |= mask;
+    } else {
+        stats->keys[code / 64] &= ~mask;
+    }
+
+    return 0;
 }
 
 void mouse_status_init(mouse_status_t *const stats) {
@@ -58,6 +37,24 @@ void mouse_status_init(mouse_status_t *const stats) {
     stats->btn_left = 0;
     stats->btn_middle = 0;
     stats->btn_right = 0;
+
+    stats->time_valid = false;
+    timerclear(&stats->time);
+}
+
+/**
+ * A frame can merge several source events (deltas summed, keys pressed between two sends):
+ * it takes the time of the newest one, that is when the state it reports became true.
+ */
+static void merge_event_time(bool *const inout_valid, struct timeval *const inout_time, uint32_t flags, const struct timeval *const time) {
+    if ((flags & EV_MESSAGE_FLAGS_PRESERVE_TIME) == 0) {
+        return;
+    }
+
+    if ((!*inout_valid) || (timercmp(time, inout_time, >))) {
+        *inout_time = *time;
+        *inout_valid = true;
+    }
 }
 
 void gamepad_status_init(gamepad_status_t *const stats) {
@@ -74,7 +71,7 @@ void gamepad_status_init(gamepad_status_t *const stats) {
     stats->cross = 0;
     stats->square = 0;
     stats->r3 = 0;
-    stats->r3 = 0;
+    stats->l3 = 0;
     stats->option = 0;
     stats->share = 0;
     stats->center = 0;
@@ -85,143 +82,534 @@ void gamepad_status_init(gamepad_status_t *const stats) {
     stats->motors_intensity[0] = 0;
     stats->motors_intensity[1] = 0;
     stats->rumble_events_count = 0;
-    stats->gyro[0] = 0;
-    stats->gyro[1] = 0;
-    stats->gyro[2] = 0;
-    stats->accel[0] = 0;
-    stats->accel[1] = 0;
-    stats->accel[2] = 0;
+    stats->last_gyro_motion_timestamp_ns = 0;
+    stats->last_accel_motion_timestamp_ns = 0;
+    stats->raw_gyro[0] = 0;
+    stats->raw_gyro[1] = 0;
+    stats->raw_gyro[2] = 0;
+    stats->raw_accel[0] = 0;
+    stats->raw_accel[1] = 0;
+    stats->raw_accel[2] = 0;
     stats->leds_events_count = 0;
     stats->leds_colors[0] = 0;
     stats->leds_colors[1] = 0;
     stats->leds_colors[2] = 0;
+    stats->imu_sampling_rate_hz = 0;
     stats->touchpad_touch_num = -1;
     stats->touchpad_x = 0;
     stats->touchpad_y = 0;
     stats->join_left_analog_and_gyroscope = 0;
     stats->join_right_analog_and_gyroscope = 0;
     stats->flags = 0;
+    stats->dirty = GAMEPAD_STATUS_DIRTY_ALL;
 }
 
 void devices_status_init(devices_status_t *const stats) {
-    pthread_mutex_init(&stats->mutex, NULL);
     gamepad_status_init(&stats->gamepad);
     kbd_status_init(&stats->kbd);
     mouse_status_init(&stats->mouse);
 }
 
-void gamepad_status_qam_quirk(gamepad_status_t *const gamepad_stats) {
-    static struct timeval press_time;
-    if (gamepad_stats->flags & GAMEPAD_STATUS_FLAGS_PRESS_AND_REALEASE_CENTER) {
-        struct timeval now;
-        gettimeofday(&now, NULL);
+void devices_status_release_inputs(devices_status_t *const stats) {
+    gamepad_status_t *const gamepad = &stats->gamepad;
 
-        // Calculate elapsed time in milliseconds
-        const int64_t elapsed_time = (now.tv_sec - press_time.tv_sec) * 1000 +
-                               (now.tv_usec - press_time.tv_usec) / 1000;
+    const uint32_t flags = gamepad->flags;
+    const uint32_t imu_sampling_rate_hz = gamepad->imu_sampling_rate_hz;
+    const uint64_t rumble_events_count = gamepad->rumble_events_count;
+    const uint64_t leds_events_count = gamepad->leds_events_count;
+    uint8_t motors_intensity[2];
+    uint8_t leds_colors[3];
+    memcpy(motors_intensity, gamepad->motors_intensity, sizeof(motors_intensity));
+    memcpy(leds_colors, gamepad->leds_colors, sizeof(leds_colors));
+
+    gamepad_status_init(gamepad);
+
+    gamepad->flags = flags;
+    gamepad->imu_sampling_rate_hz = imu_sampling_rate_hz;
+    gamepad->rumble_events_count = rumble_events_count;
+    gamepad->leds_events_count = leds_events_count;
+    memcpy(gamepad->motors_intensity, motors_intensity, sizeof(motors_intensity));
+    memcpy(gamepad->leds_colors, leds_colors, sizeof(leds_colors));
+
+    // virtual mouse and keyboard send the releases on their next frame
+    kbd_status_init(&stats->kbd);
+    mouse_status_init(&stats->mouse);
+}
+
+static void handle_incoming_message_gamepad_action(
+    const dev_out_settings_t *const in_settings,
+    const in_message_gamepad_action_t *const msg_payload,
+    gamepad_status_t *const inout_gamepad
+) {
+    if (*msg_payload == GAMEPAD_ACTION_PRESS_AND_RELEASE_CENTER) {
+        inout_gamepad->flags |= GAMEPAD_STATUS_FLAGS_PRESS_AND_REALEASE_CENTER;
+    } else if (*msg_payload == GAMEPAD_ACTION_OPEN_STEAM_QAM) {
+        inout_gamepad->flags |= GAMEPAD_STATUS_FLAGS_OPEN_STEAM_QAM;
+    } else if (*msg_payload == GAMEPAD_ACTION_SWITCH_EMULATED_GAMEPAD) {
+        inout_gamepad->flags |= GAMEPAD_STATUS_FLAGS_SWITCH_GAMEPAD;
+    }
+}
+
+static void handle_incoming_message_mouse_event(
+    const dev_out_settings_t *const in_settings,
+    const in_message_mouse_event_t *const msg_payload,
+    mouse_status_t *const inout_mouse
+) {
+    // wrap around instead of overflowing: the shared status keeps running totals
+    if (msg_payload->type == MOUSE_ELEMENT_X) {
+        inout_mouse->x = (int32_t)((uint32_t)inout_mouse->x + (uint32_t)msg_payload->value);
+    } else if (msg_payload->type == MOUSE_ELEMENT_Y) {
+        inout_mouse->y = (int32_t)((uint32_t)inout_mouse->y + (uint32_t)msg_payload->value);
+    } else if (msg_payload->type == MOUSE_BTN_LEFT) {
+        inout_mouse->btn_left = msg_payload->value;
+    } else if (msg_payload->type == MOUSE_BTN_MIDDLE) {
+        inout_mouse->btn_middle = msg_payload->value;
+    } else if (msg_payload->type == MOUSE_BTN_RIGHT) {
+        inout_mouse->btn_right = msg_payload->value;
+    }
+
+    merge_event_time(&inout_mouse->time_valid, &inout_mouse->time, msg_payload->flags, &msg_payload->time);
+}
+
+static uint32_t gamepad_element_dirty_mask(in_gamepad_element_t element) {
+    switch (element) {
+        case GAMEPAD_LEFT_JOYSTICK_X:
+        case GAMEPAD_LEFT_JOYSTICK_Y:
+        case GAMEPAD_RIGHT_JOYSTICK_X:
+        case GAMEPAD_RIGHT_JOYSTICK_Y:
+        case GAMEPAD_BTN_JOIN_LEFT_ANALOG_AND_GYROSCOPE:
+        case GAMEPAD_BTN_JOIN_RIGHT_ANALOG_AND_GYROSCOPE:
+            return GAMEPAD_STATUS_DIRTY_STICKS;
+        case GAMEPAD_BTN_L2_TRIGGER:
+        case GAMEPAD_BTN_R2_TRIGGER:
+            return GAMEPAD_STATUS_DIRTY_TRIGGERS;
+        case GAMEPAD_GYROSCOPE:
+            return GAMEPAD_STATUS_DIRTY_GYRO;
+        case GAMEPAD_ACCELEROMETER:
+            return GAMEPAD_STATUS_DIRTY_ACCEL;
+        case GAMEPAD_TOUCHPAD_TOUCH_ACTIVE:
+        case GAMEPAD_TOUCHPAD_X:
+        case GAMEPAD_TOUCHPAD_Y:
+            return GAMEPAD_STATUS_DIRTY_TOUCHPAD;
+        case GAMEPAD_IMU_SAMPLING_RATE:
+            return 0;
+        default:
+            return GAMEPAD_STATUS_DIRTY_BUTTONS;
+    }
+}
 
-        if (gamepad_stats->center) {
-            // If the center button is pressed and at least X ms have passed
-            if (elapsed_time >= PRESS_AND_RELEASE_DURATION_FOR_CENTER_BUTTON_MS) {
-                gamepad_stats->center = 0;
-                gamepad_stats->flags &= ~GAMEPAD_STATUS_FLAGS_PRESS_AND_REALEASE_CENTER;
+static void handle_incoming_message_gamepad_set(
+    const dev_out_settings_t *const in_settings,
+    const in_message_gamepad_set_element_t *const msg_payload,
+    gamepad_status_t *const inout_gamepad
+) {
+    switch (msg_payload->element) {
+        case GAMEPAD_BTN_CROSS: {
+            if (!in_settings->nintendo_layout) {
+                inout_gamepad->cross = (msg_payload->status.btn != 0);
+            } else {
+                inout_gamepad->circle = (msg_payload->status.btn != 0);
             }
-        } else {
-            // If the center button is pressed
-            gamepad_stats->center = 1;
-            gettimeofday(&press_time, NULL);
-        }
-    } else if (gamepad_stats->flags & GAMEPAD_STATUS_FLAGS_OPEN_STEAM_QAM) {
-        struct timeval now;
-        gettimeofday(&now, NULL);
-
-        static int releasing = 0;
-
-        // Calculate elapsed time in milliseconds
-        int64_t elapsed_time = (now.tv_sec - press_time.tv_sec) * 1000 +
-                               (now.tv_usec - press_time.tv_usec) / 1000;
-
-        if ((gamepad_stats->center) && (!gamepad_stats->cross)) {
-            if ((!releasing) && (elapsed_time >= PRESS_TIME_BEFORE_CROSS_BUTTON_MS)) {
-                gamepad_stats->center = 1;
-                gamepad_stats->cross = 1;
-                press_time = now;
-            } else if ((releasing) && (elapsed_time >= PRESS_TIME_AFTER_CROSS_BUTTON_MS)) {
-                gamepad_stats->center = 0;
-                gamepad_stats->cross = 0;
-                press_time = now;
-                gamepad_stats->flags &= ~GAMEPAD_STATUS_FLAGS_OPEN_STEAM_QAM;
+            
+            break;
+        }
+        case GAMEPAD_BTN_CIRCLE: {
+            if (in_settings->nintendo_layout) {
+                inout_gamepad->cross = (msg_payload->status.btn != 0);
+            } else {
+                inout_gamepad->circle = (msg_payload->status.btn != 0);
+            }
+
+            break;
+        }
+        case GAMEPAD_BTN_SQUARE: {
+            if (in_settings->nintendo_layout) {
+                inout_gamepad->triangle = (msg_payload->status.btn != 0);
+            } else {
+                inout_gamepad->square = (msg_payload->status.btn != 0);
             }
-        } else if ((gamepad_stats->center) && (gamepad_stats->cross)) {
-            if (elapsed_time >= PRESS_TIME_CROSS_BUTTON_MS) {
-                gamepad_stats->center = 1;
-                gamepad_stats->cross = 0;
-                releasing = 1;
-                press_time = now;
+            
+            break;
+        }
+        case GAMEPAD_BTN_TRIANGLE: {
+            if (!in_settings->nintendo_layout) {
+                inout_gamepad->triangle = (msg_payload->status.btn != 0);
+            } else {
+                inout_gamepad->square = (msg_payload->status.btn != 0);
+            }
+
+            break;
+        }
+        case GAMEPAD_BTN_OPTION: {
+            inout_gamepad->option = (msg_payload->status.btn != 0);
+            break;
+        }
+        case GAMEPAD_BTN_SHARE: {
+            inout_gamepad->share = (msg_payload->status.btn != 0);
+            break;
+        }
+        case GAMEPAD_BTN_L1: {
+            inout_gamepad->l1 = (msg_payload->status.btn != 0);
+            break;
+        }
+        case GAMEPAD_BTN_R1: {
+            inout_gamepad->r1 = (msg_payload->status.btn != 0);
+            break;
+        }
+        case GAMEPAD_BTN_L2_TRIGGER: {
+            inout_gamepad->l2_trigger = msg_payload->status.btn;
+            break;
+        }
+        case GAMEPAD_BTN_R2_TRIGGER: {
+            inout_gamepad->r2_trigger = msg_payload->status.btn;
+            break;
+        }
+        case GAMEPAD_BTN_L3: {
+            inout_gamepad->l3 = (msg_payload->status.btn != 0);
+            break;
+        }
+        case GAMEPAD_BTN_R3: {
+            inout_gamepad->r3 = (msg_payload->status.btn != 0);
+            break;
+        }
+        case GAMEPAD_BTN_L4: {
+            inout_gamepad->l4 = (msg_payload->status.btn != 0);
+            break;
+        }
+        case GAMEPAD_BTN_R4: {
+            inout_gamepad->r4 = (msg_payload->status.btn != 0);
+            break;
+        }
+        case GAMEPAD_BTN_L5: {
+            inout_gamepad->l5 = (msg_payload->status.btn != 0);
+            break;
+        }
+        case GAMEPAD_BTN_R5: {
+            inout_gamepad->r5 = (msg_payload->status.btn != 0);
+            break;
+        }
+        case GAMEPAD_BTN_TOUCHPAD: {
+            inout_gamepad->touchpad_press = (msg_payload->status.btn != 0);
+            break;
+        }
+        case GAMEPAD_BTN_JOIN_LEFT_ANALOG_AND_GYROSCOPE: {
+            inout_gamepad->join_left_analog_and_gyroscope = (msg_payload->status.btn != 0);
+            break;
+        }
+        case GAMEPAD_BTN_JOIN_RIGHT_ANALOG_AND_GYROSCOPE: {
+            inout_gamepad->join_right_analog_and_gyroscope = (msg_payload->status.btn != 0);
+            break;
+        }
+        case GAMEPAD_LEFT_JOYSTICK_X: {
+            inout_gamepad->joystick_positions[0][0] = msg_payload->status.joystick_pos;
+            break;
+        }
+        case GAMEPAD_LEFT_JOYSTICK_Y: {
+            inout_gamepad->joystick_positions[0][1] = msg_payload->status.joystick_pos;
+            break;
+        }
+        case GAMEPAD_RIGHT_JOYSTICK_X: {
+            inout_gamepad->joystick_positions[1][0] = msg_payload->status.joystick_pos;
+            break;
+        }
+        case GAMEPAD_RIGHT_JOYSTICK_Y: {
+            inout_gamepad->joystick_positions[1][1] = msg_payload->status.joystick_pos;
+            break;
+        }
+        case GAMEPAD_DPAD_X: {
+            const int8_t v = msg_payload->status.dpad;
+
+            inout_gamepad->dpad &= 0xF0;
+            if (v == 0) {
+                inout_gamepad->dpad |= 0x00;
+            } else if (v == 1) {
+                inout_gamepad->dpad |= 0x01;
+            } else if (v == -1) {
+                inout_gamepad->dpad |= 0x02;
+            }
+
+            break;
+        }
+        case GAMEPAD_DPAD_Y: {
+            const int8_t v = msg_payload->status.dpad;
+
+            inout_gamepad->dpad &= 0x0F;
+            if (v == 0) {
+                inout_gamepad->dpad |= 0x00;
+            } else if (v == 1) {
+                inout_gamepad->dpad |= 0x20;
+            } else if (v == -1) {
+                inout_gamepad->dpad |= 0x10;
             }
-        } else {
-            gamepad_stats->center = 1;
-            gamepad_stats->cross = 0;
-            releasing = 0;
-            gettimeofday(&press_time, NULL);
+
+            break;
+        }
+        case GAMEPAD_GYROSCOPE: {
+            inout_gamepad->last_gyro_motion_timestamp_ns = msg_payload->status.gyro.sample_timestamp_ns;
+            inout_gamepad->raw_gyro[0] = in_settings->invert_x ? (int16_t)(-1) * msg_payload->status.gyro.x : msg_payload->status.gyro.x;
+            inout_gamepad->raw_gyro[1] = in_settings->swap_y_z ? msg_payload->status.gyro.z : msg_payload->status.gyro.y;
+            inout_gamepad->raw_gyro[2] = in_settings->swap_y_z ? msg_payload->status.gyro.y : msg_payload->status.gyro.z;
+            break;
+        }
+        case GAMEPAD_ACCELEROMETER: {
+            inout_gamepad->last_accel_motion_timestamp_ns = msg_payload->status.accel.sample_timestamp_ns;
+            inout_gamepad->raw_accel[0] = in_settings->invert_x ? (int16_t)(-1) * msg_payload->status.accel.x : msg_payload->status.accel.x;
+            inout_gamepad->raw_accel[1] = in_settings->swap_y_z ? msg_payload->status.accel.z : msg_payload->status.accel.y;
+            inout_gamepad->raw_accel[2] = in_settings->swap_y_z ? msg_payload->status.accel.y : msg_payload->status.accel.z;
+            break;
+        }
+        case GAMEPAD_TOUCHPAD_TOUCH_ACTIVE: {
+            inout_gamepad->touchpad_touch_num = msg_payload->status.touchpad_active.status;
+            break;
+        }
+        case GAMEPAD_TOUCHPAD_X: {
+            inout_gamepad->touchpad_x = msg_payload->status.touchpad_x.value;
+            break;
+        }
+        case GAMEPAD_TOUCHPAD_Y: {
+            inout_gamepad->touchpad_y = msg_payload->status.touchpad_y.value;
+            break;
+        }
+        case GAMEPAD_IMU_SAMPLING_RATE: {
+            inout_gamepad->imu_sampling_rate_hz = msg_payload->status.sampling_rate_hz;
+            break;
+        }
+        default: {
+            fprintf(stderr, "Unknown gamepad element: %d\n", msg_payload->element);
+            return;
         }
     }
+
+    inout_gamepad->dirty |= gamepad_element_dirty_mask(msg_payload->element);
 }
 
-void gamepad_status_qam_quirk_ext_time(gamepad_status_t *const gamepad_stats) {
-    static struct timeval press_time;
-    if (gamepad_stats->flags & GAMEPAD_STATUS_FLAGS_PRESS_AND_REALEASE_CENTER) {
-        struct timeval now;
-        gettimeofday(&now, NULL);
+static void handle_incoming_message_keyboard_set(
+    const dev_out_settings_t *const in_settings,
+    const in_message_keyboard_set_element_t *const msg_payload,
+    keyboard_status_t *const inout_kbd
+) {
+    if (kbd_status_set_key(inout_kbd, msg_payload->code, msg_payload->value != 0) != 0) {
+        fprintf(stderr, "key %d not implemented\n", (int)msg_payload->code);
+    }
 
-        // Calculate elapsed time in milliseconds
-        const int64_t elapsed_time = (now.tv_sec - press_time.tv_sec) * 1000 +
-                               (now.tv_usec - press_time.tv_usec) / 1000;
+    merge_event_time(&inout_kbd->time_valid, &inout_kbd->time, msg_payload->flags, &msg_payload->time);
+}
 
-        if (gamepad_stats->center) {
-            // If the center button is pressed and at least X ms have passed
-            if (elapsed_time >= PRESS_AND_RELEASE_DURATION_FOR_CENTER_BUTTON_MS) {
-                gamepad_stats->center = 0;
-                gamepad_stats->flags &= ~GAMEPAD_STATUS_FLAGS_PRESS_AND_REALEASE_CENTER;
-            }
-        } else {
-            // If the center button is pressed
-            gamepad_stats->center = 1;
-            gettimeofday(&press_time, NULL);
-        }
-    } else if (gamepad_stats->flags & GAMEPAD_STATUS_FLAGS_OPEN_STEAM_QAM) {
-        struct timeval now;
-        gettimeofday(&now, NULL);
-
-        static int releasing = 0;
-
-        // Calculate elapsed time in milliseconds
-        int64_t elapsed_time = (now.tv_sec - press_time.tv_sec) * 1000 +
-                               (now.tv_usec - press_time.tv_usec) / 1000;
-
-        if ((gamepad_stats->center) && (!gamepad_stats->cross)) {
-            if ((!releasing) && (elapsed_time >= PRESS_TIME_BEFORE_CROSS_BUTTON_MS)) {
-                gamepad_stats->center = 1;
-                gamepad_stats->cross = 1;
-                press_time = now;
-            } else if ((releasing) && (elapsed_time >= PRESS_TIME_AFTER_CROSS_BUTTON_MS)) {
-                gamepad_stats->center = 0;
-                gamepad_stats->cross = 0;
-                press_time = now;
-                gamepad_stats->flags &= ~GAMEPAD_STATUS_FLAGS_OPEN_STEAM_QAM;
-            }
-        } else if ((gamepad_stats->center) && (gamepad_stats->cross)) {
-            if (elapsed_time >= PRESS_TIME_CROSS_BUTTON_MS) {
-                gamepad_stats->center = 1;
-                gamepad_stats->cross = 0;
-                releasing = 1;
-                press_time = now;
-            }
-        } else {
-            gamepad_stats->center = 1;
-            gamepad_stats->cross = 0;
-            releasing = 0;
-            gettimeofday(&press_time, NULL);
+void devices_status_apply_message(
+    const dev_out_settings_t *const in_settings,
+    const in_message_t *const msg,
+    devices_status_t *const dev_stats
+) {
+    if (msg->type == GAMEPAD_SET_ELEMENT) {
+        handle_incoming_message_gamepad_set(
+            in_settings,
+            &msg->data.gamepad_set,
+            &dev_stats->gamepad
+        );
+    } else if (msg->type == GAMEPAD_ACTION) {
+        handle_incoming_message_gamepad_action(
+            in_settings,
+            &msg->data.action,
+            &dev_stats->gamepad
+        );
+    } else if (msg->type == MOUSE_EVENT) {
+        handle_incoming_message_mouse_event(
+            in_settings,
+            &msg->data.mouse_event,
+            &dev_stats->mouse
+        );
+    } else if (msg->type == KEYBOARD_SET_ELEMENT) {
+        handle_incoming_message_keyboard_set(
+            in_settings,
+            &msg->data.kbd_set,
+            &dev_stats->kbd
+        );
+    }
+}
+
+int devices_status_shared_init(devices_status_shared_t *const shared, const dev_out_settings_t *const settings) {
+    atomic_init(&shared->seq, 0);
+    atomic_init(&shared->dirty, GAMEPAD_STATUS_DIRTY_ALL);
+    atomic_init(&shared->actions, 0);
+    devices_status_init(&shared->status);
+    shared->settings = settings;
+
+    shared->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (shared->wake_fd < 0) {
+        return -errno;
+    }
+
+    return 0;
+}
+
+void devices_status_shared_close(devices_status_shared_t *const shared) {
+    if (shared->wake_fd >= 0) {
+        close(shared->wake_fd);
+        shared->wake_fd = -1;
+    }
+}
+
+static bool message_is_edge(const in_message_t *const msg) {
+    switch (msg->type) {
+        case GAMEPAD_SET_ELEMENT:
+            return gamepad_element_dirty_mask(msg->data.gamepad_set.element) == GAMEPAD_STATUS_DIRTY_BUTTONS;
+        case MOUSE_EVENT:
+            return (msg->data.mouse_event.type != MOUSE_ELEMENT_X) && (msg->data.mouse_event.type != MOUSE_ELEMENT_Y);
+        case GAMEPAD_ACTION:
+        case KEYBOARD_SET_ELEMENT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void devices_status_shared_publish(
+    devices_status_shared_t *const shared,
+    const in_message_t *const msgs,
+    size_t msgs_count
+) {
+    bool edge = false;
+
+    const unsigned int seq = atomic_load_explicit(&shared->seq, memory_order_relaxed);
+    atomic_store_explicit(&shared->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (size_t i = 0; i < msgs_count; ++i) {
+        devices_status_apply_message(shared->settings, &msgs[i], &shared->status);
+        edge = edge || message_is_edge(&msgs[i]);
+    }
+
+    // only the writer touches these two inside status: move them where the reader can consume them
+    const uint32_t dirty = shared->status.gamepad.dirty;
+    const uint32_t actions = shared->status.gamepad.flags;
+    shared->status.gamepad.dirty = 0;
+
+    // flags live on the cold line: storing a zero there on every IMU sample would take it from the reader
+    if (actions != 0) {
+        shared->status.gamepad.flags = 0;
+    }
+
+    atomic_store_explicit(&shared->seq, seq + 2, memory_order_release);
+
+    if (dirty != 0) {
+        atomic_fetch_or_explicit(&shared->dirty, dirty, memory_order_release);
+    }
+
+    if (actions != 0) {
+        atomic_fetch_or_explicit(&shared->actions, actions, memory_order_release);
+    }
+
+    if ((edge) && (shared->wake_fd >= 0)) {
+        const uint64_t wake = 1;
+        if (write(shared->wake_fd, &wake, sizeof(wake)) != sizeof(wake)) {
+            // EAGAIN: the counter is saturated and the reader already has a wakeup pending
+        }
+    }
+}
+
+static unsigned int devices_status_shared_snapshot(devices_status_shared_t *const shared, devices_status_t *const out_stats) {
+    for (;;) {
+        const unsigned int begin = atomic_load_explicit(&shared->seq, memory_order_acquire);
+        if (begin & 1U) {
+            continue;
+        }
+
+        memcpy(out_stats, &shared->status, sizeof(devices_status_t));
+        atomic_thread_fence(memory_order_acquire);
+
+        if (atomic_load_explicit(&shared->seq, memory_order_relaxed) == begin) {
+            return begin;
         }
     }
 }
+
+/**
+ * Hand a source event time published by the writer over to the reader once: the writer keeps it valid
+ * for good, the reader clears it after every frame it sends.
+ */
+static void handover_event_time(
+    bool published_valid,
+    const struct timeval *const published_time,
+    bool *const inout_consumed_valid,
+    struct timeval *const inout_consumed_time,
+    bool *const out_valid,
+    struct timeval *const out_time
+) {
+    if ((!published_valid) || ((*inout_consumed_valid) && (!timercmp(published_time, inout_consumed_time, >)))) {
+        return;
+    }
+
+    *inout_consumed_valid = true;
+    *inout_consumed_time = *published_time;
+    *out_valid = true;
+    *out_time = *published_time;
+}
+
+void devices_status_shared_sync(
+    devices_status_shared_t *const shared,
+    devices_status_shared_reader_t *const reader,
+    devices_status_t *const inout_stats
+) {
+    // consumed before the snapshot: a group published in between stays pending and is only composed twice
+    const uint32_t dirty = atomic_exchange_explicit(&shared->dirty, 0, memory_order_acquire);
+    const uint32_t actions = atomic_exchange_explicit(&shared->actions, 0, memory_order_acquire);
+
+    inout_stats->gamepad.flags |= actions;
+
+    if (atomic_load_explicit(&shared->seq, memory_order_acquire) == reader->seq) {
+        inout_stats->gamepad.dirty |= dirty;
+        return;
+    }
+
+    devices_status_t snapshot;
+    reader->seq = devices_status_shared_snapshot(shared, &snapshot);
+
+    gamepad_status_t *const gamepad = &inout_stats->gamepad;
+    const uint32_t flags = gamepad->flags;
+    const uint32_t local_dirty = gamepad->dirty;
+    const uint64_t rumble_events_count = gamepad->rumble_events_count;
+    const uint64_t leds_events_count = gamepad->leds_events_count;
+    uint8_t motors_intensity[2];
+    uint8_t leds_colors[3];
+    memcpy(motors_intensity, gamepad->motors_intensity, sizeof(motors_intensity));
+    memcpy(leds_colors, gamepad->leds_colors, sizeof(leds_colors));
+
+    memcpy(gamepad, &snapshot.gamepad, sizeof(gamepad_status_t));
+
+    gamepad->flags = flags;
+    gamepad->dirty = local_dirty | dirty;
+    gamepad->rumble_events_count = rumble_events_count;
+    gamepad->leds_events_count = leds_events_count;
+    memcpy(gamepad->motors_intensity, motors_intensity, sizeof(motors_intensity));
+    memcpy(gamepad->leds_colors, leds_colors, sizeof(leds_colors));
+
+    const bool kbd_time_valid = inout_stats->kbd.time_valid;
+    const struct timeval kbd_time = inout_stats->kbd.time;
+    inout_stats->kbd = snapshot.kbd;
+    inout_stats->kbd.time_valid = kbd_time_valid;
+    inout_stats->kbd.time = kbd_time;
+    handover_event_time(
+        snapshot.kbd.time_valid,
+        &snapshot.kbd.time,
+        &reader->kbd_time_valid,
+        &reader->kbd_time,
+        &inout_stats->kbd.time_valid,
+        &inout_stats->kbd.time
+    );
+
+    inout_stats->mouse.btn_left = snapshot.mouse.btn_left;
+    inout_stats->mouse.btn_middle = snapshot.mouse.btn_middle;
+    inout_stats->mouse.btn_right = snapshot.mouse.btn_right;
+    inout_stats->mouse.x += (int32_t)((uint32_t)snapshot.mouse.x - (uint32_t)reader->mouse_x);
+    inout_stats->mouse.y += (int32_t)((uint32_t)snapshot.mouse.y - (uint32_t)reader->mouse_y);
+    reader->mouse_x = snapshot.mouse.x;
+    reader->mouse_y = snapshot.mouse.y;
+    handover_event_time(
+        snapshot.mouse.time_valid,
+        &snapshot.mouse.time,
+        &reader->mouse_time_valid,
+        &reader->mouse_time,
+        &inout_stats->mouse.time_valid,
+        &inout_stats->mouse.time
+    );
+}
@@ -1,87 +1,120 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <pthread.h>
 #include <sys/time.h>
+#include <stdatomic.h>
+
+#include "message.h"
+#include "settings.h"
 
 #define GAMEPAD_STATUS_FLAGS_PRESS_AND_REALEASE_CENTER  0x00000001U
 #define GAMEPAD_STATUS_FLAGS_OPEN_STEAM_QAM             0x00000002U
+#define GAMEPAD_STATUS_FLAGS_SWITCH_GAMEPAD             0x00000004U
+
+// gamepad_status_t.dirty: which groups of properties changed since the virtual gamepad last composed a report
+#define GAMEPAD_STATUS_DIRTY_STICKS                     0x00000001U
+#define GAMEPAD_STATUS_DIRTY_TRIGGERS                   0x00000002U
+#define GAMEPAD_STATUS_DIRTY_BUTTONS                    0x00000004U
+#define GAMEPAD_STATUS_DIRTY_GYRO                       0x00000008U
+#define GAMEPAD_STATUS_DIRTY_ACCEL                      0x00000010U
+#define GAMEPAD_STATUS_DIRTY_TOUCHPAD                   0x00000020U
+#define GAMEPAD_STATUS_DIRTY_ALL                        0x0000003FU
+
+
+#define DEVICES_STATUS_CACHE_LINE_SIZE 64
+
+/**
+ * Properties are grouped by how often they are written, each group on its own cache line:
+ * the IMU one is rewritten at the sampling frequency and must not invalidate what the
+ * compose path reads for sticks and buttons nor the rarely changing control properties.
+ *
+ * tests/devices_status_bench.c runs a publish/compose loop on two threads to measure it (perf stat -e cache-misses).
+ */
+typedef struct gamepad_status {
+    // hot IMU: written at the IMU sampling frequency
+    _Alignas(DEVICES_STATUS_CACHE_LINE_SIZE) int64_t last_gyro_motion_timestamp_ns;
+    int64_t last_accel_motion_timestamp_ns;
 
-#define PRESS_AND_RELEASE_DURATION_FOR_CENTER_BUTTON_MS     80
-#define PRESS_TIME_BEFORE_CROSS_BUTTON_MS                   250
-#define PRESS_TIME_CROSS_BUTTON_MS                          80
-#define PRESS_TIME_AFTER_CROSS_BUTTON_MS                    180
+    int16_t raw_gyro[3];
+    int16_t raw_accel[3];
 
-typedef struct gamepad_status {
-    bool connected;
+    // hot input: written on every stick, trigger or button change
+    _Alignas(DEVICES_STATUS_CACHE_LINE_SIZE) int32_t joystick_positions[2][2]; // [0 left | 1 right][x axis | y axis]
 
-    int32_t joystick_positions[2][2]; // [0 left | 1 right][x axis | y axis]
+    int16_t touchpad_touch_num; // touchpad is inactive when this is -1
+    int16_t touchpad_x; // 0 to 1920
+    int16_t touchpad_y; // 0 to 1080
 
     uint8_t dpad; // 0x00 x - | 0x01 x -> | 0x02 x <- | 0x00 y - | 0x10 y ^ | 0x10 y . | 
 
     uint8_t l2_trigger;
     uint8_t r2_trigger;
 
-    uint8_t triangle;
-    uint8_t circle;
-    uint8_t cross;
-    uint8_t square;
+    // pressed (1) or released (0)
+    uint8_t triangle : 1;
+    uint8_t circle : 1;
+    uint8_t cross : 1;
+    uint8_t square : 1;
 
-    uint8_t l1;
-    uint8_t r1;
+    uint8_t l1 : 1;
+    uint8_t r1 : 1;
 
-    uint8_t r3;
-    uint8_t l3;
+    uint8_t r3 : 1;
+    uint8_t l3 : 1;
 
-    uint8_t option;
-    uint8_t share;
-    uint8_t center;
+    uint8_t option : 1;
+    uint8_t share : 1;
+    uint8_t center : 1;
 
-    uint8_t l4;
-    uint8_t r4;
-    
-    uint8_t l5;
-    uint8_t r5;
+    uint8_t l4 : 1;
+    uint8_t r4 : 1;
 
-    uint8_t touchpad_press;
+    uint8_t l5 : 1;
+    uint8_t r5 : 1;
 
-    int16_t touchpad_touch_num; // touchpad is inactive when this is -1
-    int16_t touchpad_x; // 0 to 1920
-    int16_t touchpad_y; // 0 to 1080
+    uint8_t touchpad_press : 1;
 
-    int64_t last_gyro_motion_timestamp_ns;
-    int64_t last_accel_motion_timestamp_ns;
+    uint8_t join_left_analog_and_gyroscope : 1;
+    uint8_t join_right_analog_and_gyroscope : 1;
 
-    double gyro[3]; // | x, y, z| right-hand-rules -- in rad/s
-    double accel[3]; // | x, y, z| positive: right, up, towards player -- in m/s^2
+    uint32_t dirty; // GAMEPAD_STATUS_DIRTY_* mask
 
-    int16_t raw_gyro[3];
-    int16_t raw_accel[3];
+    // cold control: written by actions, by games (rumble and leds) or never
+    _Alignas(DEVICES_STATUS_CACHE_LINE_SIZE) volatile uint32_t flags;
 
-    uint64_t rumble_events_count;
-    uint8_t motors_intensity[2]; // 0 = left, 1 = right
+    bool connected;
 
-    uint64_t leds_events_count;
+    uint8_t motors_intensity[2]; // 0 = left, 1 = right
     uint8_t leds_colors[3]; // r | g | b
 
-    uint8_t join_left_analog_and_gyroscope;
-    uint8_t join_right_analog_and_gyroscope;
+    // told by the input client once the IMU sampling frequency has been negotiated, 0 when unknown
+    uint32_t imu_sampling_rate_hz;
 
-    volatile uint32_t flags;
+    uint64_t rumble_events_count;
+    uint64_t leds_events_count;
 
 } gamepad_status_t;
 
-typedef struct keyboard_status {
-    bool connected;
+_Static_assert(offsetof(gamepad_status_t, joystick_positions) == 1 * DEVICES_STATUS_CACHE_LINE_SIZE, "hot input properties must start a new cache line");
+_Static_assert(offsetof(gamepad_status_t, dirty) < 2 * DEVICES_STATUS_CACHE_LINE_SIZE, "hot input properties must fit a single cache line");
+_Static_assert(offsetof(gamepad_status_t, flags) == 2 * DEVICES_STATUS_CACHE_LINE_SIZE, "cold control properties must start a new cache line");
+_Static_assert(sizeof(gamepad_status_t) == 3 * DEVICES_STATUS_CACHE_LINE_SIZE, "gamepad_status_t must span exactly three cache lines");
 
-    uint8_t q,w,e,r,t,y,u,i,o,p,a,s,d,f,g,h,j,k,l,z,x,c,v,b,n,m;
+// keyboard state is a bitset indexed by linux KEY_* code: every key below BTN_MISC fits
+#define KEYBOARD_STATUS_KEYS_COUNT  256
+#define KEYBOARD_STATUS_KEYS_WORDS  (KEYBOARD_STATUS_KEYS_COUNT / 64)
 
-    uint8_t num_1, num_2, num_3, num_4, num_5, num_6, num_7, num_8, num_9, num_0;
+typedef struct keyboard_status {
+    bool connected;
 
-    uint8_t up, down, left, right;
+    uint64_t keys[KEYBOARD_STATUS_KEYS_WORDS]; // bit set = key pressed
 
-    uint8_t lctrl;
+    // newest kernel timestamp among the events merged since the last frame was sent
+    bool time_valid;
+    struct timeval time;
 
 } keyboard_status_t;
 
@@ -96,12 +129,13 @@ typedef struct mouse_status {
     uint8_t btn_middle;
     uint8_t btn_right;
 
+    // newest kernel timestamp among the events merged since the last frame was sent
+    bool time_valid;
+    struct timeval time;
+
 } mouse_status_t;
 
 typedef struct devices_status {
-    // this mutex MUST be grabbed when reading and/or writing below properties
-    pthread_mutex_t mutex;
-
     gamepad_status_t gamepad;
 
     keyboard_status_t kbd;
@@ -114,10 +148,94 @@ void mouse_status_init(mouse_status_t *const stats);
 
 void kbd_status_init(keyboard_status_t *const stats);
 
+int kbd_status_set_key(keyboard_status_t *const stats, uint16_t code, bool pressed);
+
 void gamepad_status_init(gamepad_status_t *const stats);
 
 void devices_status_init(devices_status_t *const stats);
 
-void gamepad_status_qam_quirk(gamepad_status_t *const gamepad_stats);
-
-void gamepad_status_qam_quirk_ext_time(gamepad_status_t *const gamepad_stats);
+/**
+ * Forget everything input clients reported (buttons held, sticks and triggers positions, keys, mouse
+ * buttons) while keeping what describes the device (flags, rumble, leds, IMU sampling rate): used when the
+ * last client feeding the status goes away so that nothing stays stuck until it comes back and sends its state again.
+ */
+void devices_status_release_inputs(devices_status_t *const stats);
+
+/**
+ * Apply an input message to the status: this is what dev_out does for every in_message_t it receives.
+ */
+void devices_status_apply_message(
+    const dev_out_settings_t *const in_settings,
+    const in_message_t *const msg,
+    devices_status_t *const dev_stats
+);
+
+/**
+ * Input state handed from dev_in to dev_out when both run in the same process (allynone): dev_in
+ * applies messages directly and dev_out takes a snapshot when it is about to send its reports.
+ *
+ * There is a single writer and the reader never blocks it: status is guarded by a seqlock
+ * (seq is odd while the writer is updating) and what the reader has to consume exactly once
+ * (dirty groups and requested actions) is handed over with atomics outside of status.
+ *
+ * In status mouse.x and mouse.y are running totals: the reader consumes their difference.
+ */
+typedef struct devices_status_shared {
+    _Alignas(DEVICES_STATUS_CACHE_LINE_SIZE) atomic_uint seq;
+
+    devices_status_t status;
+
+    // written by both threads: kept away from what only the writer touches
+
+    // GAMEPAD_STATUS_DIRTY_* published and not yet consumed by the reader
+    _Alignas(DEVICES_STATUS_CACHE_LINE_SIZE) atomic_uint dirty;
+
+    // GAMEPAD_STATUS_FLAGS_* requested and not yet consumed by the reader
+    atomic_uint actions;
+
+    // written on button edges and actions only: analog and IMU changes wait for the next report
+    int wake_fd;
+
+    // settings of the reader: messages are mapped as the reader would do
+    const dev_out_settings_t *settings;
+} devices_status_shared_t;
+
+/**
+ * Reader side bookkeeping: what of devices_status_shared_t has already been consumed.
+ */
+typedef struct devices_status_shared_reader {
+    unsigned int seq;
+    int32_t mouse_x;
+    int32_t mouse_y;
+
+    // newest source event time already handed to the virtual mouse and keyboard: the writer never clears its own
+    bool mouse_time_valid;
+    struct timeval mouse_time;
+    bool kbd_time_valid;
+    struct timeval kbd_time;
+} devices_status_shared_reader_t;
+
+int devices_status_shared_init(devices_status_shared_t *const shared, const dev_out_settings_t *const settings);
+
+void devices_status_shared_close(devices_status_shared_t *const shared);
+
+/**
+ * Writer side: apply msgs_count messages as a single update and wake the reader if any of them is a button edge.
+ */
+void devices_status_shared_publish(
+    devices_status_shared_t *const shared,
+    const in_message_t *const msgs,
+    size_t msgs_count
+);
+
+/**
+ * Reader side: bring inout_stats up to date with the last consistent state published.
+ *
+ * Properties written by dev_out itself (flags, dirty, rumble and leds) are preserved, mouse movements
+ * are accumulated and the source event time of mouse and keyboard is handed over once, when a newer one is published. Buttons held by a gamepad sequence are forced again right before composing reports.
+ */
+void devices_status_shared_sync(
+    devices_status_shared_t *const shared,
+    devices_status_shared_reader_t *const reader,
+    devices_status_t *const inout_stats
+);
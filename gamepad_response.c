@@ -0,0 +1,193 @@
+#include "gamepad_response.h"
+#include "rogue_enemy.h"
+
+/**
+ * Normalized curve: input and output in 0..1.
+ */
+static double response_curve(const response_curve_settings_t *const in_curve, double t) {
+    const double inner = (double)in_curve->inner_deadzone / 100.0;
+    const double outer = (double)in_curve->outer_deadzone / 100.0;
+    const double anti = (double)in_curve->anti_deadzone / 100.0;
+
+    if (t <= inner) {
+        return 0.0;
+    } else if ((t >= 1.0 - outer) || (inner + outer >= 1.0)) {
+        return 1.0;
+    }
+
+    const double u = (t - inner) / (1.0 - outer - inner);
+
+    return anti + ((1.0 - anti) * pow(u, in_curve->exponent));
+}
+
+static int32_t lookup(const int32_t *const table, size_t entries, int shift, uint32_t value) {
+    const uint32_t idx = value >> shift;
+    if (idx >= entries - 1) {
+        return table[entries - 1];
+    }
+
+    const int32_t frac = (int32_t)(value & ((1U << shift) - 1));
+
+    return table[idx] + (((table[idx + 1] - table[idx]) * frac) >> shift);
+}
+
+static uint32_t isqrt(uint32_t value) {
+    uint32_t res = 0;
+    uint32_t bit = (uint32_t)1 << 30;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+
+    while (bit != 0) {
+        if (value >= res + bit) {
+            value -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+
+        bit >>= 2;
+    }
+
+    return res;
+}
+
+int gamepad_response_compile(gamepad_response_t *const out_response, const dev_out_settings_t *const in_settings) {
+    if ((in_settings->sticks_curve.exponent <= 0.0) ||
+        (in_settings->triggers_curve.exponent <= 0.0) ||
+        (in_settings->gyro_to_analog_exponent <= 0.0) ||
+        (in_settings->gyro_to_analog_mapping == 0)
+    ) {
+        return -EINVAL;
+    }
+
+    out_response->sticks_radial = in_settings->sticks_radial;
+    out_response->gyro_to_sticks = !in_settings->gyro_to_mouse;
+
+    for (size_t i = 0; i < GAMEPAD_RESPONSE_STICK_ENTRIES; ++i) {
+        const double t = (double)(i << GAMEPAD_RESPONSE_STICK_SHIFT) / 32768.0;
+        out_response->sticks[i] = (int32_t)lround(response_curve(&in_settings->sticks_curve, t) * 32768.0);
+    }
+
+    // deadzones, anti-deadzones and exponents below 1 make a step of the input a larger step of the output
+    int64_t max_step = (int64_t)1 << GAMEPAD_RESPONSE_STICK_SHIFT;
+    for (size_t i = 1; i < GAMEPAD_RESPONSE_STICK_ENTRIES; ++i) {
+        const int64_t step = absolute_value((int64_t)out_response->sticks[i] - (int64_t)out_response->sticks[i - 1]);
+        max_step = (step > max_step) ? step : max_step;
+    }
+
+    out_response->sticks_extra_bits = 0;
+    while ((out_response->sticks_extra_bits < 16) && ((((int64_t)1 << GAMEPAD_RESPONSE_STICK_SHIFT) << out_response->sticks_extra_bits) < max_step)) {
+        ++out_response->sticks_extra_bits;
+    }
+
+    for (size_t i = 0; i < sizeof(out_response->triggers); ++i) {
+        const double t = (double)i / 255.0;
+        out_response->triggers[i] = (uint8_t)lround(response_curve(&in_settings->triggers_curve, t) * 255.0);
+    }
+
+    // the gyroscope contribution is expressed in the 8 bits units used by HID gamepads:
+    // the exponent bends it around half of the range so that the default 1.0 keeps the plain division.
+    // The treshold is not part of the table: interpolating across it would move sticks below it
+    const int64_t mapping = absolute_value(in_settings->gyro_to_analog_mapping);
+    out_response->gyro_to_analog_treshold = (uint32_t)min_max_clamp(
+        absolute_value(in_settings->gyro_to_analog_activation_treshold) * mapping,
+        0,
+        UINT32_MAX
+    );
+
+    for (size_t i = 0; i < GAMEPAD_RESPONSE_GYRO_ENTRIES; ++i) {
+        const double contrib = (double)(i << GAMEPAD_RESPONSE_GYRO_SHIFT) / (double)mapping;
+        const double curved = 128.0 * pow(contrib / 128.0, in_settings->gyro_to_analog_exponent);
+        out_response->gyro_to_analog[i] = (int32_t)min_max_clamp(lround(curved * 256.0), 0, 65536);
+    }
+
+    return 0;
+}
+
+static int32_t axial(const gamepad_response_t *const response, int32_t value) {
+    const int32_t magnitude = lookup(
+        response->sticks,
+        GAMEPAD_RESPONSE_STICK_ENTRIES,
+        GAMEPAD_RESPONSE_STICK_SHIFT,
+        (uint32_t)absolute_value(value)
+    );
+
+    return value < 0 ? -magnitude : magnitude;
+}
+
+static void stick(const gamepad_response_t *const response, int32_t x, int32_t y, int32_t out[2]) {
+    x = (int32_t)min_max_clamp(x, -32768, 32767);
+    y = (int32_t)min_max_clamp(y, -32768, 32767);
+
+    if (!response->sticks_radial) {
+        out[0] = axial(response, x);
+        out[1] = axial(response, y);
+        return;
+    }
+
+    // the curve applies to the distance from the center: the direction is preserved
+    const uint32_t magnitude = isqrt((uint32_t)(x * x) + (uint32_t)(y * y));
+    if (magnitude == 0) {
+        out[0] = 0;
+        out[1] = 0;
+        return;
+    }
+
+    const int64_t curved = lookup(
+        response->sticks,
+        GAMEPAD_RESPONSE_STICK_ENTRIES,
+        GAMEPAD_RESPONSE_STICK_SHIFT,
+        magnitude > 32768 ? 32768 : magnitude
+    );
+
+    out[0] = (int32_t)(((int64_t)x * curved) / (int64_t)magnitude);
+    out[1] = (int32_t)(((int64_t)y * curved) / (int64_t)magnitude);
+}
+
+static int32_t gyro(const gamepad_response_t *const response, int16_t value) {
+    const uint32_t magnitude = (uint32_t)absolute_value(value);
+    if (magnitude < response->gyro_to_analog_treshold) {
+        return 0;
+    }
+
+    const int32_t contrib = lookup(
+        response->gyro_to_analog,
+        GAMEPAD_RESPONSE_GYRO_ENTRIES,
+        GAMEPAD_RESPONSE_GYRO_SHIFT,
+        magnitude
+    );
+
+    return value < 0 ? -contrib : contrib;
+}
+
+void gamepad_response_sticks(
+    const gamepad_response_t *const response,
+    const gamepad_status_t *const in_device_status,
+    int32_t out_sticks[2][2]
+) {
+    stick(response, in_device_status->joystick_positions[0][0], in_device_status->joystick_positions[0][1], out_sticks[0]);
+    stick(response, in_device_status->joystick_positions[1][0], in_device_status->joystick_positions[1][1], out_sticks[1]);
+
+    const bool joined[2] = {
+        (response->gyro_to_sticks) && (in_device_status->join_left_analog_and_gyroscope),
+        (response->gyro_to_sticks) && (in_device_status->join_right_analog_and_gyroscope),
+    };
+
+    const int32_t contrib[2] = {
+        gyro(response, in_device_status->raw_gyro[1]),
+        gyro(response, in_device_status->raw_gyro[0]),
+    };
+
+    for (int s = 0; s < 2; ++s) {
+        for (int axis = 0; axis < 2; ++axis) {
+            const int64_t pos = (int64_t)out_sticks[s][axis] + (joined[s] ? (int64_t)contrib[axis] : 0);
+            out_sticks[s][axis] = (int32_t)min_max_clamp(pos, -32768, 32767);
+        }
+    }
+}
+
+uint8_t gamepad_response_trigger(const gamepad_response_t *const response, uint8_t value) {
+    return response->triggers[value];
+}
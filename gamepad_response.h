@@ -0,0 +1,53 @@
+#pragma once
+
+#include "devices_status.h"
+#include "settings.h"
+
+// stick magnitudes (0..32768) are looked up in steps of 1 << GAMEPAD_RESPONSE_STICK_SHIFT
+#define GAMEPAD_RESPONSE_STICK_SHIFT 5
+#define GAMEPAD_RESPONSE_STICK_ENTRIES ((32768 >> GAMEPAD_RESPONSE_STICK_SHIFT) + 1)
+
+// gyroscope readings (0..32768 in absolute value) are looked up in steps of 1 << GAMEPAD_RESPONSE_GYRO_SHIFT
+#define GAMEPAD_RESPONSE_GYRO_SHIFT 4
+#define GAMEPAD_RESPONSE_GYRO_ENTRIES ((32768 >> GAMEPAD_RESPONSE_GYRO_SHIFT) + 1)
+
+/**
+ * Response curves of sticks, triggers and gyro-to-analog compiled into lookup tables once settings are known:
+ * composing a report costs a lookup (and a linear interpolation between two entries) whatever the curve.
+ *
+ * Read-only once compiled: it is shared by every emulated gamepad.
+ */
+typedef struct gamepad_response {
+    bool sticks_radial;
+
+    // stick magnitude to output magnitude, both 0..32768
+    int32_t sticks[GAMEPAD_RESPONSE_STICK_ENTRIES];
+
+    // log2 of the steepest slope of the stick curve, rounded up: input bits it spreads over a single output step
+    uint8_t sticks_extra_bits;
+
+    uint8_t triggers[256];
+
+    // false when join buttons drive the mouse pointer instead (see gyro_mouse_t)
+    bool gyro_to_sticks;
+
+    // gyroscope readings (absolute value) below this do not move sticks
+    uint32_t gyro_to_analog_treshold;
+
+    // gyroscope reading (absolute value) to stick displacement, in 16 bits stick units
+    int32_t gyro_to_analog[GAMEPAD_RESPONSE_GYRO_ENTRIES];
+} gamepad_response_t;
+
+int gamepad_response_compile(gamepad_response_t *const out_response, const dev_out_settings_t *const in_settings);
+
+/**
+ * Sticks positions of in_device_status after the stick curve and, where joined, the gyroscope contribution:
+ * values are in the -32768..32767 range, indexed as gamepad_status_t.joystick_positions.
+ */
+void gamepad_response_sticks(
+    const gamepad_response_t *const response,
+    const gamepad_status_t *const in_device_status,
+    int32_t out_sticks[2][2]
+);
+
+uint8_t gamepad_response_trigger(const gamepad_response_t *const response, uint8_t value);
@@ -0,0 +1,200 @@
+#include "gamepad_sequence.h"
+
+#include <errno.h>
+
+#define PRESS_AND_RELEASE_DURATION_FOR_CENTER_BUTTON_MS     80
+#define PRESS_TIME_BEFORE_CROSS_BUTTON_MS                   250
+#define PRESS_TIME_CROSS_BUTTON_MS                          80
+#define PRESS_TIME_AFTER_CROSS_BUTTON_MS                    180
+
+static const gamepad_sequence_step_t press_and_release_center_steps[] = {
+    { .delay_ms = 0, .btn = GAMEPAD_SEQUENCE_BTN_CENTER, .pressed = true },
+    { .delay_ms = PRESS_AND_RELEASE_DURATION_FOR_CENTER_BUTTON_MS, .btn = GAMEPAD_SEQUENCE_BTN_CENTER, .pressed = false },
+};
+
+const gamepad_sequence_t gamepad_sequence_press_and_release_center = {
+    .name = "press and release center",
+    .steps = press_and_release_center_steps,
+    .steps_count = sizeof(press_and_release_center_steps) / sizeof(press_and_release_center_steps[0]),
+};
+
+// steam opens the quick access menu on center + cross
+static const gamepad_sequence_step_t open_steam_qam_steps[] = {
+    { .delay_ms = 0, .btn = GAMEPAD_SEQUENCE_BTN_CENTER, .pressed = true },
+    { .delay_ms = PRESS_TIME_BEFORE_CROSS_BUTTON_MS, .btn = GAMEPAD_SEQUENCE_BTN_CROSS, .pressed = true },
+    { .delay_ms = PRESS_TIME_CROSS_BUTTON_MS, .btn = GAMEPAD_SEQUENCE_BTN_CROSS, .pressed = false },
+    { .delay_ms = PRESS_TIME_AFTER_CROSS_BUTTON_MS, .btn = GAMEPAD_SEQUENCE_BTN_CENTER, .pressed = false },
+};
+
+const gamepad_sequence_t gamepad_sequence_open_steam_qam = {
+    .name = "open steam QAM",
+    .steps = open_steam_qam_steps,
+    .steps_count = sizeof(open_steam_qam_steps) / sizeof(open_steam_qam_steps[0]),
+};
+
+static int64_t timespec_to_ns(const struct timespec *const ts) {
+    return ((int64_t)ts->tv_sec * (int64_t)1000000000) + (int64_t)ts->tv_nsec;
+}
+
+static bool gamepad_sequence_set_btn(gamepad_status_t *const inout_gamepad, gamepad_sequence_btn_t btn, bool pressed) {
+    const uint8_t value = pressed ? 1 : 0;
+    uint8_t prev = 0;
+
+    switch (btn) {
+        case GAMEPAD_SEQUENCE_BTN_CENTER:
+            prev = inout_gamepad->center;
+            inout_gamepad->center = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_CROSS:
+            prev = inout_gamepad->cross;
+            inout_gamepad->cross = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_CIRCLE:
+            prev = inout_gamepad->circle;
+            inout_gamepad->circle = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_SQUARE:
+            prev = inout_gamepad->square;
+            inout_gamepad->square = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_TRIANGLE:
+            prev = inout_gamepad->triangle;
+            inout_gamepad->triangle = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_OPTION:
+            prev = inout_gamepad->option;
+            inout_gamepad->option = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_SHARE:
+            prev = inout_gamepad->share;
+            inout_gamepad->share = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_L1:
+            prev = inout_gamepad->l1;
+            inout_gamepad->l1 = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_R1:
+            prev = inout_gamepad->r1;
+            inout_gamepad->r1 = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_L3:
+            prev = inout_gamepad->l3;
+            inout_gamepad->l3 = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_R3:
+            prev = inout_gamepad->r3;
+            inout_gamepad->r3 = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_L4:
+            prev = inout_gamepad->l4;
+            inout_gamepad->l4 = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_R4:
+            prev = inout_gamepad->r4;
+            inout_gamepad->r4 = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_L5:
+            prev = inout_gamepad->l5;
+            inout_gamepad->l5 = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_R5:
+            prev = inout_gamepad->r5;
+            inout_gamepad->r5 = value;
+            break;
+        case GAMEPAD_SEQUENCE_BTN_TOUCHPAD:
+            prev = inout_gamepad->touchpad_press;
+            inout_gamepad->touchpad_press = value;
+            break;
+        default:
+            return false;
+    }
+
+    return prev != value;
+}
+
+void gamepad_sequencer_init(gamepad_sequencer_t *const sequencer) {
+    sequencer->sequence = NULL;
+    sequencer->next_step = 0;
+    sequencer->next_step_ns = 0;
+    sequencer->held_mask = 0;
+    sequencer->pressed_mask = 0;
+}
+
+bool gamepad_sequencer_active(const gamepad_sequencer_t *const sequencer) {
+    return sequencer->sequence != NULL;
+}
+
+int gamepad_sequencer_start(
+    gamepad_sequencer_t *const sequencer,
+    const gamepad_sequence_t *const sequence,
+    const struct timespec *const now
+) {
+    if (gamepad_sequencer_active(sequencer)) {
+        return -EBUSY;
+    } else if ((sequence == NULL) || (sequence->steps_count == 0)) {
+        return -EINVAL;
+    }
+
+    sequencer->sequence = sequence;
+    sequencer->next_step = 0;
+    sequencer->next_step_ns = timespec_to_ns(now) + ((int64_t)sequence->steps[0].delay_ms * (int64_t)1000000);
+    sequencer->held_mask = 0;
+    sequencer->pressed_mask = 0;
+
+    return 0;
+}
+
+void gamepad_sequencer_run(
+    gamepad_sequencer_t *const sequencer,
+    gamepad_status_t *const inout_gamepad,
+    const struct timespec *const now
+) {
+    if (!gamepad_sequencer_active(sequencer)) {
+        return;
+    }
+
+    const int64_t now_ns = timespec_to_ns(now);
+
+    // delays count from when a step has actually been sent: every press lasts at least what was asked
+    uint32_t applied_mask = 0;
+    while ((sequencer->next_step < sequencer->sequence->steps_count) && (now_ns >= sequencer->next_step_ns)) {
+        const gamepad_sequence_step_t *const step = &sequencer->sequence->steps[sequencer->next_step];
+        const uint32_t mask = (uint32_t)1 << step->btn;
+
+        // a button changing twice before a report would never be seen: leave the second change to the next one
+        if (applied_mask & mask) {
+            break;
+        }
+        applied_mask |= mask;
+
+        sequencer->held_mask |= mask;
+        if (step->pressed) {
+            sequencer->pressed_mask |= mask;
+        } else {
+            sequencer->pressed_mask &= ~mask;
+        }
+
+        ++sequencer->next_step;
+        if (sequencer->next_step < sequencer->sequence->steps_count) {
+            sequencer->next_step_ns = now_ns + ((int64_t)sequencer->sequence->steps[sequencer->next_step].delay_ms * (int64_t)1000000);
+        }
+    }
+
+    // input clients may have written these buttons since the last report: the sequence wins
+    bool changed = false;
+    for (int btn = 0; btn < GAMEPAD_SEQUENCE_BTN_COUNT; ++btn) {
+        const uint32_t mask = (uint32_t)1 << btn;
+        if (sequencer->held_mask & mask) {
+            changed = gamepad_sequence_set_btn(inout_gamepad, (gamepad_sequence_btn_t)btn, (sequencer->pressed_mask & mask) != 0) || changed;
+        }
+    }
+
+    if (changed) {
+        inout_gamepad->dirty |= GAMEPAD_STATUS_DIRTY_BUTTONS;
+    }
+
+    // the last step has just been sent: buttons go back to input clients from the next report
+    if (sequencer->next_step >= sequencer->sequence->steps_count) {
+        gamepad_sequencer_init(sequencer);
+    }
+}
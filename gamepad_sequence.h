@@ -0,0 +1,97 @@
+#pragma once
+
+#include "devices_status.h"
+
+#include <time.h>
+
+// digital buttons of gamepad_status_t a sequence can drive
+typedef enum gamepad_sequence_btn {
+    GAMEPAD_SEQUENCE_BTN_CENTER,
+    GAMEPAD_SEQUENCE_BTN_CROSS,
+    GAMEPAD_SEQUENCE_BTN_CIRCLE,
+    GAMEPAD_SEQUENCE_BTN_SQUARE,
+    GAMEPAD_SEQUENCE_BTN_TRIANGLE,
+    GAMEPAD_SEQUENCE_BTN_OPTION,
+    GAMEPAD_SEQUENCE_BTN_SHARE,
+    GAMEPAD_SEQUENCE_BTN_L1,
+    GAMEPAD_SEQUENCE_BTN_R1,
+    GAMEPAD_SEQUENCE_BTN_L3,
+    GAMEPAD_SEQUENCE_BTN_R3,
+    GAMEPAD_SEQUENCE_BTN_L4,
+    GAMEPAD_SEQUENCE_BTN_R4,
+    GAMEPAD_SEQUENCE_BTN_L5,
+    GAMEPAD_SEQUENCE_BTN_R5,
+    GAMEPAD_SEQUENCE_BTN_TOUCHPAD,
+} gamepad_sequence_btn_t;
+
+#define GAMEPAD_SEQUENCE_BTN_COUNT (GAMEPAD_SEQUENCE_BTN_TOUCHPAD + 1)
+
+typedef struct gamepad_sequence_step {
+    // time to wait after the previous step has been applied
+    uint32_t delay_ms;
+
+    gamepad_sequence_btn_t btn;
+
+    bool pressed;
+} gamepad_sequence_step_t;
+
+/**
+ * A macro played on the emulated gamepad: buttons of gamepad_status_t are pressed and released
+ * following a timeline, whatever input clients report for them in the meantime.
+ *
+ * Buttons are the ones of the emulated gamepad: layout settings (i.e. nintendo_layout) do not apply.
+ */
+typedef struct gamepad_sequence {
+    const char *name;
+
+    const gamepad_sequence_step_t *steps;
+
+    size_t steps_count;
+} gamepad_sequence_t;
+
+extern const gamepad_sequence_t gamepad_sequence_press_and_release_center;
+
+extern const gamepad_sequence_t gamepad_sequence_open_steam_qam;
+
+/**
+ * Plays one gamepad_sequence_t at a time: it is only ever looked at when a sequence is active.
+ */
+typedef struct gamepad_sequencer {
+    // NULL when no sequence is being played
+    const gamepad_sequence_t *sequence;
+
+    size_t next_step;
+
+    // CLOCK_MONOTONIC time the next step is due at
+    int64_t next_step_ns;
+
+    // buttons held by the sequence: they override what input clients report
+    uint32_t held_mask;
+    uint32_t pressed_mask;
+} gamepad_sequencer_t;
+
+void gamepad_sequencer_init(gamepad_sequencer_t *const sequencer);
+
+bool gamepad_sequencer_active(const gamepad_sequencer_t *const sequencer);
+
+/**
+ * Start playing sequence: its first step is due right away.
+ *
+ * Returns -EBUSY if another sequence is still being played.
+ */
+int gamepad_sequencer_start(
+    gamepad_sequencer_t *const sequencer,
+    const gamepad_sequence_t *const sequence,
+    const struct timespec *const now
+);
+
+/**
+ * Apply every step due at now, then force buttons held by the sequence into inout_gamepad:
+ * to be called right before composing a report, steps are therefore sent with reports.
+ * Marks buttons dirty when the report changes.
+ */
+void gamepad_sequencer_run(
+    gamepad_sequencer_t *const sequencer,
+    gamepad_status_t *const inout_gamepad,
+    const struct timespec *const now
+);
@@ -0,0 +1,98 @@
+#include "gyro_mouse.h"
+#include "rogue_enemy.h"
+
+// 100 degrees per second expressed in gyroscope LSB (2000 deg/s full scale)
+#define GYRO_MOUSE_ACCELERATION_REF_LSB ((int64_t)1638)
+
+// a report coming late (or the first one after a pause) never moves the pointer more than this worth of rotation
+#define GYRO_MOUSE_MAX_INTERVAL_US ((int64_t)50000)
+
+static int64_t timespec_to_ns(const struct timespec *const ts) {
+    return ((int64_t)ts->tv_sec * (int64_t)1000000000) + (int64_t)ts->tv_nsec;
+}
+
+int gyro_mouse_init(gyro_mouse_t *const out_gyro_mouse, const dev_out_settings_t *const in_settings) {
+    memset(out_gyro_mouse, 0, sizeof(gyro_mouse_t));
+
+    out_gyro_mouse->enabled = in_settings->gyro_to_mouse;
+    out_gyro_mouse->ratchet = in_settings->gyro_to_mouse_ratchet;
+
+    if (!out_gyro_mouse->enabled) {
+        return 0;
+    }
+
+    if ((in_settings->gyro_to_mouse_sensitivity <= 0.0) || (in_settings->gyro_to_mouse_acceleration < 0.0)) {
+        out_gyro_mouse->enabled = false;
+        return -EINVAL;
+    }
+
+    const double deg_per_lsb = LSB_PER_RAD_S_2000_DEG_S * 180.0 / M_PI;
+    out_gyro_mouse->speed_q16 = (int64_t)llround(in_settings->gyro_to_mouse_sensitivity * deg_per_lsb * 65536.0);
+    out_gyro_mouse->acceleration_q16 = (int64_t)llround(in_settings->gyro_to_mouse_acceleration * 65536.0);
+
+    return 0;
+}
+
+static int32_t gyro_mouse_take_pixels(int64_t *const inout_remainder_q16) {
+    // truncation towards zero: noise around zero does not drift the pointer in one direction
+    const int64_t pixels = *inout_remainder_q16 / (int64_t)65536;
+    *inout_remainder_q16 -= pixels * (int64_t)65536;
+
+    return (int32_t)pixels;
+}
+
+void gyro_mouse_run(
+    gyro_mouse_t *const gyro_mouse,
+    const gamepad_status_t *const in_gamepad,
+    mouse_status_t *const inout_mouse,
+    const struct timespec *const now
+) {
+    if (!gyro_mouse->enabled) {
+        return;
+    }
+
+    const bool join = (in_gamepad->join_left_analog_and_gyroscope) || (in_gamepad->join_right_analog_and_gyroscope);
+    if ((join) && (!gyro_mouse->join_pressed)) {
+        gyro_mouse->toggled = !gyro_mouse->toggled;
+    }
+    gyro_mouse->join_pressed = join;
+
+    const bool active = gyro_mouse->ratchet ? !join : gyro_mouse->toggled;
+    if (!active) {
+        gyro_mouse->last_ns = 0;
+        gyro_mouse->remainder_q16[0] = 0;
+        gyro_mouse->remainder_q16[1] = 0;
+        return;
+    }
+
+    const int64_t now_ns = timespec_to_ns(now);
+    if (gyro_mouse->last_ns == 0) {
+        gyro_mouse->last_ns = now_ns;
+        return;
+    }
+
+    const int64_t interval_us = min_max_clamp((now_ns - gyro_mouse->last_ns) / (int64_t)1000, 0, GYRO_MOUSE_MAX_INTERVAL_US);
+    gyro_mouse->last_ns = now_ns;
+
+    // same axes used to join the gyroscope to sticks
+    const int64_t rotation[2] = {
+        in_gamepad->raw_gyro[1],
+        in_gamepad->raw_gyro[0],
+    };
+
+    const int64_t rotation_speed = absolute_value(rotation[0]) > absolute_value(rotation[1]) ?
+        absolute_value(rotation[0]) :
+        absolute_value(rotation[1]);
+
+    const int64_t gain_q16 = (int64_t)65536 + ((gyro_mouse->acceleration_q16 * rotation_speed) / GYRO_MOUSE_ACCELERATION_REF_LSB);
+
+    int32_t pixels[2];
+    for (int axis = 0; axis < 2; ++axis) {
+        const int64_t pixels_per_s_q16 = (rotation[axis] * gyro_mouse->speed_q16 * gain_q16) / (int64_t)65536;
+        gyro_mouse->remainder_q16[axis] += (pixels_per_s_q16 * interval_us) / (int64_t)1000000;
+        pixels[axis] = gyro_mouse_take_pixels(&gyro_mouse->remainder_q16[axis]);
+    }
+
+    inout_mouse->x = (int32_t)((uint32_t)inout_mouse->x + (uint32_t)pixels[0]);
+    inout_mouse->y = (int32_t)((uint32_t)inout_mouse->y + (uint32_t)pixels[1]);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "devices_status.h"
+#include "settings.h"
+
+#include <time.h>
+
+/**
+ * Integrates the gyroscope rotation speed into mouse pointer movements, at the mouse report cadence.
+ *
+ * Movements are accumulated in fixed point (1/65536 of a pixel): whatever is left of a pixel is carried over
+ * to the next report instead of being lost, so slow rotations still move the pointer.
+ */
+typedef struct gyro_mouse {
+    bool enabled;
+
+    bool ratchet;
+
+    // toggle state: only used when not in ratchet mode
+    bool toggled;
+
+    // join buttons state at the last run, to toggle on presses only
+    bool join_pressed;
+
+    // pixels per second (16.16 fixed point) for each gyroscope LSB
+    int64_t speed_q16;
+
+    // sensitivity (16.16 fixed point) added for every GYRO_MOUSE_ACCELERATION_REF_LSB of rotation speed
+    int64_t acceleration_q16;
+
+    // sub-pixel movement not yet sent (16.16 fixed point)
+    int64_t remainder_q16[2];
+
+    // CLOCK_MONOTONIC time movements have been integrated up to, 0 when the gyro mouse is not active
+    int64_t last_ns;
+} gyro_mouse_t;
+
+int gyro_mouse_init(gyro_mouse_t *const out_gyro_mouse, const dev_out_settings_t *const in_settings);
+
+/**
+ * Add to inout_mouse the pointer movement of the rotation since the last call:
+ * to be called right before sending a mouse report. Does nothing unless enabled in settings.
+ */
+void gyro_mouse_run(
+    gyro_mouse_t *const gyro_mouse,
+    const gamepad_status_t *const in_gamepad,
+    mouse_status_t *const inout_mouse,
+    const struct timespec *const now
+);
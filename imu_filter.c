@@ -0,0 +1,299 @@
+#include "imu_filter.h"
+#include "rogue_enemy.h"
+
+// period assumed until two samples with increasing timestamps are seen (800Hz)
+#define IMU_FILTER_DEFAULT_PERIOD_US ((int64_t)1250)
+
+// 1-euro: cutoff frequency of the speed estimation
+#define IMU_FILTER_SPEED_CUTOFF_MHZ ((int64_t)1000)
+
+// bounds keeping the 1-euro arithmetic in 64 bits: LSB per second and 10kHz
+#define IMU_FILTER_MAX_SPEED ((int64_t)1000000000)
+#define IMU_FILTER_MAX_CUTOFF_MHZ ((int64_t)10000000)
+
+// 2 * pi with 12 fractional bits
+#define IMU_FILTER_TWO_PI_Q12 ((int64_t)25736)
+
+// the device is still while gyroscope readings stay this close (in LSB) to their average...
+#define IMU_FILTER_STILL_NOISE ((int32_t)24)
+
+// ...and under this speed (in LSB, about 4 deg/s): past it the reading is a rotation, not an offset
+#define IMU_FILTER_MAX_BIAS ((int32_t)64)
+
+// ...and the accelerometer stays within this (in hundredths of g) of where it was when the device stopped...
+#define IMU_FILTER_ACCEL_STILL_PERCENT ((int64_t)3)
+
+// ...and measures a gravity within this (in hundredths of g) of 1g
+#define IMU_FILTER_ACCEL_GRAVITY_PERCENT ((int64_t)10)
+
+// the offset is only learnt after being still for this long...
+#define IMU_FILTER_STILL_US ((int64_t)1000000)
+
+// ...and with this time constant: a slow aim that got mistaken for stillness is barely learnt
+#define IMU_FILTER_BIAS_TAU_US ((int64_t)4000000)
+
+static int64_t hz_to_mhz(double hz) {
+    return (int64_t)llround(hz * 1000.0);
+}
+
+int imu_filter_init(imu_filter_t *const out_filter, const dev_in_settings_t *const in_settings) {
+    memset(out_filter, 0, sizeof(imu_filter_t));
+
+    if (in_settings->imu_filter > IMU_FILTER_BIQUAD) {
+        return -EINVAL;
+    }
+
+    out_filter->type = in_settings->imu_filter;
+    out_filter->min_cutoff_mhz = hz_to_mhz(in_settings->imu_filter_min_cutoff_hz);
+    out_filter->beta_mhz = hz_to_mhz(in_settings->imu_filter_beta);
+    out_filter->cutoff_mhz = hz_to_mhz(in_settings->imu_filter_cutoff_hz);
+    out_filter->bias.enabled = in_settings->gyro_bias_estimation;
+    out_filter->bias.one_g = (int32_t)lround(9.80665 / LSB_PER_16G);
+
+    if ((out_filter->type != IMU_FILTER_NONE) && ((out_filter->min_cutoff_mhz <= 0) || (out_filter->cutoff_mhz <= 0))) {
+        out_filter->type = IMU_FILTER_NONE;
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+/**
+ * Smoothing factor (16 fractional bits) of an exponential filter with the given cutoff frequency:
+ * dt / (dt + tau) with tau = 1 / (2 * pi * cutoff)
+ */
+static int64_t imu_filter_alpha_q16(int64_t period_us, int64_t cutoff_mhz) {
+    // period_us * cutoff_mhz is in units of 1e-9
+    const int64_t w = (period_us * cutoff_mhz * IMU_FILTER_TWO_PI_Q12) >> 12;
+
+    return (w << 16) / (w + (int64_t)1000000000);
+}
+
+static void imu_filter_one_euro(const imu_filter_t *const filter, imu_filter_sensor_t *const sensor, int32_t inout_q8[3]) {
+    const int64_t period_us = sensor->period_us;
+
+    // what only depends on the period is computed once for every sampling frequency
+    if (sensor->one_euro_period_us != period_us) {
+        sensor->one_euro_period_us = period_us;
+        sensor->rate_q16 = ((int64_t)1000000 << 16) / period_us;
+        sensor->speed_alpha_q16 = imu_filter_alpha_q16(period_us, IMU_FILTER_SPEED_CUTOFF_MHZ);
+    }
+
+    for (int axis = 0; axis < 3; ++axis) {
+        const int64_t diff_q8 = (int64_t)inout_q8[axis] - (int64_t)sensor->value_q8[axis];
+
+        const int64_t speed_q8 = (diff_q8 * sensor->rate_q16) >> 16;
+        sensor->speed_q8[axis] += (((speed_q8 - sensor->speed_q8[axis]) * sensor->speed_alpha_q16) >> 16);
+
+        // the faster the reading changes the higher the cutoff: less lag when moving, less jitter at rest
+        const int64_t speed = min_max_clamp(absolute_value(sensor->speed_q8[axis]) >> 8, 0, IMU_FILTER_MAX_SPEED);
+        const int64_t cutoff_mhz = min_max_clamp(
+            filter->min_cutoff_mhz + ((filter->beta_mhz * speed) / (int64_t)1000),
+            0,
+            IMU_FILTER_MAX_CUTOFF_MHZ
+        );
+        const int64_t alpha_q16 = imu_filter_alpha_q16(period_us, cutoff_mhz);
+
+        sensor->value_q8[axis] += (int32_t)((diff_q8 * alpha_q16) >> 16);
+        inout_q8[axis] = sensor->value_q8[axis];
+    }
+}
+
+/**
+ * Butterworth low-pass coefficients for the current sampling period: only recomputed when the period changes.
+ */
+static void imu_filter_biquad_design(const imu_filter_t *const filter, imu_filter_sensor_t *const sensor) {
+    const int64_t drift = absolute_value(sensor->period_us - sensor->biquad_period_us);
+    if ((sensor->biquad_period_us != 0) && (drift * 10 < sensor->biquad_period_us)) {
+        return;
+    }
+
+    sensor->biquad_period_us = sensor->period_us;
+
+    const double fs = 1000000.0 / (double)sensor->period_us;
+    const double fc = (double)filter->cutoff_mhz / 1000.0;
+
+    // a cutoff above the Nyquist frequency lets everything through
+    if (fc >= fs * 0.45) {
+        sensor->b_q14[0] = 1 << 14;
+        sensor->b_q14[1] = 0;
+        sensor->b_q14[2] = 0;
+        sensor->a_q14[0] = 0;
+        sensor->a_q14[1] = 0;
+        return;
+    }
+
+    const double w0 = 2.0 * M_PI * fc / fs;
+    const double alpha = sin(w0) / (2.0 * M_SQRT1_2);
+    const double a0 = 1.0 + alpha;
+    const double b1 = (1.0 - cos(w0)) / a0;
+
+    sensor->b_q14[0] = (int32_t)lround(b1 * 0.5 * 16384.0);
+    sensor->b_q14[1] = (int32_t)lround(b1 * 16384.0);
+    sensor->b_q14[2] = sensor->b_q14[0];
+    sensor->a_q14[0] = (int32_t)lround((-2.0 * cos(w0) / a0) * 16384.0);
+    sensor->a_q14[1] = (int32_t)lround(((1.0 - alpha) / a0) * 16384.0);
+}
+
+static void imu_filter_biquad(const imu_filter_t *const filter, imu_filter_sensor_t *const sensor, int32_t inout_q8[3]) {
+    imu_filter_biquad_design(filter, sensor);
+
+    int32_t out_q8[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        const int64_t acc =
+            (int64_t)sensor->b_q14[0] * (int64_t)inout_q8[axis] +
+            (int64_t)sensor->b_q14[1] * (int64_t)sensor->x_q8[0][axis] +
+            (int64_t)sensor->b_q14[2] * (int64_t)sensor->x_q8[1][axis] -
+            (int64_t)sensor->a_q14[0] * (int64_t)sensor->y_q8[0][axis] -
+            (int64_t)sensor->a_q14[1] * (int64_t)sensor->y_q8[1][axis];
+
+        out_q8[axis] = (int32_t)(acc >> 14);
+    }
+
+    for (int axis = 0; axis < 3; ++axis) {
+        sensor->x_q8[1][axis] = sensor->x_q8[0][axis];
+        sensor->x_q8[0][axis] = inout_q8[axis];
+        sensor->y_q8[1][axis] = sensor->y_q8[0][axis];
+        sensor->y_q8[0][axis] = out_q8[axis];
+        inout_q8[axis] = out_q8[axis];
+    }
+}
+
+/**
+ * Follow the accelerometer: the device has moved when gravity is not around 1g (the device is being
+ * shaken or accelerated) or its direction changed since the device stopped.
+ */
+static void imu_filter_track_accel(imu_filter_bias_t *const bias, const uint16_t x, const uint16_t y, const uint16_t z) {
+    const int32_t values[3] = { (int16_t)x, (int16_t)y, (int16_t)z };
+
+    const int64_t magnitude2 = ((int64_t)values[0] * values[0]) + ((int64_t)values[1] * values[1]) + ((int64_t)values[2] * values[2]);
+    const int64_t min_g = ((int64_t)bias->one_g * (100 - IMU_FILTER_ACCEL_GRAVITY_PERCENT)) / 100;
+    const int64_t max_g = ((int64_t)bias->one_g * (100 + IMU_FILTER_ACCEL_GRAVITY_PERCENT)) / 100;
+    const int64_t max_drift = ((int64_t)bias->one_g * IMU_FILTER_ACCEL_STILL_PERCENT) / 100;
+
+    bool still = (magnitude2 >= min_g * min_g) && (magnitude2 <= max_g * max_g) && (bias->accel_reference_valid);
+    for (int axis = 0; axis < 3; ++axis) {
+        still = still && (absolute_value((int64_t)values[axis] - (int64_t)bias->accel_reference[axis]) <= max_drift);
+    }
+
+    if (!still) {
+        memcpy(bias->accel_reference, values, sizeof(bias->accel_reference));
+        bias->accel_reference_valid = true;
+        bias->accel_moved = true;
+    }
+
+    bias->accel_seen = true;
+}
+
+static void imu_filter_remove_bias(imu_filter_bias_t *const bias, int64_t period_us, int32_t inout_q8[3]) {
+    // without an accelerometer the gyroscope thresholds are all there is
+    bool still = (!bias->accel_seen) || (!bias->accel_moved);
+    bias->accel_moved = false;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        bias->mean_q8[axis] += (inout_q8[axis] - bias->mean_q8[axis]) >> 4;
+
+        still = still &&
+            (absolute_value(inout_q8[axis] - bias->mean_q8[axis]) <= (IMU_FILTER_STILL_NOISE << 8)) &&
+            (absolute_value(inout_q8[axis]) <= (IMU_FILTER_MAX_BIAS << 8));
+    }
+
+    // counted in sampling periods: learning does not depend on samples being timestamped
+    bias->still_us = still ? bias->still_us + period_us : 0;
+    if (bias->still_us >= IMU_FILTER_STILL_US) {
+        for (int axis = 0; axis < 3; ++axis) {
+            const int64_t diff_q16 = ((int64_t)inout_q8[axis] << 8) - bias->bias_q16[axis];
+            bias->bias_q16[axis] += (diff_q16 * period_us) / IMU_FILTER_BIAS_TAU_US;
+        }
+    }
+
+    for (int axis = 0; axis < 3; ++axis) {
+        inout_q8[axis] -= (int32_t)div_round_closest_i64(bias->bias_q16[axis], 256);
+    }
+}
+
+static void imu_filter_sample(
+    imu_filter_t *const filter,
+    imu_filter_sensor_t *const sensor,
+    imu_filter_bias_t *const bias,
+    int64_t timestamp_ns,
+    uint16_t *const x,
+    uint16_t *const y,
+    uint16_t *const z
+) {
+    int32_t values_q8[3] = {
+        (int32_t)(int16_t)*x * 256,
+        (int32_t)(int16_t)*y * 256,
+        (int32_t)(int16_t)*z * 256,
+    };
+
+    // samples without increasing timestamps keep the last known period
+    if ((sensor->primed) && (timestamp_ns > sensor->last_timestamp_ns)) {
+        sensor->period_us = min_max_clamp((timestamp_ns - sensor->last_timestamp_ns) / (int64_t)1000, 1, 100000);
+    } else if (sensor->period_us == 0) {
+        sensor->period_us = IMU_FILTER_DEFAULT_PERIOD_US;
+    }
+    sensor->last_timestamp_ns = timestamp_ns;
+
+    if (bias != NULL) {
+        imu_filter_remove_bias(bias, sensor->period_us, values_q8);
+    }
+
+    if (!sensor->primed) {
+        // start from the first reading instead of ramping up from zero
+        for (int axis = 0; axis < 3; ++axis) {
+            sensor->value_q8[axis] = values_q8[axis];
+            sensor->speed_q8[axis] = 0;
+            sensor->x_q8[0][axis] = sensor->x_q8[1][axis] = values_q8[axis];
+            sensor->y_q8[0][axis] = sensor->y_q8[1][axis] = values_q8[axis];
+        }
+        sensor->primed = true;
+    } else if (filter->type == IMU_FILTER_ONE_EURO) {
+        imu_filter_one_euro(filter, sensor, values_q8);
+    } else if (filter->type == IMU_FILTER_BIQUAD) {
+        imu_filter_biquad(filter, sensor, values_q8);
+    }
+
+    *x = (uint16_t)(int16_t)min_max_clamp(div_round_closest(values_q8[0], 256), -32768, 32767);
+    *y = (uint16_t)(int16_t)min_max_clamp(div_round_closest(values_q8[1], 256), -32768, 32767);
+    *z = (uint16_t)(int16_t)min_max_clamp(div_round_closest(values_q8[2], 256), -32768, 32767);
+}
+
+void imu_filter_apply(imu_filter_t *const filter, in_message_t *const messages, int count) {
+    if ((filter->type == IMU_FILTER_NONE) && (!filter->bias.enabled)) {
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (messages[i].type != GAMEPAD_SET_ELEMENT) {
+            continue;
+        }
+
+        in_message_gamepad_set_element_t *const set = &messages[i].data.gamepad_set;
+        if (set->element == GAMEPAD_GYROSCOPE) {
+            imu_filter_sample(
+                filter,
+                &filter->gyro,
+                filter->bias.enabled ? &filter->bias : NULL,
+                set->status.gyro.sample_timestamp_ns,
+                &set->status.gyro.x,
+                &set->status.gyro.y,
+                &set->status.gyro.z
+            );
+        } else if (set->element == GAMEPAD_ACCELEROMETER) {
+            if (filter->bias.enabled) {
+                imu_filter_track_accel(&filter->bias, set->status.accel.x, set->status.accel.y, set->status.accel.z);
+            }
+
+            imu_filter_sample(
+                filter,
+                &filter->accel,
+                NULL,
+                set->status.accel.sample_timestamp_ns,
+                &set->status.accel.x,
+                &set->status.accel.y,
+                &set->status.accel.z
+            );
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "message.h"
+#include "settings.h"
+
+#define IMU_FILTER_NONE     0
+#define IMU_FILTER_ONE_EURO 1
+#define IMU_FILTER_BIQUAD   2
+
+/**
+ * State of a filtered sensor: the three axes are kept side by side (structure of arrays) and always processed
+ * together, readings and filtered values carry 8 fractional bits.
+ */
+typedef struct imu_filter_sensor {
+    bool primed;
+
+    // CLOCK_MONOTONIC time of the last sample, period between samples
+    int64_t last_timestamp_ns;
+    int64_t period_us;
+
+    // 1-euro: samples per second (16 fractional bits) and speed smoothing factor for one_euro_period_us
+    int64_t one_euro_period_us;
+    int64_t rate_q16;
+    int64_t speed_alpha_q16;
+
+    // 1-euro: filtered value and filtered speed (LSB per second)
+    int32_t value_q8[3];
+    int64_t speed_q8[3];
+
+    // biquad: coefficients (14 fractional bits) for biquad_period_us, previous inputs and outputs
+    int64_t biquad_period_us;
+    int32_t b_q14[3];
+    int32_t a_q14[2];
+    int32_t x_q8[2][3];
+    int32_t y_q8[2][3];
+} imu_filter_sensor_t;
+
+/**
+ * Gyroscope offset learnt while the device lies still: the gyroscope alone cannot tell an offset from a slow
+ * steady rotation, so the accelerometer (when there is one) has to confirm that gravity is not moving.
+ */
+typedef struct imu_filter_bias {
+    bool enabled;
+
+    // slow average of the readings: the device is still while readings stay close to it
+    int32_t mean_q8[3];
+
+    // for how long the device has been still
+    int64_t still_us;
+
+    // 16 fractional bits: learnt over seconds, a fraction of a LSB at a time
+    int64_t bias_q16[3];
+
+    // accelerometer readings of a gravity of 1g
+    int32_t one_g;
+
+    bool accel_seen;
+
+    // accelerometer reading the device is still around: reset as soon as the device moves away from it
+    bool accel_reference_valid;
+    int32_t accel_reference[3];
+
+    // set by the accelerometer when the device moved, consumed by the gyroscope
+    bool accel_moved;
+} imu_filter_bias_t;
+
+/**
+ * Optional filtering of IMU samples before they leave dev_in: gyroscope bias removal followed by either
+ * a 1-euro filter (adaptive low-pass: steady at rest, responsive when moving) or a biquad low-pass.
+ *
+ * Fixed-point only: a sample costs some integer multiplications and a few divisions.
+ */
+typedef struct imu_filter {
+    uint8_t type;
+
+    // 1-euro parameters: cutoff frequencies in mHz, beta in mHz for every 1000 LSB per second
+    int64_t min_cutoff_mhz;
+    int64_t beta_mhz;
+
+    // biquad cutoff frequency in mHz
+    int64_t cutoff_mhz;
+
+    imu_filter_bias_t bias;
+
+    imu_filter_sensor_t gyro;
+    imu_filter_sensor_t accel;
+} imu_filter_t;
+
+int imu_filter_init(imu_filter_t *const out_filter, const dev_in_settings_t *const in_settings);
+
+/**
+ * Filter, in place, gyroscope and accelerometer readings among messages: other messages are left untouched.
+ */
+void imu_filter_apply(imu_filter_t *const filter, in_message_t *const messages, int count);
@@ -0,0 +1,41 @@
+#include "imu_matrix.h"
+
+// a sensor with a resolution this far from the reported one is certainly misreporting its scale
+#define IMU_MATRIX_MAX_RATIO ((double)256.0)
+
+int imu_matrix_compose(
+    imu_matrix_t *const out_matrix,
+    const int8_t in_mount_matrix[3][3],
+    double in_scale,
+    double out_scale
+) {
+    int res = 0;
+
+    double ratio = in_scale / out_scale;
+    if ((!isfinite(ratio)) || (ratio <= 0.0) || (ratio > IMU_MATRIX_MAX_RATIO)) {
+        // readings are passed on unscaled, as if the sensor was already using the reported scale
+        ratio = 1.0;
+        res = -EINVAL;
+    }
+
+    const int32_t factor_q16 = (int32_t)lround(ratio * (double)(1 << IMU_MATRIX_SHIFT));
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            out_matrix->factors_q16[r][c] = (int32_t)in_mount_matrix[r][c] * factor_q16;
+        }
+    }
+
+    return res;
+}
+
+void imu_matrix_apply(const imu_matrix_t *const matrix, const int16_t in_raw[3], int16_t out_values[3]) {
+    for (int r = 0; r < 3; ++r) {
+        const int64_t acc =
+            (int64_t)matrix->factors_q16[r][0] * (int64_t)in_raw[0] +
+            (int64_t)matrix->factors_q16[r][1] * (int64_t)in_raw[1] +
+            (int64_t)matrix->factors_q16[r][2] * (int64_t)in_raw[2] +
+            ((int64_t)1 << (IMU_MATRIX_SHIFT - 1));
+
+        out_values[r] = (int16_t)min_max_clamp(acc >> IMU_MATRIX_SHIFT, -32768, 32767);
+    }
+}
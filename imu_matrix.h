@@ -0,0 +1,30 @@
+#pragma once
+
+#include "rogue_enemy.h"
+
+// fractional bits of every matrix factor
+#define IMU_MATRIX_SHIFT 16
+
+/**
+ * Conversion of a sensor reading to the units reported to games (the ones of LSB_PER_RAD_S_2000_DEG_S
+ * and LSB_PER_16G): the sensor scale and the mount matrix are combined once, when the device is opened,
+ * so that a sample only costs nine integer multiplications.
+ *
+ * Row-major: axis r of the output is the sum over c of factors_q16[r][c] * raw[c].
+ */
+typedef struct imu_matrix {
+    int32_t factors_q16[3][3];
+} imu_matrix_t;
+
+/**
+ * Combine in_mount_matrix (sensor axes to gamepad axes) with the ratio between the scale the sensor reports
+ * readings in and out_scale: returns -EINVAL (and an unscaled matrix) when in_scale is not usable.
+ */
+int imu_matrix_compose(
+    imu_matrix_t *const out_matrix,
+    const int8_t in_mount_matrix[3][3],
+    double in_scale,
+    double out_scale
+);
+
+void imu_matrix_apply(const imu_matrix_t *const matrix, const int16_t in_raw[3], int16_t out_values[3]);
@@ -19,10 +19,6 @@ typedef struct imu_message {
     long accel_z_raw;
 
     int16_t temp_raw;
-    double temp_in_k;
-
-    double gyro_rad_s[3]; // | x, y, z| right-hand-rules -- in rad/s
-    double accel_m2s[3]; // | x, y, z| positive: right, up, towards player -- in m/s^2
 
     uint32_t flags;
 
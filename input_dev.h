@@ -12,6 +12,10 @@
 typedef struct evdev_collected {
     struct input_event ev[MAX_COLLECTED_EVDEV_EVENTS];
     size_t ev_count;
+
+    // events describe the state of the device (keys held, axes positions) instead of changes:
+    // this happens when the server has to be resynchronized, one-shot actions must not fire again
+    bool resync;
 } evdev_collected_t;
 
 /**
@@ -28,7 +32,6 @@ typedef int (*ev_map)(
 typedef void (*ev_timer)(
     const dev_in_settings_t *const conf,
     struct libevdev* evdev,
-    const char* const timer_name,
     uint64_t expired,
     void* user_data
 );
@@ -82,7 +85,6 @@ typedef int (*hidraw_rumble)(
 typedef void (*hidraw_timer)(
     const dev_in_settings_t *const conf,
     int fd,
-    const char* const timer_name,
     uint64_t expired,
     void* user_data
 );
@@ -92,6 +94,9 @@ typedef struct hidraw_callbacks {
     hidraw_rumble rumble_callback;
     hidraw_map map_callback;
     hidraw_timer timeout_callback;
+
+    // id of the timer timeout_callback is called for
+    uint32_t timeout_timer_id;
 } hidraw_callbacks_t;
 
 typedef struct iio_settings {
@@ -99,18 +104,33 @@ typedef struct iio_settings {
     int8_t post_matrix[3][3];
 } iio_settings_t;
 
-typedef int (*timer_map)(const dev_in_settings_t *const conf, int timer_fd, uint64_t expirations, in_message_t *const messages, size_t messages_len, void* user_data);
+typedef int (*timer_map)(const dev_in_settings_t *const conf, uint64_t expirations, in_message_t *const messages, size_t messages_len, void* user_data);
+
+/**
+ * Tells if the timer has something to do: a timer that is not busy is stopped until this
+ * returns true again, it is evaluated after every batch of input events.
+ */
+typedef bool (*timer_busy)(const dev_in_settings_t *const conf, void* user_data);
 
 typedef struct timer_callbacks {
     timer_map map_fn;
+
+    // NULL when the timer always has something to do
+    timer_busy busy_fn;
 } timer_callbacks_t;
 
 typedef struct ev_callbacks {
     ev_map input_map_fn;
     ev_timer timeout_callback;
+
+    // id of the timer timeout_callback is called for
+    uint32_t timeout_timer_id;
 } ev_callbacks_t;
 
 typedef struct timer_filters {
+    // unique (and not 0) among timers of the same composite: callbacks refer to the timer with this
+    uint32_t id;
+
     char name[128];
     uint64_t ticktime_ms;
     uint64_t ticktime_ns;
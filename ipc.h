@@ -1,17 +1,34 @@
 #pragma once
 
 #include "rogue_enemy.h"
+#include "message.h"
 
 #define MAX_CONNECTED_CLIENTS 8
 
+/**
+ * Input reaches the server on two lanes:
+ *   - the reliable one (SOCK_STREAM) carries discrete events in order and out_message_t back to the client;
+ *   - the latest one (SOCK_SEQPACKET) carries continuous samples: the client only keeps the newest value
+ *     of each element and sends what changed as a single packet, without ever blocking on it.
+ *
+ * A client that cannot connect the latest lane sends everything on the reliable one.
+ */
 typedef struct ipc_strategy_socket {
     struct sockaddr_un serveraddr;
     int fd;
+
+    struct sockaddr_un latest_serveraddr;
+    int latest_fd;
 } ipc_strategy_socket_t;
 
+/**
+ * Client tables shared by the accept thread and dev_out without a lock: the accept thread only fills
+ * free (-1) slots with a compare-and-swap and dev_out is the only one emptying them, so a slot
+ * dev_out has seen holding a client keeps holding it until dev_out itself drops it.
+ */
 typedef struct ipc_strategy_ssocket {
-    pthread_mutex_t mutex;
-    int clients[MAX_CONNECTED_CLIENTS];
+    atomic_int clients[MAX_CONNECTED_CLIENTS];
+    atomic_int latest_clients[MAX_CONNECTED_CLIENTS];
 } ipc_strategy_ssocket_t;
 
 typedef struct ipc_strategy_pipe {
@@ -24,10 +41,23 @@ typedef struct ipc_strategy_pipe {
 
 } ipc_strategy_pipe_t;
 
+struct devices_status_shared;
+
+typedef struct ipc_strategy_shared {
+
+    // dev_in applies in_message_t here directly: no message is written anywhere
+    struct devices_status_shared *state;
+
+    // this pipe is reserved for receiving out_message_t
+    int out_message_pipe_fd;
+
+} ipc_strategy_shared_t;
+
 typedef enum ipc_strategy {
     ipc_unix_pipe,
     ipc_server_sockets,
     ipc_client_socket,
+    ipc_shared_state,
 } ipc_strategy_t;
 
 typedef struct ipc {
@@ -36,8 +66,22 @@ typedef struct ipc {
         ipc_strategy_pipe_t pipe;
         ipc_strategy_ssocket_t ssocket;
         ipc_strategy_socket_t socket;
+        ipc_strategy_shared_t shared;
     } endpoint;
 
 } ipc_t;
 
-#define SERVER_PATH "/home/rogue-enemy.sock"
\ No newline at end of file
+#define SERVER_PATH "/home/rogue-enemy.sock"
+
+#define SERVER_LATEST_PATH "/home/rogue-enemy-latest.sock"
+
+// keep at most a few packets in flight on the latest lane: older samples are replaced instead of queued
+#define LATEST_LANE_SNDBUF 8192
+
+// a packet on the latest lane holds at most one message per gamepad element plus the two mouse movements
+#define LATEST_LANE_SLOTS (IN_GAMEPAD_ELEMENTS_COUNT + 2)
+
+// a client that lost the server retries right away, then doubles the wait up to the max: a restarting
+// server is picked up within a few milliseconds and a missing one does not keep the client spinning
+#define RECONNECT_BACKOFF_MIN_US 250
+#define RECONNECT_BACKOFF_MAX_US 50000
@@ -34,6 +34,11 @@ int main(int argc, char ** argv) {
     .enable_leds_commands = false,
     .enable_imu = true,
     .imu_polling_interface = true,
+    .imu_filter = 0,
+    .imu_filter_min_cutoff_hz = 2.0,
+    .imu_filter_beta = 0.5,
+    .imu_filter_cutoff_hz = 80.0,
+    .gyro_bias_estimation = false,
   };
   
   load_in_config(&in_settings, configuration_file);
@@ -70,7 +75,12 @@ int main(int argc, char ** argv) {
           .serveraddr = {
             .sun_path = SERVER_PATH,
             .sun_family = AF_UNIX,
-          }
+          },
+          .latest_fd = -1,
+          .latest_serveraddr = {
+            .sun_path = SERVER_LATEST_PATH,
+            .sun_family = AF_UNIX,
+          },
         },
       }
     },
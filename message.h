@@ -41,8 +41,12 @@ typedef enum in_message_gamepad_btn {
     GAMEPAD_TOUCHPAD_X,
     GAMEPAD_TOUCHPAD_Y,
     GAMEPAD_TOUCHPAD_TOUCH_ACTIVE,
+
+    GAMEPAD_IMU_SAMPLING_RATE,
 }  in_gamepad_element_t;
 
+#define IN_GAMEPAD_ELEMENTS_COUNT (GAMEPAD_IMU_SAMPLING_RATE + 1)
+
 typedef struct in_message_gamepad_touchpad_x {
     int16_t value;
 } in_message_gamepad_touchpad_x_t;
@@ -82,6 +86,7 @@ typedef struct in_message_gamepad_set_element {
         in_message_gamepad_touchpad_active_t touchpad_active;
         in_message_gamepad_touchpad_x_t touchpad_x;
         in_message_gamepad_touchpad_y_t touchpad_y;
+        uint32_t sampling_rate_hz; // the one the IMU has been set to, 0 when unknown
     } status;
 }  in_message_gamepad_set_element_t;
 
@@ -96,60 +101,23 @@ typedef enum mouse_element {
 typedef struct in_message_mouse_event {
     mouse_element_t type;
     int32_t value;
+
+    uint32_t flags; // EV_MESSAGE_FLAGS_PRESERVE_TIME when time is the one of the originating input_event
+    struct timeval time;
 } in_message_mouse_event_t;
 
 typedef enum in_message_gamepad_action {
     GAMEPAD_ACTION_PRESS_AND_RELEASE_CENTER,
     GAMEPAD_ACTION_OPEN_STEAM_QAM,
+    GAMEPAD_ACTION_SWITCH_EMULATED_GAMEPAD,
 } in_message_gamepad_action_t;
 
-typedef enum kbd_element {
-    KEYBOARD_KEY_Q,
-    KEYBOARD_KEY_W,
-    KEYBOARD_KEY_E,
-    KEYBOARD_KEY_R,
-    KEYBOARD_KEY_T,
-    KEYBOARD_KEY_Y,
-    KEYBOARD_KEY_U,
-    KEYBOARD_KEY_I,
-    KEYBOARD_KEY_O,
-    KEYBOARD_KEY_P,
-    KEYBOARD_KEY_A,
-    KEYBOARD_KEY_S,
-    KEYBOARD_KEY_D,
-    KEYBOARD_KEY_F,
-    KEYBOARD_KEY_G,
-    KEYBOARD_KEY_H,
-    KEYBOARD_KEY_J,
-    KEYBOARD_KEY_K,
-    KEYBOARD_KEY_L,
-    KEYBOARD_KEY_Z,
-    KEYBOARD_KEY_X,
-    KEYBOARD_KEY_C,
-    KEYBOARD_KEY_V,
-    KEYBOARD_KEY_B,
-    KEYBOARD_KEY_N,
-    KEYBOARD_KEY_M,
-    KEYBOARD_KEY_UP,
-    KEYBOARD_KEY_DOWN,
-    KEYBOARD_KEY_LEFT,
-    KEYBOARD_KEY_RIGHT,
-    KEYBOARD_KEY_NUM_1,
-    KEYBOARD_KEY_NUM_2,
-    KEYBOARD_KEY_NUM_3,
-    KEYBOARD_KEY_NUM_4,
-    KEYBOARD_KEY_NUM_5,
-    KEYBOARD_KEY_NUM_6,
-    KEYBOARD_KEY_NUM_7,
-    KEYBOARD_KEY_NUM_8,
-    KEYBOARD_KEY_NUM_9,
-    KEYBOARD_KEY_NUM_0,
-    KEYBOARD_KEY_LCRTL,
-} kbd_element_t;
-
 typedef struct in_message_keyboard_set_element {
-    kbd_element_t type;
+    uint16_t code; // linux KEY_* code: only keys below BTN_MISC are supported
     uint8_t value;
+
+    uint32_t flags; // EV_MESSAGE_FLAGS_PRESERVE_TIME when time is the one of the originating input_event
+    struct timeval time;
 } in_message_keyboard_set_element_t;
 
 typedef enum in_in_message_type {
@@ -186,9 +154,19 @@ typedef struct out_message_leds {
     uint8_t b;
 }  out_message_leds_t;
 
+/**
+ * How much of the input the emulated gamepad can represent: sent by dev_out to every input client when
+ * it connects and whenever the emulated gamepad changes.
+ */
+typedef struct out_message_resolution {
+    uint8_t joystick_bits; // significant bits of a joystick position, 16 when the whole value is used
+    uint32_t imu_sampling_rate_hz; // IMU sampling frequency matching the report rate of the emulated gamepad
+}  out_message_resolution_t;
+
 typedef enum out_message_type {
     OUT_MSG_TYPE_RUMBLE = 0,
     OUT_MSG_TYPE_LEDS,
+    OUT_MSG_TYPE_RESOLUTION,
 }  out_message_type_t;
 
 typedef struct out_message {
@@ -197,6 +175,7 @@ typedef struct out_message {
     union {
         out_message_rumble_t rumble;
         out_message_leds_t leds;
+        out_message_resolution_t resolution;
     } data;
 
 }  out_message_t;
@@ -0,0 +1,126 @@
+#include "motion_predictor.h"
+#include "rogue_enemy.h"
+
+// a sample older than this has not been stamped with CLOCK_MONOTONIC (or the sensor has stopped)
+#define MOTION_PREDICTOR_MAX_AGE_US ((int64_t)100000)
+
+int motion_predictor_init(motion_predictor_t *const out_predictor, const dev_out_settings_t *const in_settings) {
+    memset(out_predictor, 0, sizeof(motion_predictor_t));
+
+    if ((in_settings->motion_prediction_horizon_us <= 0) || (in_settings->motion_prediction_max_delta < 0)) {
+        return -EINVAL;
+    }
+
+    out_predictor->enabled = in_settings->motion_prediction;
+    out_predictor->quadratic = in_settings->motion_prediction_quadratic;
+    out_predictor->horizon_us = in_settings->motion_prediction_horizon_us;
+    out_predictor->max_delta = in_settings->motion_prediction_max_delta;
+
+    return 0;
+}
+
+static void motion_history_push(motion_history_t *const history, int64_t timestamp_us, const int16_t values[3]) {
+    if (history->count == MOTION_PREDICTOR_SAMPLES) {
+        memmove(&history->timestamp_us[0], &history->timestamp_us[1], sizeof(history->timestamp_us[0]) * (MOTION_PREDICTOR_SAMPLES - 1));
+        memmove(&history->values[0], &history->values[1], sizeof(history->values[0]) * (MOTION_PREDICTOR_SAMPLES - 1));
+        --history->count;
+    }
+
+    history->timestamp_us[history->count] = timestamp_us;
+    memcpy(&history->values[history->count][0], values, sizeof(history->values[0]));
+    ++history->count;
+}
+
+/**
+ * Value of an axis x microseconds after the newest sample.
+ */
+static int64_t motion_history_extrapolate(const motion_history_t *const history, bool quadratic, int axis, int64_t x) {
+    const size_t n = history->count;
+    const int64_t v2 = history->values[n - 1][axis];
+    const int64_t v1 = history->values[n - 2][axis];
+    const int64_t b = history->timestamp_us[n - 2] - history->timestamp_us[n - 1];
+
+    if ((!quadratic) || (n < 3)) {
+        return v2 + div_round_closest_i64((v2 - v1) * x, -b);
+    }
+
+    // Lagrange polynomial through the three samples, written around the newest one
+    const int64_t v0 = history->values[n - 3][axis];
+    const int64_t a = history->timestamp_us[n - 3] - history->timestamp_us[n - 1];
+
+    return v2 +
+        div_round_closest_i64((v0 - v2) * x * (x - b), a * (a - b)) +
+        div_round_closest_i64((v1 - v2) * x * (x - a), b * (b - a));
+}
+
+static bool motion_predictor_sensor(
+    motion_predictor_t *const predictor,
+    motion_history_t *const history,
+    int64_t timestamp_ns,
+    int16_t inout_values[3],
+    int64_t now_us
+) {
+    const int64_t timestamp_us = timestamp_ns / (int64_t)1000;
+    const int64_t age_us = now_us - timestamp_us;
+
+    if ((history->count == 0) || (timestamp_us != history->timestamp_us[history->count - 1])) {
+        const bool in_order = (history->count == 0) || (timestamp_us > history->timestamp_us[history->count - 1]);
+        if ((!in_order) || (age_us < 0) || (age_us > MOTION_PREDICTOR_MAX_AGE_US)) {
+            if ((!predictor->warned) && (history->count == 0)) {
+                fprintf(stderr, "IMU samples carry no usable timestamp -- motion prediction will not be available\n");
+                predictor->warned = true;
+            }
+
+            // readings are left as they arrived
+            history->count = 0;
+            return false;
+        }
+
+        motion_history_push(history, timestamp_us, inout_values);
+    }
+
+    if (history->count < 2) {
+        return false;
+    }
+
+    int16_t predicted[3];
+    memcpy(predicted, &history->values[history->count - 1][0], sizeof(predicted));
+
+    // a stalled sensor (or samples from the past) is reported as last seen
+    if ((age_us >= 0) && (age_us <= MOTION_PREDICTOR_MAX_AGE_US)) {
+        const int64_t x = age_us < predictor->horizon_us ? age_us : predictor->horizon_us;
+        for (int axis = 0; axis < 3; ++axis) {
+            const int64_t last = history->values[history->count - 1][axis];
+            const int64_t value = motion_history_extrapolate(history, predictor->quadratic, axis, x);
+            const int64_t delta = min_max_clamp(value - last, -(int64_t)predictor->max_delta, (int64_t)predictor->max_delta);
+            predicted[axis] = (int16_t)min_max_clamp(last + delta, -32768, 32767);
+        }
+    }
+
+    if (memcmp(predicted, inout_values, sizeof(predicted)) == 0) {
+        return false;
+    }
+
+    memcpy(inout_values, predicted, sizeof(predicted));
+    return true;
+}
+
+void motion_predictor_run(
+    motion_predictor_t *const predictor,
+    gamepad_status_t *const inout_gamepad,
+    const struct timespec *const now
+) {
+    if (!predictor->enabled) {
+        return;
+    }
+
+    const int64_t now_us = ((int64_t)now->tv_sec * (int64_t)1000000) + ((int64_t)now->tv_nsec / (int64_t)1000);
+
+    if (motion_predictor_sensor(predictor, &predictor->gyro, inout_gamepad->last_gyro_motion_timestamp_ns, inout_gamepad->raw_gyro, now_us)) {
+        inout_gamepad->dirty |= GAMEPAD_STATUS_DIRTY_GYRO;
+    }
+
+    if (motion_predictor_sensor(predictor, &predictor->accel, inout_gamepad->last_accel_motion_timestamp_ns, inout_gamepad->raw_accel, now_us)) {
+        inout_gamepad->dirty |= GAMEPAD_STATUS_DIRTY_ACCEL;
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "devices_status.h"
+#include "settings.h"
+
+#include <time.h>
+
+// samples a prediction is fitted to: two for a linear model, three for a quadratic one
+#define MOTION_PREDICTOR_SAMPLES 3
+
+/**
+ * Last samples of a sensor, oldest first, with the timestamp (in microseconds) they have been taken at.
+ */
+typedef struct motion_history {
+    size_t count;
+
+    int64_t timestamp_us[MOTION_PREDICTOR_SAMPLES];
+
+    int16_t values[MOTION_PREDICTOR_SAMPLES][3];
+} motion_history_t;
+
+/**
+ * Extrapolates gyroscope and accelerometer readings from their last samples to the time a report is composed,
+ * hiding the age of the sample (up to an IMU period plus the IPC delay) from games.
+ *
+ * Only works with samples stamped (CLOCK_MONOTONIC) when they have been taken: as long as timestamps are
+ * missing, from another clock or not increasing, the last sample is reported as it is.
+ */
+typedef struct motion_predictor {
+    bool enabled;
+
+    bool quadratic;
+
+    int64_t horizon_us;
+
+    int32_t max_delta;
+
+    // tell once that samples carry no usable timestamp
+    bool warned;
+
+    motion_history_t gyro;
+    motion_history_t accel;
+} motion_predictor_t;
+
+int motion_predictor_init(motion_predictor_t *const out_predictor, const dev_out_settings_t *const in_settings);
+
+/**
+ * Record new samples of inout_gamepad and replace its readings with the ones predicted at now:
+ * to be called right before composing a report. Marks gyroscope and accelerometer dirty when they change.
+ */
+void motion_predictor_run(
+    motion_predictor_t *const predictor,
+    gamepad_status_t *const inout_gamepad,
+    const struct timespec *const now
+);
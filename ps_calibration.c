@@ -0,0 +1,44 @@
+#include "ps_calibration.h"
+
+/* gyroscope speed the limits refer to (in deg/s): the one a real controller declares */
+#define PS_CALIBRATION_GYRO_SPEED 540
+
+#define PS_CALIBRATION_STANDARD_GRAVITY ((double)9.80665)
+
+static void put_le16(uint8_t *const out, int16_t value) {
+    out[0] = (uint8_t)((uint16_t)value & 0x00FF);
+    out[1] = (uint8_t)(((uint16_t)value & 0xFF00) >> 8);
+}
+
+void ps_calibration_build(uint8_t out[PS_CALIBRATION_SIZE], bool bt_layout) {
+    memset(out, 0, PS_CALIBRATION_SIZE);
+
+    // the reading that corresponds to PS_CALIBRATION_GYRO_SPEED and to 1g: the host divides by both limits
+    const double gyro_deg_s_per_lsb = LSB_PER_RAD_S_2000_DEG_S * 180.0 / M_PI;
+    const int16_t gyro_limit = (int16_t)min_max_clamp(lround((double)PS_CALIBRATION_GYRO_SPEED / gyro_deg_s_per_lsb), 1, 32767);
+    const int16_t accel_limit = (int16_t)min_max_clamp(lround(PS_CALIBRATION_STANDARD_GRAVITY / LSB_PER_16G), 1, 32767);
+
+    // bytes 0 to 5: gyroscope pitch, yaw and roll bias, readings are already unbiased
+    if (bt_layout) {
+        // pitch, yaw and roll plus, then pitch, yaw and roll minus
+        for (int axis = 0; axis < 3; ++axis) {
+            put_le16(&out[6 + (axis * 2)], gyro_limit);
+            put_le16(&out[12 + (axis * 2)], -gyro_limit);
+        }
+    } else {
+        // plus and minus of pitch, yaw and roll
+        for (int axis = 0; axis < 3; ++axis) {
+            put_le16(&out[6 + (axis * 4)], gyro_limit);
+            put_le16(&out[8 + (axis * 4)], -gyro_limit);
+        }
+    }
+
+    put_le16(&out[18], PS_CALIBRATION_GYRO_SPEED);
+    put_le16(&out[20], PS_CALIBRATION_GYRO_SPEED);
+
+    // plus and minus of x, y and z: 1g and -1g
+    for (int axis = 0; axis < 3; ++axis) {
+        put_le16(&out[22 + (axis * 4)], accel_limit);
+        put_le16(&out[24 + (axis * 4)], -accel_limit);
+    }
+}
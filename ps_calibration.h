@@ -0,0 +1,15 @@
+#pragma once
+
+#include "rogue_enemy.h"
+
+/* Motion sensors calibration in DualShock4 / DualSense calibration feature reports: bytes 1 to 34 */
+#define PS_CALIBRATION_OFFSET   1
+#define PS_CALIBRATION_SIZE     34
+
+/**
+ * Write to out the calibration block describing gyroscope and accelerometer readings in the units they are
+ * received in (LSB_PER_RAD_S_2000_DEG_S and LSB_PER_16G), so that readings are reported as they are.
+ *
+ * A DualShock4 connected via bluetooth lists gyroscope limits in a different order: bt_layout selects it.
+ */
+void ps_calibration_build(uint8_t out[PS_CALIBRATION_SIZE], bool bt_layout);
@@ -0,0 +1,198 @@
+#include "ps_crc32.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define PS_CRC32_HAVE_PCLMUL 1
+#endif
+
+/* reflected polynomial of CRC-32/ISO-HDLC: the one used by zlib and by Sony controllers */
+#define PS_CRC32_POLY 0xEDB88320U
+
+typedef uint32_t (*ps_crc32_kernel_t)(uint32_t state, const uint8_t *buf, size_t len);
+
+static uint32_t crc_table[8][256];
+
+/* CRC state (not yet inverted) after the seed byte has been processed: indexed by seed - PS_INPUT_CRC32_SEED */
+static uint32_t seed_states[3];
+
+static ps_crc32_kernel_t crc_kernel = NULL;
+
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static uint32_t crc32_slice8(uint32_t state, const uint8_t *buf, size_t len) {
+    while ((len > 0) && (((uintptr_t)buf & 7) != 0)) {
+        state = crc_table[0][(state ^ *buf++) & 0xFF] ^ (state >> 8);
+        --len;
+    }
+
+    while (len >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, &buf[0], sizeof(lo));
+        memcpy(&hi, &buf[4], sizeof(hi));
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        lo = __builtin_bswap32(lo);
+        hi = __builtin_bswap32(hi);
+#endif
+
+        lo ^= state;
+        state = crc_table[7][lo & 0xFF] ^
+                crc_table[6][(lo >> 8) & 0xFF] ^
+                crc_table[5][(lo >> 16) & 0xFF] ^
+                crc_table[4][lo >> 24] ^
+                crc_table[3][hi & 0xFF] ^
+                crc_table[2][(hi >> 8) & 0xFF] ^
+                crc_table[1][(hi >> 16) & 0xFF] ^
+                crc_table[0][hi >> 24];
+
+        buf += 8;
+        len -= 8;
+    }
+
+    while (len > 0) {
+        state = crc_table[0][(state ^ *buf++) & 0xFF] ^ (state >> 8);
+        --len;
+    }
+
+    return state;
+}
+
+#if defined(PS_CRC32_HAVE_PCLMUL)
+/*
+ * Carry-less multiplication folding, same constants and steps as the linux kernel crc32_pclmul_le_16:
+ * see "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" by Intel.
+ *
+ * Folds 64 bytes per iteration, the tail (len % 16) is left to the table implementation.
+ */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_pclmul(uint32_t state, const uint8_t *buf, size_t len) {
+    if (len < 64) {
+        return crc32_slice8(state, buf, len);
+    }
+
+    const __m128i k1k2 = _mm_set_epi64x(0x00000001c6e41596LL, 0x0000000154442bd4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00000000ccaa009eLL, 0x00000001751997d0LL);
+    const __m128i k5 = _mm_set_epi64x(0, 0x0000000163cd6124LL);
+    const __m128i poly_mu = _mm_set_epi64x(0x00000001f7011641LL, 0x00000001db710641LL);
+    const __m128i mask32 = _mm_set_epi32(0, 0, 0, -1);
+
+    __m128i x1 = _mm_loadu_si128((const __m128i*)&buf[0x00]);
+    __m128i x2 = _mm_loadu_si128((const __m128i*)&buf[0x10]);
+    __m128i x3 = _mm_loadu_si128((const __m128i*)&buf[0x20]);
+    __m128i x4 = _mm_loadu_si128((const __m128i*)&buf[0x30]);
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)state));
+
+    buf += 64;
+    len -= 64;
+
+    while (len >= 64) {
+        __m128i t1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        __m128i t2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        __m128i t3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        __m128i t4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+        x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x00), t1);
+        x2 = _mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x00), t2);
+        x3 = _mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x00), t3);
+        x4 = _mm_xor_si128(_mm_clmulepi64_si128(x4, k1k2, 0x00), t4);
+
+        x1 = _mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)&buf[0x00]));
+        x2 = _mm_xor_si128(x2, _mm_loadu_si128((const __m128i*)&buf[0x10]));
+        x3 = _mm_xor_si128(x3, _mm_loadu_si128((const __m128i*)&buf[0x20]));
+        x4 = _mm_xor_si128(x4, _mm_loadu_si128((const __m128i*)&buf[0x30]));
+
+        buf += 64;
+        len -= 64;
+    }
+
+    // fold the four accumulators into one
+    __m128i t;
+    t = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00), t), x2);
+    t = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00), t), x3);
+    t = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00), t), x4);
+
+    while (len >= 16) {
+        t = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x00), t);
+        x1 = _mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)buf));
+
+        buf += 16;
+        len -= 16;
+    }
+
+    // 128 -> 64 bits, appending 32 zero bits to the stream
+    t = _mm_clmulepi64_si128(k3k4, x1, 0x01);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), t);
+
+    // 64 -> 32 bits
+    t = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5, 0x00);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 4), t);
+
+    // bit-reflected barrett reduction
+    t = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly_mu, 0x10);
+    t = _mm_clmulepi64_si128(_mm_and_si128(t, mask32), poly_mu, 0x00);
+    x1 = _mm_xor_si128(x1, t);
+
+    state = (uint32_t)_mm_extract_epi32(x1, 1);
+
+    return crc32_slice8(state, buf, len);
+}
+#endif
+
+static void ps_crc32_build(void) {
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? (c >> 1) ^ PS_CRC32_POLY : (c >> 1);
+        }
+        crc_table[0][i] = c;
+    }
+
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (int s = 1; s < 8; ++s) {
+            crc_table[s][i] = crc_table[0][crc_table[s - 1][i] & 0xFF] ^ (crc_table[s - 1][i] >> 8);
+        }
+    }
+
+    for (uint8_t i = 0; i < sizeof(seed_states) / sizeof(seed_states[0]); ++i) {
+        const uint8_t seed = PS_INPUT_CRC32_SEED + i;
+        seed_states[i] = crc32_slice8(0xFFFFFFFFU, &seed, sizeof(seed));
+    }
+
+    crc_kernel = crc32_slice8;
+
+#if defined(PS_CRC32_HAVE_PCLMUL)
+    __builtin_cpu_init();
+    if ((__builtin_cpu_supports("pclmul")) && (__builtin_cpu_supports("sse4.1"))) {
+        crc_kernel = crc32_pclmul;
+    }
+#endif
+}
+
+void ps_crc32_init(void) {
+    pthread_once(&crc_once, ps_crc32_build);
+}
+
+uint32_t ps_crc32_report(uint8_t seed, const uint8_t *const buf, size_t len) {
+    uint32_t state;
+
+    if ((seed >= PS_INPUT_CRC32_SEED) && (seed <= PS_FEATURE_CRC32_SEED)) {
+        state = seed_states[seed - PS_INPUT_CRC32_SEED];
+    } else {
+        state = crc32_slice8(0xFFFFFFFFU, &seed, sizeof(seed));
+    }
+
+    return ~crc_kernel(state, buf, len);
+}
+
+void ps_crc32_report_seal(uint8_t seed, uint8_t *const report, size_t report_size) {
+    const uint32_t crc = ps_crc32_report(seed, report, report_size - 4);
+
+    report[report_size - 4] = (uint8_t)(crc);
+    report[report_size - 3] = (uint8_t)(crc >> 8);
+    report[report_size - 2] = (uint8_t)(crc >> 16);
+    report[report_size - 1] = (uint8_t)(crc >> 24);
+}
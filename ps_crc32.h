@@ -0,0 +1,27 @@
+#pragma once
+
+#include "rogue_enemy.h"
+
+/* Seed values for DualShock4 / DualSense CRC32 for different report types. */
+#define PS_INPUT_CRC32_SEED     0xA1
+#define PS_OUTPUT_CRC32_SEED    0xA2
+#define PS_FEATURE_CRC32_SEED   0xA3
+
+/**
+ * Build the lookup tables, the cached per-seed CRC state and select the fastest
+ * available CRC32 kernel (PCLMULQDQ folding or slicing-by-8).
+ *
+ * Safe to call more than once and from more than one thread.
+ */
+void ps_crc32_init(void);
+
+/**
+ * Compute the bluetooth checksum of a report as the controller does:
+ * CRC32 (the zlib one) of the seed byte followed by the first len bytes of buf.
+ */
+uint32_t ps_crc32_report(uint8_t seed, const uint8_t *const buf, size_t len);
+
+/**
+ * Store the checksum of the first report_size - 4 bytes of report into its last 4 bytes (little endian).
+ */
+void ps_crc32_report_seal(uint8_t seed, uint8_t *const report, size_t report_size);
@@ -3,10 +3,15 @@
 #include "dev_hidraw.h"
 #include "message.h"
 #include "xbox360.h"
+#include "imu_matrix.h"
 #include <stdio.h>
 
 static const char iio_base_path[] = "/sys/bus/iio/devices/iio:device0/";
 
+// ids of the timers declared at the bottom: timeout callbacks of devices are bound to one of them
+#define RC71L_TIMER_ID 1
+#define RC71L_BMC150_TIMER_ID 2
+
 enum rc71l_leds_mode {
   ROG_ALLY_MODE_STATIC           = 0,
   ROG_ALLY_MODE_BREATHING        = 1,
@@ -219,10 +224,20 @@ static int asus_kbd_ev_map(
 				continue;
 			}
 
+			// keys held during a resynchronization were already handled: screen buttons only trigger actions
+			if ((e->resync) && (
+				(e->ev[i].code == KEY_F16) || (e->ev[i].code == KEY_PROG1) || (e->ev[i].code == KEY_F18) ||
+				(e->ev[i].code == KEY_DELETE) || (e->ev[i].code == KEY_F17)
+			)) {
+				continue;
+			}
+
 			if (e->ev[i].code == KEY_F14) {
 				// this is left back paddle, works as expected
 
-				if (e->ev[i].value == 0) {
+				if (e->resync) {
+					// the press has already been counted
+				} else if (e->ev[i].value == 0) {
 					asus_kbd_user_data->m1 -= (asus_kbd_user_data->m1 == 0) ? 0 : 1;
 				} else if (e->ev[i].value == 1) {
 					asus_kbd_user_data->m1 += 1;
@@ -274,7 +289,9 @@ static int asus_kbd_ev_map(
 			} else if (e->ev[i].code == KEY_F15) {
 				// this is right back paddle, works as expected
 
-				if (e->ev[i].value == 0) {
+				if (e->resync) {
+					// the press has already been counted
+				} else if (e->ev[i].value == 0) {
 					asus_kbd_user_data->m2 -= (asus_kbd_user_data->m2 == 0) ? 0 : 1;
 				} else if (e->ev[i].value == 1) {
 					asus_kbd_user_data->m2 += 1;
@@ -429,6 +446,8 @@ static int asus_kbd_ev_map(
 						.mouse_event = {
 							.type = MOUSE_BTN_LEFT,
 							.value = e->ev[i].value,
+							.flags = EV_MESSAGE_FLAGS_PRESERVE_TIME,
+							.time = e->ev[i].time,
 						}
 					}
 				};
@@ -441,6 +460,8 @@ static int asus_kbd_ev_map(
 						.mouse_event = {
 							.type = MOUSE_BTN_MIDDLE,
 							.value = e->ev[i].value,
+							.flags = EV_MESSAGE_FLAGS_PRESERVE_TIME,
+							.time = e->ev[i].time,
 						}
 					}
 				};
@@ -453,498 +474,22 @@ static int asus_kbd_ev_map(
 						.mouse_event = {
 							.type = MOUSE_BTN_RIGHT,
 							.value = e->ev[i].value,
+							.flags = EV_MESSAGE_FLAGS_PRESERVE_TIME,
+							.time = e->ev[i].time,
 						}
 					}
 				};
 
 				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_LEFTCTRL) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_LCRTL,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_Q) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_Q,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_W) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_W,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_E) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_E,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_R) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_R,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_T) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_T,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_Y) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_Y,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_U) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_U,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_I) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_I,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_O) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_O,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_P) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_P,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_A) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_A,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_S) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_S,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_D) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_D,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_F) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_F,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_G) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_G,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_H) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_H,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_J) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_J,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_K) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_K,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_L) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_L,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_Z) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_Z,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_X) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_X,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_C) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_C,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_V) {
+			} else if (e->ev[i].code < BTN_MISC) {
 				const in_message_t current_message = {
 					.type = KEYBOARD_SET_ELEMENT,
 					.data = {
 						.kbd_set = {
-							.type = KEYBOARD_KEY_V,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_B) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_B,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_N) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_N,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_M) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_M,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_0) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_NUM_0,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_1) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_NUM_1,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_2) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_NUM_2,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_3) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_NUM_3,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_4) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_NUM_4,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_5) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_NUM_5,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_6) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_NUM_6,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_7) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_NUM_7,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_8) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_NUM_8,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_9) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_NUM_9,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_UP) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_UP,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_DOWN) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_DOWN,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_LEFT) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_LEFT,
-							.value = e->ev[i].value
-						}
-					}
-				};
-
-				messages[written_msg++] = current_message;
-			} else if (e->ev[i].code == KEY_RIGHT) {
-				const in_message_t current_message = {
-					.type = KEYBOARD_SET_ELEMENT,
-					.data = {
-						.kbd_set = {
-							.type = KEYBOARD_KEY_RIGHT,
-							.value = e->ev[i].value
+							.code = e->ev[i].code,
+							.value = e->ev[i].value,
+							.flags = EV_MESSAGE_FLAGS_PRESERVE_TIME,
+							.time = e->ev[i].time,
 						}
 					}
 				};
@@ -959,6 +504,8 @@ static int asus_kbd_ev_map(
 						.mouse_event = {
 							.type = MOUSE_ELEMENT_X,
 							.value = e->ev[i].value,
+							.flags = EV_MESSAGE_FLAGS_PRESERVE_TIME,
+							.time = e->ev[i].time,
 						}
 					}
 				};
@@ -971,6 +518,8 @@ static int asus_kbd_ev_map(
 						.mouse_event = {
 							.type = MOUSE_ELEMENT_Y,
 							.value = e->ev[i].value,
+							.flags = EV_MESSAGE_FLAGS_PRESERVE_TIME,
+							.time = e->ev[i].time,
 						}
 					}
 				};
@@ -1014,16 +563,6 @@ static input_dev_t in_iio_dev = {
   //.input_filter_fn = input_filter_imu_identity,
 };
 
-static void rc71l_timer_touchscreen(
-	const dev_in_settings_t *const conf,
-	struct libevdev* evdev,
-    const char* const timer_name,
-    uint64_t expired,
-    void* user_data
-) {
-	
-}
-
 static int touchscreen_ev_map(
 	const dev_in_settings_t *const conf,
 	const evdev_collected_t *const e,
@@ -1101,21 +640,11 @@ static input_dev_t in_touchscreen_dev = {
 	.map = {
 		.ev_callbacks = {
 			.input_map_fn = touchscreen_ev_map,
-			.timeout_callback = rc71l_timer_touchscreen,
+			.timeout_callback = NULL,
 		},
 	}
 };
 
-static void rc71l_timer_asus_kbd(
-	const dev_in_settings_t *const conf,
-	struct libevdev* evdev,
-    const char* const timer_name,
-    uint64_t expired,
-    void* user_data
-) {
-
-}
-
 static input_dev_t in_asus_kb_1_dev = {
   .dev_type = input_dev_type_uinput,
   .filters = {
@@ -1127,7 +656,7 @@ static input_dev_t in_asus_kb_1_dev = {
   .map = {
 	.ev_callbacks = {
 		.input_map_fn = asus_kbd_ev_map,
-		.timeout_callback = rc71l_timer_asus_kbd,
+		.timeout_callback = NULL,
 	},
   }
 };
@@ -1143,7 +672,7 @@ static input_dev_t in_asus_kb_2_dev = {
   .map = {
 	.ev_callbacks = {
 		.input_map_fn = asus_kbd_ev_map,
-		.timeout_callback = rc71l_timer_asus_kbd,
+		.timeout_callback = NULL,
 	},
   }
 };
@@ -1159,7 +688,7 @@ static input_dev_t in_asus_kb_3_dev = {
   .map = {
 	.ev_callbacks = {
 		.input_map_fn = asus_kbd_ev_map,
-		.timeout_callback = rc71l_timer_asus_kbd,
+		.timeout_callback = NULL,
 	},
   }
 };
@@ -1167,14 +696,9 @@ static input_dev_t in_asus_kb_3_dev = {
 static void rc71l_timer_xbox360(
 	const dev_in_settings_t *const conf,
 	struct libevdev* evdev,
-    const char* const timer_name,
     uint64_t expired,
     void* user_data
 ) {
-	if (strcmp(timer_name, "RC71L_timer") != 0) {
-		return;
-	}
-
 	rc71l_xbox360_user_data_t *const xbox360_data = (rc71l_xbox360_user_data_t*)user_data;	
 
 	if (conf->rumble_on_mode_switch) {
@@ -1257,6 +781,7 @@ static input_dev_t in_xbox_dev = {
 	.ev_callbacks = {
 		.input_map_fn = xbox360_ev_map,
 		.timeout_callback = rc71l_timer_xbox360,
+		.timeout_timer_id = RC71L_TIMER_ID,
 	},
   }
 };
@@ -1385,15 +910,10 @@ static const struct {
 static void rc71l_hidraw_timer(
     const dev_in_settings_t *const conf,
     int hidraw_fd,
-    const char* const timer_name,
     uint64_t expired,
     void* user_data
 ) {
-	// one tick is 60ms, avoid all other timers
-	if (strcmp(timer_name, "RC71L_timer") != 0) {
-		return;
-	}
-
+	// one tick is 60ms: only bound to RC71L_timer
 	rc71l_asus_hidraw_user_data_t *const hidraw_data = (rc71l_asus_hidraw_user_data_t*)user_data;
 	if (hidraw_data == NULL) {
 		return;
@@ -1482,6 +1002,7 @@ static input_dev_t nkey_dev = {
 			.rumble_callback = rc71l_hidraw_rumble,
 			.map_callback = rc71l_hidraw_map,
 			.timeout_callback = rc71l_hidraw_timer,
+			.timeout_timer_id = RC71L_TIMER_ID,
 		}
 	}
 };
@@ -1578,26 +1099,13 @@ typedef struct dev_iio {
     FILE* accel_y_fd;
     FILE* accel_z_fd;
 
-    double accel_scale_x;
-    double accel_scale_y;
-    double accel_scale_z;
-
     FILE* anglvel_x_fd;
     FILE* anglvel_y_fd;
     FILE* anglvel_z_fd;
 
-    double anglvel_scale_x;
-    double anglvel_scale_y;
-    double anglvel_scale_z;
-
-    double temp_scale;
-    
-    double outer_temp_scale;
-
-    double mount_matrix[3][3];
-
-    double anglvel_sampling_rate_hz;
-	double accel_sampling_rate_hz;
+    // sensor readings to reported units, built from the sensor scales and the mount matrix
+    imu_matrix_t accel_matrix;
+    imu_matrix_t anglvel_matrix;
 } dev_old_iio_t;
 
 static dev_old_iio_t* dev_old_iio_create(const char* path) {
@@ -1613,27 +1121,14 @@ static dev_old_iio_t* dev_old_iio_create(const char* path) {
     iio->accel_y_fd = NULL;
     iio->accel_z_fd = NULL;
 
-    iio->accel_scale_x = 0.0f;
-    iio->accel_scale_y = 0.0f;
-    iio->accel_scale_z = 0.0f;
-    iio->anglvel_scale_x = 0.0f;
-    iio->anglvel_scale_y = 0.0f;
-    iio->anglvel_scale_z = 0.0f;
-    iio->temp_scale = 0.0f;
-
-    iio->outer_temp_scale = 0.0;
-
-    double mm[3][3] = 
+    const int8_t mm[3][3] =
 		// this is the correct matrix:
 		{
-			{-1.0, 0.0, 0.0},
-			{0.0, 1.0, 0.0},
-			{0.0, 0.0, 1.0}
+			{-1, 0, 0},
+			{0, 1, 0},
+			{0, 0, 1}
 		};
 
-    // store the mount matrix
-    memcpy(iio->mount_matrix, mm, sizeof(mm));
-
     const long path_len = strlen(path) + 1;
     iio->path = malloc(path_len);
     if (iio->path == NULL) {
@@ -1666,15 +1161,19 @@ static dev_old_iio_t* dev_old_iio_create(const char* path) {
 
         char* const anglvel_scale = inline_read_file(iio->path, scale_main_file);
         if (anglvel_scale != NULL) {
-            iio->anglvel_scale_x = iio->anglvel_scale_y = iio->anglvel_scale_z = strtod(anglvel_scale, NULL);
+            double scale = strtod(anglvel_scale, NULL);
             free((void*)anglvel_scale);
 
             if (inline_write_file(iio->path, scale_main_file, preferred_scale, strlen(preferred_scale)) >= 0) {
-                iio->anglvel_scale_x = iio->anglvel_scale_y = iio->anglvel_scale_z = LSB_PER_RAD_S_2000_DEG_S;
-                printf("anglvel scale changed to %f for device %s\n", iio->anglvel_scale_x, iio->name);
+                scale = LSB_PER_RAD_S_2000_DEG_S;
+                printf("anglvel scale changed to %f for device %s\n", scale, iio->name);
             } else {
                 fprintf(stderr, "Unable to set preferred in_anglvel_scale for device %s.\n", iio->name);
             }
+
+            if (imu_matrix_compose(&iio->anglvel_matrix, mm, scale, LSB_PER_RAD_S_2000_DEG_S) != 0) {
+                fprintf(stderr, "Unusable in_anglvel_scale %f for device %s: readings will not be scaled.\n", scale, iio->name);
+            }
         } else {
             // TODO: what about if those are split in in_anglvel_{x,y,z}_scale?
             fprintf(stderr, "Unable to read in_anglvel_scale from path %s%s.\n", iio->path, scale_main_file);
@@ -1693,15 +1192,19 @@ static dev_old_iio_t* dev_old_iio_create(const char* path) {
 
         char* const accel_scale = inline_read_file(iio->path, scale_main_file);
         if (accel_scale != NULL) {
-            iio->accel_scale_x = iio->accel_scale_y = iio->accel_scale_z = strtod(accel_scale, NULL);
+            double scale = strtod(accel_scale, NULL);
             free((void*)accel_scale);
 
             if (inline_write_file(iio->path, scale_main_file, preferred_scale, strlen(preferred_scale)) >= 0) {
-                iio->accel_scale_x = iio->accel_scale_y = iio->accel_scale_z = LSB_PER_16G;
-                printf("accel scale changed to %f for device %s\n", iio->accel_scale_x, iio->name);
+                scale = LSB_PER_16G;
+                printf("accel scale changed to %f for device %s\n", scale, iio->name);
             } else {
                 fprintf(stderr, "Unable to set preferred in_accel_scale for device %s.\n", iio->name);
             }
+
+            if (imu_matrix_compose(&iio->accel_matrix, mm, scale, LSB_PER_16G) != 0) {
+                fprintf(stderr, "Unusable in_accel_scale %f for device %s: readings will not be scaled.\n", scale, iio->name);
+            }
         } else {
             // TODO: what about if those are plit in in_accel_{x,y,z}_scale?
             fprintf(stderr, "Unable to read in_accel_scale file from path %s%s.\n", iio->path, scale_main_file);
@@ -1717,7 +1220,7 @@ static dev_old_iio_t* dev_old_iio_create(const char* path) {
     {
         char* const accel_scale = inline_read_file(iio->path, "/in_temp_scale");
         if (accel_scale != NULL) {
-            iio->temp_scale = strtod(accel_scale, NULL);
+            // temperature is not reported: the file is only required to be there
             free((void*)accel_scale);
         } else {
             fprintf(stderr, "Unable to read in_accel_scale file from path %s%s.\n", iio->path, "/in_accel_scale");
@@ -1744,12 +1247,10 @@ static dev_old_iio_t* dev_old_iio_create(const char* path) {
 
         char* const accel_scale = inline_read_file(iio->path, scale_main_file);
         if (accel_scale != NULL) {
-            iio->anglvel_sampling_rate_hz = strtod(accel_scale, NULL);
             free((void*)accel_scale);
 
             if (inline_write_file(iio->path, scale_main_file, preferred_scale, strlen(preferred_scale)) >= 0) {
-                iio->anglvel_sampling_rate_hz = new_freq;
-                printf("anglvel sampling rate changed to %f for device %s\n", iio->accel_scale_x, iio->name);
+                printf("anglvel sampling rate changed to %f for device %s\n", new_freq, iio->name);
             } else {
                 fprintf(stderr, "Unable to set preferred in_anglvel_sampling_frequency for device %s.\n", iio->name);
             }
@@ -1778,12 +1279,10 @@ static dev_old_iio_t* dev_old_iio_create(const char* path) {
 
         char* const accel_scale = inline_read_file(iio->path, scale_main_file);
         if (accel_scale != NULL) {
-            iio->accel_sampling_rate_hz = strtod(accel_scale, NULL);
             free((void*)accel_scale);
 
             if (inline_write_file(iio->path, scale_main_file, preferred_scale, strlen(preferred_scale)) >= 0) {
-                iio->accel_sampling_rate_hz = new_freq;
-                printf("accel sampling rate changed to %f for device %s\n", iio->accel_scale_x, iio->name);
+                printf("accel sampling rate changed to %f for device %s\n", new_freq, iio->name);
             } else {
                 fprintf(stderr, "Unable to set preferred in_accel_sampling_frequency for device %s.\n", iio->name);
             }
@@ -1832,16 +1331,6 @@ static dev_old_iio_t* dev_old_iio_create(const char* path) {
 
     free(tmp);
 
-    printf(
-        "anglvel scale: x=%f, y=%f, z=%f | accel scale: x=%f, y=%f, z=%f\n",
-        iio->anglvel_scale_x,
-        iio->anglvel_scale_y,
-        iio->anglvel_scale_z,
-        iio->accel_scale_x,
-        iio->accel_scale_y,
-        iio->accel_scale_z
-    );
-
     // give time to change the scale
     sleep(4);
 
@@ -1869,12 +1358,6 @@ const char* dev_old_iio_get_path(const dev_old_iio_t* iio) {
     return iio->path;
 }
 
-static void multiplyMatrixVector(const double matrix[3][3], const double vector[3], double result[3]) {
-    result[0] = matrix[0][0] * vector[0] + matrix[1][0] * vector[1] + matrix[2][0] * vector[2];
-    result[1] = matrix[0][1] * vector[0] + matrix[1][1] * vector[1] + matrix[2][1] * vector[2];
-    result[2] = matrix[0][2] * vector[0] + matrix[1][2] * vector[1] + matrix[2][2] * vector[2];
-}
-
 int dev_old_iio_read_imu(const dev_old_iio_t *const iio, in_message_t *const messages) {
 	int res = 0;
 
@@ -1886,8 +1369,8 @@ int dev_old_iio_read_imu(const dev_old_iio_t *const iio, in_message_t *const mes
 
 	const uint64_t nanoseconds = (tp.tv_sec * 1000000000ULL) + tp.tv_nsec;
 
-	uint16_t accel_x_raw = 0, accel_y_raw = 0, accel_z_raw = 0;
-	uint16_t gyro_x_raw = 0, gyro_y_raw = 0, gyro_z_raw = 0;
+	int16_t accel_raw[3] = {0, 0, 0};
+	int16_t gyro_raw[3] = {0, 0, 0};
 
     char tmp[128];
 
@@ -1897,7 +1380,7 @@ int dev_old_iio_read_imu(const dev_old_iio_t *const iio, in_message_t *const mes
         memset((void*)&tmp[0], 0, sizeof(tmp));
         const int tmp_read = fread((void*)&tmp[0], 1, sizeof(tmp), iio->accel_x_fd);
         if (tmp_read >= 0) {
-            accel_x_raw = strtol(&tmp[0], NULL, 10);
+            accel_raw[0] = strtol(&tmp[0], NULL, 10);
         } else {
             fprintf(stderr, "While reading accel(x): %d\n", tmp_read);
             goto dev_old_iio_read_imu_err;
@@ -1909,7 +1392,7 @@ int dev_old_iio_read_imu(const dev_old_iio_t *const iio, in_message_t *const mes
         memset((void*)&tmp[0], 0, sizeof(tmp));
         const int tmp_read = fread((void*)&tmp[0], 1, sizeof(tmp), iio->accel_y_fd);
         if (tmp_read >= 0) {
-            accel_y_raw = strtol(&tmp[0], NULL, 10);
+            accel_raw[1] = strtol(&tmp[0], NULL, 10);
         } else {
             fprintf(stderr, "While reading accel(y): %d\n", tmp_read);
             goto dev_old_iio_read_imu_err;
@@ -1921,7 +1404,7 @@ int dev_old_iio_read_imu(const dev_old_iio_t *const iio, in_message_t *const mes
         memset((void*)&tmp[0], 0, sizeof(tmp));
         const int tmp_read = fread((void*)&tmp[0], 1, sizeof(tmp), iio->accel_z_fd);
         if (tmp_read >= 0) {
-            accel_z_raw = strtol(&tmp[0], NULL, 10);
+            accel_raw[2] = strtol(&tmp[0], NULL, 10);
         } else {
             fprintf(stderr, "While reading accel(z): %d\n", tmp_read);
             goto dev_old_iio_read_imu_err;
@@ -1933,7 +1416,7 @@ int dev_old_iio_read_imu(const dev_old_iio_t *const iio, in_message_t *const mes
         memset((void*)&tmp[0], 0, sizeof(tmp));
         const int tmp_read = fread((void*)&tmp[0], 1, sizeof(tmp), iio->anglvel_x_fd);
         if (tmp_read >= 0) {
-            gyro_x_raw = strtol(&tmp[0], NULL, 10);
+            gyro_raw[0] = strtol(&tmp[0], NULL, 10);
         } else {
             fprintf(stderr, "While reading anglvel(x): %d\n", tmp_read);
             goto dev_old_iio_read_imu_err;
@@ -1945,7 +1428,7 @@ int dev_old_iio_read_imu(const dev_old_iio_t *const iio, in_message_t *const mes
         memset((void*)&tmp[0], 0, sizeof(tmp));
         const int tmp_read = fread((void*)&tmp[0], 1, sizeof(tmp), iio->anglvel_y_fd);
         if (tmp_read >= 0) {
-            gyro_y_raw = strtol(&tmp[0], NULL, 10);
+            gyro_raw[1] = strtol(&tmp[0], NULL, 10);
         } else {
             fprintf(stderr, "While reading anglvel(y): %d\n", tmp_read);
             goto dev_old_iio_read_imu_err;
@@ -1957,26 +1440,30 @@ int dev_old_iio_read_imu(const dev_old_iio_t *const iio, in_message_t *const mes
         memset((void*)&tmp[0], 0, sizeof(tmp));
         const int tmp_read = fread((void*)&tmp[0], 1, sizeof(tmp), iio->anglvel_z_fd);
         if (tmp_read >= 0) {
-            gyro_z_raw = strtol(&tmp[0], NULL, 10);
+            gyro_raw[2] = strtol(&tmp[0], NULL, 10);
         } else {
             fprintf(stderr, "While reading anglvel(z): %d\n", tmp_read);
             goto dev_old_iio_read_imu_err;
         }
     }
 
+	int16_t accel[3], gyro[3];
+	imu_matrix_apply(&iio->accel_matrix, accel_raw, accel);
+	imu_matrix_apply(&iio->anglvel_matrix, gyro_raw, gyro);
+
 	messages[0].type = GAMEPAD_SET_ELEMENT;
     messages[0].data.gamepad_set.element = GAMEPAD_ACCELEROMETER;
-    messages[1].data.gamepad_set.status.accel.sample_timestamp_ns = nanoseconds;
-    messages[0].data.gamepad_set.status.accel.x = (uint16_t)(-1) * accel_x_raw;
-    messages[0].data.gamepad_set.status.accel.y = accel_y_raw;
-    messages[0].data.gamepad_set.status.accel.z = accel_z_raw;
+    messages[0].data.gamepad_set.status.accel.sample_timestamp_ns = nanoseconds;
+    messages[0].data.gamepad_set.status.accel.x = (uint16_t)accel[0];
+    messages[0].data.gamepad_set.status.accel.y = (uint16_t)accel[1];
+    messages[0].data.gamepad_set.status.accel.z = (uint16_t)accel[2];
 
     messages[1].type = GAMEPAD_SET_ELEMENT;
     messages[1].data.gamepad_set.element = GAMEPAD_GYROSCOPE;
     messages[1].data.gamepad_set.status.gyro.sample_timestamp_ns = nanoseconds;
-    messages[1].data.gamepad_set.status.gyro.x = (uint16_t)(-1) * gyro_x_raw;
-    messages[1].data.gamepad_set.status.gyro.y = gyro_y_raw;
-    messages[1].data.gamepad_set.status.gyro.z = gyro_z_raw;
+    messages[1].data.gamepad_set.status.gyro.x = (uint16_t)gyro[0];
+    messages[1].data.gamepad_set.status.gyro.y = (uint16_t)gyro[1];
+    messages[1].data.gamepad_set.status.gyro.z = (uint16_t)gyro[2];
 
 	res = 2;
 
@@ -1996,24 +1483,24 @@ static bmc150_accel_user_data_t bmc150_timer_data = {
 	.errors = 0,
 };
 
-int rc71l_bmc150_accel_timer_map(const dev_in_settings_t *const conf, int timer_fd, uint64_t expirations, in_message_t *const messages, size_t messages_len, void* user_data) {
-	bmc150_accel_user_data_t *const timer_data = (bmc150_accel_user_data_t*)user_data;
+static const uint64_t bmc150_accel_max_attempts = 250000000;
 
-	static const uint64_t max_attempts = 250000000;
+int rc71l_bmc150_accel_timer_map(const dev_in_settings_t *const conf, uint64_t expirations, in_message_t *const messages, size_t messages_len, void* user_data) {
+	bmc150_accel_user_data_t *const timer_data = (bmc150_accel_user_data_t*)user_data;
 
 	if (timer_data == NULL) {
 		return 0;
 	}
 
 	if (timer_data->iio == NULL) {
-		if (timer_data->errors < max_attempts) {
+		if (timer_data->errors < bmc150_accel_max_attempts) {
 			// try to open the device and give up after some errors
 			timer_data->iio = dev_old_iio_create(iio_base_path);
 
 			if (timer_data->iio == NULL) {
 				timer_data->errors++;
 
-				if (timer_data->errors == max_attempts) {
+				if (timer_data->errors == bmc150_accel_max_attempts) {
 					fprintf(stderr, "Max attempts to acquire bmc150 accel driver reached.\n");
 				}
 			}
@@ -2028,10 +1515,18 @@ int rc71l_bmc150_accel_timer_map(const dev_in_settings_t *const conf, int timer_
 	return 0;
 }
 
+static bool rc71l_bmc150_accel_timer_busy(const dev_in_settings_t *const conf, void* user_data) {
+	const bmc150_accel_user_data_t *const timer_data = (const bmc150_accel_user_data_t*)user_data;
+
+	// once the device could not be acquired there is nothing left to poll
+	return (timer_data != NULL) && ((timer_data->iio != NULL) || (timer_data->errors < bmc150_accel_max_attempts));
+}
+
 input_dev_t bmc150_timer_dev = {
 	.dev_type = input_dev_type_timer,
 	.filters = {
 		.timer = {
+			.id = RC71L_BMC150_TIMER_ID,
 			.name = "RC71L_bmc150-accel_timer",
 			.ticktime_ms = 0,
 			.ticktime_ns = 1250000
@@ -2041,11 +1536,12 @@ input_dev_t bmc150_timer_dev = {
 	.map = {
 		.timer_callbacks = {
 			.map_fn = rc71l_bmc150_accel_timer_map,
+			.busy_fn = rc71l_bmc150_accel_timer_busy,
 		}
 	}
 };
 
-int rc71l_timer_map(const dev_in_settings_t *const conf, int timer_fd, uint64_t expirations, in_message_t *const messages, size_t messages_len, void* user_data) {
+int rc71l_timer_map(const dev_in_settings_t *const conf, uint64_t expirations, in_message_t *const messages, size_t messages_len, void* user_data) {
 	rc71l_timer_user_data_t *const timer_data = (rc71l_timer_user_data_t*)user_data;
 	rc71l_platform_t *const platform_data = timer_data->parent;
 
@@ -2056,10 +1552,39 @@ int rc71l_timer_map(const dev_in_settings_t *const conf, int timer_fd, uint64_t
 	return 0;
 }
 
+static bool rc71l_timer_busy(const dev_in_settings_t *const conf, void* user_data) {
+	const rc71l_timer_user_data_t *const timer_data = (const rc71l_timer_user_data_t*)user_data;
+	const rc71l_platform_t *const platform_data = timer_data->parent;
+
+	if (platform_data == NULL) {
+		return false;
+	}
+
+	// a mode switch to be notified or its rumble to be timed
+	const rc71l_xbox360_user_data_t *const xbox360_data = platform_data->xbox360_user_data;
+	if (
+		(conf->rumble_on_mode_switch) &&
+		((xbox360_data->accounted_mode_switches != xbox360_data->mode_switched) || (xbox360_data->mode_switch_rumbling))
+	) {
+		return true;
+	}
+
+	// a thermal profile to be applied or its leds to be restored
+	if (
+		(conf->enable_thermal_profiles_switching) &&
+		(platform_data->current_thermal_profile != platform_data->next_thermal_profile)
+	) {
+		return true;
+	}
+
+	return false;
+}
+
 input_dev_t timer_dev = {
 	.dev_type = input_dev_type_timer,
 	.filters = {
 		.timer = {
+			.id = RC71L_TIMER_ID,
 			.name = "RC71L_timer",
 			.ticktime_ms = 60,
 			.ticktime_ns = 0,
@@ -2069,6 +1594,7 @@ input_dev_t timer_dev = {
 	.map = {
 		.timer_callbacks = {
 			.map_fn = rc71l_timer_map,
+			.busy_fn = rc71l_timer_busy,
 		}
 	}
 };
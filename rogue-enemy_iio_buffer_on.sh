@@ -47,6 +47,9 @@ for i in /sys/bus/iio/devices/* ; do
         # enable timestamp reporting
         echo 1 > "$i/scan_elements/in_timestamp_en"
 
+        # stamp samples with the clock stray-ally uses to predict motion
+        echo "monotonic" > "$i/current_timestamp_clock"
+
         # bind rogue hrtimer to to the iio device
         echo "rogue" > "$i/trigger/current_trigger"
 
@@ -126,3 +126,63 @@ int inline_write_file(const char* base_path, const char *file, const void* buf,
 inline_write_file_err:
     return res;
 }
+
+int write_input_frame(int fd, struct input_event *const events, size_t events_count, const struct timeval *const time) {
+    int res = 0;
+
+    for (size_t i = 0; i < events_count; ++i) {
+        events[i].time = *time;
+    }
+
+    // the whole frame (SYN_REPORT included) goes in a single write: uinput consumes
+    // complete events only so a short write leaves the remaining ones to be written again
+    const uint8_t *buf = (const uint8_t*)events;
+    size_t remaining = events_count * sizeof(struct input_event);
+    while (remaining > 0) {
+        const ssize_t written = write(fd, (const void*)buf, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            res = errno > 0 ? -1 * errno : errno;
+            res = res == 0 ? -EIO : res;
+            fprintf(stderr, "Error writing input frame: %zu bytes left out of %zu\n", remaining, events_count * sizeof(struct input_event));
+            goto write_input_frame_err;
+        } else if (written == 0) {
+            res = -EIO;
+            fprintf(stderr, "Error writing input frame: %zu bytes left out of %zu\n", remaining, events_count * sizeof(struct input_event));
+            goto write_input_frame_err;
+        }
+
+        buf += written;
+        remaining -= (size_t)written;
+    }
+
+write_input_frame_err:
+    return res;
+}
+
+void input_frame_time(struct timeval *const out, const struct timeval *const source, const struct timeval *const now, struct timeval *const prev) {
+    if (source != NULL) {
+        *out = *source;
+    } else if (now != NULL) {
+        *out = *now;
+    } else {
+        gettimeofday(out, NULL);
+    }
+
+    if (timercmp(out, prev, <)) {
+        *out = *prev;
+    }
+
+    *prev = *out;
+}
+
+void input_frame_msc_timestamp(struct input_event *const ev, const struct timeval *const time) {
+    const uint64_t usec = (uint64_t)time->tv_sec * (uint64_t)1000000 + (uint64_t)time->tv_usec;
+
+    ev->type = EV_MSC;
+    ev->code = MSC_TIMESTAMP;
+    ev->value = (int32_t)(uint32_t)usec;
+}
@@ -44,8 +44,6 @@
 
 #include <libudev.h>
 
-#include <zlib.h>
-
 #define LSB_PER_RAD_S_2000_DEG_S ((double)0.001064724)
 #define LSB_PER_RAD_S_2000_DEG_S_STR "0.001064724"
 
@@ -76,4 +74,22 @@ ssize_t dmi_board_name(char *const buf, size_t buf_len);
 
 char* inline_read_file(const char* base_path, const char *file);
 
-int inline_write_file(const char* base_path, const char *file, const void* buf, size_t buf_sz);
\ No newline at end of file
+int inline_write_file(const char* base_path, const char *file, const void* buf, size_t buf_sz);
+
+/**
+ * Write events_count events in a single frame: every event gets the same timestamp and the caller
+ * is responsible for the last one being a SYN_REPORT.
+ */
+int write_input_frame(int fd, struct input_event *const events, size_t events_count, const struct timeval *const time);
+
+/**
+ * Timestamp of the next frame written to a device: the newest source event merged into the frame
+ * when known (source may be NULL), now otherwise. prev is the one of the last frame written to the
+ * same device and gets updated: frames never go back in time even if sources are not in order.
+ */
+void input_frame_time(struct timeval *const out, const struct timeval *const source, const struct timeval *const now, struct timeval *const prev);
+
+/**
+ * Fill ev with the MSC_TIMESTAMP event (microseconds, wrapping around) of a frame stamped with time.
+ */
+void input_frame_msc_timestamp(struct input_event *const ev, const struct timeval *const time);
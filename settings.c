@@ -90,6 +90,57 @@ void load_in_config(dev_in_settings_t *const out_conf, const char* const filepat
         fprintf(stderr, "imu_polling_interface (bool) configuration not found. Default value will be used.\n");
     }
 
+    int imu_filter;
+    if (config_lookup_int(&cfg, "imu_filter", &imu_filter) != CONFIG_FALSE) {
+        if ((imu_filter >= 0) && (imu_filter <= 2)) {
+            out_conf->imu_filter = imu_filter;
+        } else {
+            fprintf(stderr, "imu_filter (int) must be a number between 0 and 2\n");
+        }
+    } else {
+        fprintf(stderr, "imu_filter (int) configuration not found. Default value will be used.\n");
+    }
+
+    double imu_filter_min_cutoff_hz;
+    if (config_lookup_float(&cfg, "imu_filter_min_cutoff_hz", &imu_filter_min_cutoff_hz) != CONFIG_FALSE) {
+        if ((imu_filter_min_cutoff_hz > 0.0) && (imu_filter_min_cutoff_hz <= 1000.0)) {
+            out_conf->imu_filter_min_cutoff_hz = imu_filter_min_cutoff_hz;
+        } else {
+            fprintf(stderr, "imu_filter_min_cutoff_hz (float) must be greater than zero and at most 1000\n");
+        }
+    } else {
+        fprintf(stderr, "imu_filter_min_cutoff_hz (float) configuration not found. Default value will be used.\n");
+    }
+
+    double imu_filter_beta;
+    if (config_lookup_float(&cfg, "imu_filter_beta", &imu_filter_beta) != CONFIG_FALSE) {
+        if ((imu_filter_beta >= 0.0) && (imu_filter_beta <= 1000.0)) {
+            out_conf->imu_filter_beta = imu_filter_beta;
+        } else {
+            fprintf(stderr, "imu_filter_beta (float) must be between 0 and 1000\n");
+        }
+    } else {
+        fprintf(stderr, "imu_filter_beta (float) configuration not found. Default value will be used.\n");
+    }
+
+    double imu_filter_cutoff_hz;
+    if (config_lookup_float(&cfg, "imu_filter_cutoff_hz", &imu_filter_cutoff_hz) != CONFIG_FALSE) {
+        if ((imu_filter_cutoff_hz > 0.0) && (imu_filter_cutoff_hz <= 1000.0)) {
+            out_conf->imu_filter_cutoff_hz = imu_filter_cutoff_hz;
+        } else {
+            fprintf(stderr, "imu_filter_cutoff_hz (float) must be greater than zero and at most 1000\n");
+        }
+    } else {
+        fprintf(stderr, "imu_filter_cutoff_hz (float) configuration not found. Default value will be used.\n");
+    }
+
+    int gyro_bias_estimation;
+    if (config_lookup_bool(&cfg, "gyro_bias_estimation", &gyro_bias_estimation) != CONFIG_FALSE) {
+        out_conf->gyro_bias_estimation = gyro_bias_estimation;
+    } else {
+        fprintf(stderr, "gyro_bias_estimation (bool) configuration not found. Default value will be used.\n");
+    }
+
     config_destroy(&cfg);
 
 load_in_config_err:
@@ -115,7 +166,7 @@ void load_out_config(dev_out_settings_t *const out_conf, const char* const filep
 
     int default_gamepad;
     if (config_lookup_int(&cfg, "default_gamepad", &default_gamepad) != CONFIG_FALSE) {
-        out_conf->default_gamepad = default_gamepad % 3;
+        out_conf->default_gamepad = default_gamepad % 5;
     } else {
         fprintf(stderr, "default_gamepad (int) configuration not found. Default value will be used.\n");
     }
@@ -176,6 +227,184 @@ void load_out_config(dev_out_settings_t *const out_conf, const char* const filep
         fprintf(stderr, "gyro_to_analog_mapping (int) configuration not found. Default value will be used.\n");
     }
 
+    double gyro_to_analog_exponent;
+    if (config_lookup_float(&cfg, "gyro_to_analog_exponent", &gyro_to_analog_exponent) != CONFIG_FALSE) {
+        if (gyro_to_analog_exponent > 0.0) {
+            out_conf->gyro_to_analog_exponent = gyro_to_analog_exponent;
+        } else {
+            fprintf(stderr, "gyro_to_analog_exponent (float) must be greater than zero\n");
+        }
+    } else {
+        fprintf(stderr, "gyro_to_analog_exponent (float) configuration not found. Default value will be used.\n");
+    }
+
+    int stick_inner_deadzone;
+    if (config_lookup_int(&cfg, "stick_inner_deadzone", &stick_inner_deadzone) != CONFIG_FALSE) {
+        if ((stick_inner_deadzone >= 0) && (stick_inner_deadzone < 100)) {
+            out_conf->sticks_curve.inner_deadzone = stick_inner_deadzone;
+        } else {
+            fprintf(stderr, "stick_inner_deadzone (int) must be a percentage between 0 and 99\n");
+        }
+    } else {
+        fprintf(stderr, "stick_inner_deadzone (int) configuration not found. Default value will be used.\n");
+    }
+
+    int stick_outer_deadzone;
+    if (config_lookup_int(&cfg, "stick_outer_deadzone", &stick_outer_deadzone) != CONFIG_FALSE) {
+        if ((stick_outer_deadzone >= 0) && (stick_outer_deadzone < 100)) {
+            out_conf->sticks_curve.outer_deadzone = stick_outer_deadzone;
+        } else {
+            fprintf(stderr, "stick_outer_deadzone (int) must be a percentage between 0 and 99\n");
+        }
+    } else {
+        fprintf(stderr, "stick_outer_deadzone (int) configuration not found. Default value will be used.\n");
+    }
+
+    int stick_anti_deadzone;
+    if (config_lookup_int(&cfg, "stick_anti_deadzone", &stick_anti_deadzone) != CONFIG_FALSE) {
+        if ((stick_anti_deadzone >= 0) && (stick_anti_deadzone < 100)) {
+            out_conf->sticks_curve.anti_deadzone = stick_anti_deadzone;
+        } else {
+            fprintf(stderr, "stick_anti_deadzone (int) must be a percentage between 0 and 99\n");
+        }
+    } else {
+        fprintf(stderr, "stick_anti_deadzone (int) configuration not found. Default value will be used.\n");
+    }
+
+    double stick_exponent;
+    if (config_lookup_float(&cfg, "stick_exponent", &stick_exponent) != CONFIG_FALSE) {
+        if (stick_exponent > 0.0) {
+            out_conf->sticks_curve.exponent = stick_exponent;
+        } else {
+            fprintf(stderr, "stick_exponent (float) must be greater than zero\n");
+        }
+    } else {
+        fprintf(stderr, "stick_exponent (float) configuration not found. Default value will be used.\n");
+    }
+
+    int stick_radial_deadzone;
+    if (config_lookup_bool(&cfg, "stick_radial_deadzone", &stick_radial_deadzone) != CONFIG_FALSE) {
+        out_conf->sticks_radial = stick_radial_deadzone;
+    } else {
+        fprintf(stderr, "stick_radial_deadzone (bool) configuration not found. Default value will be used.\n");
+    }
+
+    int trigger_inner_deadzone;
+    if (config_lookup_int(&cfg, "trigger_inner_deadzone", &trigger_inner_deadzone) != CONFIG_FALSE) {
+        if ((trigger_inner_deadzone >= 0) && (trigger_inner_deadzone < 100)) {
+            out_conf->triggers_curve.inner_deadzone = trigger_inner_deadzone;
+        } else {
+            fprintf(stderr, "trigger_inner_deadzone (int) must be a percentage between 0 and 99\n");
+        }
+    } else {
+        fprintf(stderr, "trigger_inner_deadzone (int) configuration not found. Default value will be used.\n");
+    }
+
+    int trigger_outer_deadzone;
+    if (config_lookup_int(&cfg, "trigger_outer_deadzone", &trigger_outer_deadzone) != CONFIG_FALSE) {
+        if ((trigger_outer_deadzone >= 0) && (trigger_outer_deadzone < 100)) {
+            out_conf->triggers_curve.outer_deadzone = trigger_outer_deadzone;
+        } else {
+            fprintf(stderr, "trigger_outer_deadzone (int) must be a percentage between 0 and 99\n");
+        }
+    } else {
+        fprintf(stderr, "trigger_outer_deadzone (int) configuration not found. Default value will be used.\n");
+    }
+
+    int trigger_anti_deadzone;
+    if (config_lookup_int(&cfg, "trigger_anti_deadzone", &trigger_anti_deadzone) != CONFIG_FALSE) {
+        if ((trigger_anti_deadzone >= 0) && (trigger_anti_deadzone < 100)) {
+            out_conf->triggers_curve.anti_deadzone = trigger_anti_deadzone;
+        } else {
+            fprintf(stderr, "trigger_anti_deadzone (int) must be a percentage between 0 and 99\n");
+        }
+    } else {
+        fprintf(stderr, "trigger_anti_deadzone (int) configuration not found. Default value will be used.\n");
+    }
+
+    double trigger_exponent;
+    if (config_lookup_float(&cfg, "trigger_exponent", &trigger_exponent) != CONFIG_FALSE) {
+        if (trigger_exponent > 0.0) {
+            out_conf->triggers_curve.exponent = trigger_exponent;
+        } else {
+            fprintf(stderr, "trigger_exponent (float) must be greater than zero\n");
+        }
+    } else {
+        fprintf(stderr, "trigger_exponent (float) configuration not found. Default value will be used.\n");
+    }
+
+    int gyro_to_mouse;
+    if (config_lookup_bool(&cfg, "gyro_to_mouse", &gyro_to_mouse) != CONFIG_FALSE) {
+        out_conf->gyro_to_mouse = gyro_to_mouse;
+    } else {
+        fprintf(stderr, "gyro_to_mouse (bool) configuration not found. Default value will be used.\n");
+    }
+
+    int gyro_to_mouse_ratchet;
+    if (config_lookup_bool(&cfg, "gyro_to_mouse_ratchet", &gyro_to_mouse_ratchet) != CONFIG_FALSE) {
+        out_conf->gyro_to_mouse_ratchet = gyro_to_mouse_ratchet;
+    } else {
+        fprintf(stderr, "gyro_to_mouse_ratchet (bool) configuration not found. Default value will be used.\n");
+    }
+
+    double gyro_to_mouse_sensitivity;
+    if (config_lookup_float(&cfg, "gyro_to_mouse_sensitivity", &gyro_to_mouse_sensitivity) != CONFIG_FALSE) {
+        if ((gyro_to_mouse_sensitivity > 0.0) && (gyro_to_mouse_sensitivity <= 1000.0)) {
+            out_conf->gyro_to_mouse_sensitivity = gyro_to_mouse_sensitivity;
+        } else {
+            fprintf(stderr, "gyro_to_mouse_sensitivity (float) must be greater than zero and at most 1000\n");
+        }
+    } else {
+        fprintf(stderr, "gyro_to_mouse_sensitivity (float) configuration not found. Default value will be used.\n");
+    }
+
+    double gyro_to_mouse_acceleration;
+    if (config_lookup_float(&cfg, "gyro_to_mouse_acceleration", &gyro_to_mouse_acceleration) != CONFIG_FALSE) {
+        if ((gyro_to_mouse_acceleration >= 0.0) && (gyro_to_mouse_acceleration <= 10.0)) {
+            out_conf->gyro_to_mouse_acceleration = gyro_to_mouse_acceleration;
+        } else {
+            fprintf(stderr, "gyro_to_mouse_acceleration (float) must be between 0 and 10\n");
+        }
+    } else {
+        fprintf(stderr, "gyro_to_mouse_acceleration (float) configuration not found. Default value will be used.\n");
+    }
+
+    int motion_prediction;
+    if (config_lookup_bool(&cfg, "motion_prediction", &motion_prediction) != CONFIG_FALSE) {
+        out_conf->motion_prediction = motion_prediction;
+    } else {
+        fprintf(stderr, "motion_prediction (bool) configuration not found. Default value will be used.\n");
+    }
+
+    int motion_prediction_quadratic;
+    if (config_lookup_bool(&cfg, "motion_prediction_quadratic", &motion_prediction_quadratic) != CONFIG_FALSE) {
+        out_conf->motion_prediction_quadratic = motion_prediction_quadratic;
+    } else {
+        fprintf(stderr, "motion_prediction_quadratic (bool) configuration not found. Default value will be used.\n");
+    }
+
+    int motion_prediction_horizon_us;
+    if (config_lookup_int(&cfg, "motion_prediction_horizon_us", &motion_prediction_horizon_us) != CONFIG_FALSE) {
+        if ((motion_prediction_horizon_us > 0) && (motion_prediction_horizon_us <= 20000)) {
+            out_conf->motion_prediction_horizon_us = motion_prediction_horizon_us;
+        } else {
+            fprintf(stderr, "motion_prediction_horizon_us (int) must be between 1 and 20000\n");
+        }
+    } else {
+        fprintf(stderr, "motion_prediction_horizon_us (int) configuration not found. Default value will be used.\n");
+    }
+
+    int motion_prediction_max_delta;
+    if (config_lookup_int(&cfg, "motion_prediction_max_delta", &motion_prediction_max_delta) != CONFIG_FALSE) {
+        if ((motion_prediction_max_delta >= 0) && (motion_prediction_max_delta <= 32767)) {
+            out_conf->motion_prediction_max_delta = motion_prediction_max_delta;
+        } else {
+            fprintf(stderr, "motion_prediction_max_delta (int) must be between 0 and 32767\n");
+        }
+    } else {
+        fprintf(stderr, "motion_prediction_max_delta (int) configuration not found. Default value will be used.\n");
+    }
+
     config_destroy(&cfg);
 
 load_out_config_err:
@@ -13,10 +13,28 @@ typedef struct dev_in_settings {
     bool enable_leds_commands;
     bool enable_imu;
     bool imu_polling_interface;
+    uint8_t imu_filter; // 0: none, 1: 1-euro, 2: biquad low-pass
+    double imu_filter_min_cutoff_hz; // 1-euro: cutoff frequency when the reading does not change
+    double imu_filter_beta; // 1-euro: cutoff frequency added for every 1000 LSB per second of change
+    double imu_filter_cutoff_hz; // biquad: cutoff frequency
+    bool gyro_bias_estimation; // learn the gyroscope offset while the device lies still and remove it
 } dev_in_settings_t;
 
 void load_in_config(dev_in_settings_t *const out_conf, const char* const filepath);
 
+/**
+ * Shape of a response curve: deadzones are percentages of the full range.
+ *
+ * Inputs below inner_deadzone give no output, inputs past (100 - outer_deadzone) give the full output,
+ * in between the output goes from anti_deadzone to the full output following a power of exponent.
+ */
+typedef struct response_curve_settings {
+    int inner_deadzone;
+    int outer_deadzone;
+    int anti_deadzone;
+    double exponent;
+} response_curve_settings_t;
+
 typedef struct dev_out_settings {
     bool nintendo_layout;
     uint8_t default_gamepad;
@@ -28,6 +46,18 @@ typedef struct dev_out_settings {
     bool invert_x;
     int gyro_to_analog_activation_treshold;
     int gyro_to_analog_mapping;
+    double gyro_to_analog_exponent; // 1.0: the stick moves proportionally to the rotation speed
+    response_curve_settings_t sticks_curve;
+    bool sticks_radial; // the curve applies to the distance from the center instead of each axis
+    response_curve_settings_t triggers_curve;
+    bool gyro_to_mouse; // join buttons drive the mouse pointer with the gyroscope instead of sticks
+    bool gyro_to_mouse_ratchet; // gyro mouse always on, join buttons held freeze the pointer instead of toggling it
+    double gyro_to_mouse_sensitivity; // pixels per degree of rotation
+    double gyro_to_mouse_acceleration; // sensitivity added for every 100 degrees per second of rotation speed
+    bool motion_prediction; // extrapolate gyroscope and accelerometer to the time reports are sent
+    bool motion_prediction_quadratic; // fit the last three samples instead of the last two
+    int motion_prediction_horizon_us; // never extrapolate further than this
+    int motion_prediction_max_delta; // never move a reading further than this (in LSB) from the last sample
 } dev_out_settings_t;
 
 void load_out_config(dev_out_settings_t *const out_conf, const char* const filepath);
\ No newline at end of file
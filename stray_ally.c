@@ -11,6 +11,58 @@
 
 static const char* configuration_file = "/etc/ROGueENEMY/config.cfg";
 
+static int listen_socket(const char *const path, int type) {
+    struct sockaddr_un serveraddr;
+
+    const int sd = socket(AF_UNIX, type | SOCK_CLOEXEC, 0);
+    if (sd < 0) {
+        fprintf(stderr, "socket() failed");
+        return -errno;
+    }
+
+    memset(&serveraddr, 0, sizeof(serveraddr));
+    serveraddr.sun_family = AF_UNIX;
+    strncpy(serveraddr.sun_path, path, sizeof(serveraddr.sun_path) - 1);
+
+    int rc = bind(sd, (struct sockaddr *)&serveraddr, SUN_LEN(&serveraddr));
+    if (rc < 0) {
+        rc = -errno;
+        perror("bind() failed");
+        close(sd);
+        return rc;
+    }
+
+    rc = listen(sd, MAX_CONNECTED_CLIENTS - 1);
+    if (rc < 0) {
+        rc = -errno;
+        perror("listen() failed");
+        close(sd);
+        return rc;
+    }
+
+    return sd;
+}
+
+static void accept_client(int sd, atomic_int *const clients, const char *const lane) {
+    const int client_fd = accept(sd, NULL, NULL);
+    if (client_fd < 0) {
+        fprintf(stderr, "Error in getting a client connected: %d\n", client_fd);
+        return;
+    }
+
+    // here the client_fd is good: publish it in a free slot, dev_out picks it up on its next iteration
+    for (size_t i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
+        int expected = -1;
+        if (atomic_compare_exchange_strong(&clients[i], &expected, client_fd)) {
+            printf("Accepted new incoming connection (%s lane) on slot %zu: %d\n", lane, i, client_fd);
+            return;
+        }
+    }
+
+    fprintf(stderr, "Could not find a free spot fot the incoming client -- client will be rejected\n");
+    close(client_fd);
+}
+
 int main(int argc, char ** argv) {
     // Lock all current and future pages from preventing of being paged to swap
     const int lockall_res = mlockall( MCL_CURRENT | MCL_FUTURE );
@@ -31,6 +83,28 @@ int main(int argc, char ** argv) {
         .invert_x = false,
         .gyro_to_analog_activation_treshold = 16,
         .gyro_to_analog_mapping = 4,
+        .gyro_to_analog_exponent = 1.0,
+        .sticks_curve = {
+            .inner_deadzone = 0,
+            .outer_deadzone = 0,
+            .anti_deadzone = 0,
+            .exponent = 1.0,
+        },
+        .sticks_radial = false,
+        .triggers_curve = {
+            .inner_deadzone = 0,
+            .outer_deadzone = 0,
+            .anti_deadzone = 0,
+            .exponent = 1.0,
+        },
+        .gyro_to_mouse = false,
+        .gyro_to_mouse_ratchet = false,
+        .gyro_to_mouse_sensitivity = 8.0,
+        .gyro_to_mouse_acceleration = 0.0,
+        .motion_prediction = false,
+        .motion_prediction_quadratic = false,
+        .motion_prediction_horizon_us = 4000,
+        .motion_prediction_max_delta = 2048,
     };
 
     load_out_config(&out_settings, configuration_file);
@@ -60,8 +134,8 @@ int main(int argc, char ** argv) {
             .type = ipc_server_sockets,
             .endpoint = {
                 .ssocket = {
-                    .mutex = PTHREAD_MUTEX_INITIALIZER,
                     .clients = { -1, -1, -1, -1, -1, -1, -1, -1 },
+                    .latest_clients = { -1, -1, -1, -1, -1, -1, -1, -1 },
                 }
             }
         },
@@ -117,44 +191,32 @@ int main(int argc, char ** argv) {
 
     const uint64_t timeout_ms = 1500;
 
-    struct pollfd poll_fds[2];
+    struct pollfd poll_fds[3];
     poll_fds[0].fd = sfd;
     poll_fds[0].events = POLL_IN;
 
-    int    sd=-1;
-    struct sockaddr_un serveraddr;
+    int sd = -1;
+    int latest_sd = -1;
     do {
-        sd = socket(AF_UNIX, SOCK_STREAM, 0);
-        if (sd < 0)
-        {
-            fprintf(stderr, "socket() failed");
+        sd = listen_socket(SERVER_PATH, SOCK_STREAM);
+        if (sd < 0) {
             break;
         }
 
-        memset(&serveraddr, 0, sizeof(serveraddr));
-        serveraddr.sun_family = AF_UNIX;
-        strncpy(serveraddr.sun_path, SERVER_PATH, sizeof(serveraddr.sun_path) - 1);
-
-        int rc = bind(sd, (struct sockaddr *)&serveraddr, SUN_LEN(&serveraddr));
-        if (rc < 0)
-        {
-            perror("bind() failed");
-            break;
-        }
-
-        rc = listen(sd, MAX_CONNECTED_CLIENTS - 1);
-        if (rc< 0)
-        {
-            perror("listen() failed");
+        latest_sd = listen_socket(SERVER_LATEST_PATH, SOCK_SEQPACKET);
+        if (latest_sd < 0) {
             break;
         }
 
         poll_fds[1].fd = sd;
         poll_fds[1].events = POLL_IN;
+        poll_fds[2].fd = latest_sd;
+        poll_fds[2].events = POLL_IN;
 
         while (true) {
             poll_fds[0].revents = 0;
             poll_fds[1].revents = 0;
+            poll_fds[2].revents = 0;
 
             const int poll_ret = poll(poll_fds, sizeof(poll_fds) / sizeof(poll_fds[0]), timeout_ms);
 
@@ -176,32 +238,22 @@ int main(int argc, char ** argv) {
                     printf("Received SIGINT -- propagating signal\n");
                     goto main_exit;
                 }
-            } else if (poll_fds[1].revents & POLLIN) {
-                const int client_fd = accept(sd, NULL, NULL);
-                if (client_fd < 0) {
-                    fprintf(stderr, "Error in getting a client connected: %d\n", client_fd);
-                    continue;
-                }
+            }
 
-                // here the client_fd is good
-                if (pthread_mutex_lock(&dev_out_thread_data.communication.endpoint.ssocket.mutex) == 0) {
-                    bool found = false;
-                    for (size_t i = 0; i < MAX_CONNECTED_CLIENTS; ++i) {
-                        if (dev_out_thread_data.communication.endpoint.ssocket.clients[i] < 0) {
-                            printf("Accepted new incoming connection on slot %zu: %d\n", i, client_fd);
-                            dev_out_thread_data.communication.endpoint.ssocket.clients[i] = client_fd;
-                            found = true;
-                            break;
-                        }
-                    }
-
-                    if (!found) {
-                        fprintf(stderr, "Could not find a free spot fot the incoming client -- client will be rejected\n");
-                        close(client_fd);
-                    }
-
-                    pthread_mutex_unlock(&dev_out_thread_data.communication.endpoint.ssocket.mutex);
-                }
+            if (poll_fds[1].revents & POLLIN) {
+                accept_client(
+                    sd,
+                    dev_out_thread_data.communication.endpoint.ssocket.clients,
+                    "reliable"
+                );
+            }
+
+            if (poll_fds[2].revents & POLLIN) {
+                accept_client(
+                    latest_sd,
+                    dev_out_thread_data.communication.endpoint.ssocket.latest_clients,
+                    "latest"
+                );
             }
         }
     } while (false);
@@ -209,11 +261,16 @@ int main(int argc, char ** argv) {
 main_exit:
     dev_out_thread_data.flags |= DEV_OUT_FLAG_EXIT;
 
-    if (sd != -1) {
+    if (sd >= 0) {
         close(sd);
     }
 
+    if (latest_sd >= 0) {
+        close(latest_sd);
+    }
+
     unlink(SERVER_PATH);
+    unlink(SERVER_LATEST_PATH);
 
 main_err:
     if (dev_out_thread_creation == 0) {
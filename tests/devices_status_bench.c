@@ -0,0 +1,529 @@
+#include "devices_status.h"
+#include "rogue_enemy.h"
+
+/*
+ * Two threads sharing a devices_status_shared_t as dev_in and dev_out do in allynone: the writer publishes
+ * IMU samples (and every few of them a stick move) while the reader syncs and reads what a report is
+ * composed from. Meant to be run under perf stat -e cache-misses to see what the compose path pays
+ * for the writer's updates.
+ *
+ * Every publish writes the same value to all the axes it touches: a reader ever seeing two different
+ * values has been handed a torn snapshot and the run fails.
+ *
+ * Before the run the source event time of mouse and keyboard is checked to be handed to the reader only once.
+ *
+ * The legacy layout runs the same loop over a copy of gamepad_status_t and devices_status_shared_t as they
+ * were before being laid out by cache line: comparing the cache misses of the two runs tells what the
+ * layout is worth on the machine at hand.
+ *
+ * Usage: devices-status-bench [seconds] [writer period in microseconds, 0 to publish as fast as possible] [current | legacy]
+ */
+
+#define BENCH_DEFAULT_SECONDS 5
+
+// one publish out of this many also moves the left stick
+#define BENCH_STICK_EVERY 8
+
+/**
+ * gamepad_status_t before it was laid out by cache line: the IMU samples share their lines with sticks,
+ * buttons and the properties dev_out writes.
+ */
+typedef struct legacy_gamepad_status {
+    bool connected;
+
+    int32_t joystick_positions[2][2]; // [0 left | 1 right][x axis | y axis]
+
+    uint8_t dpad; // 0x00 x - | 0x01 x -> | 0x02 x <- | 0x00 y - | 0x10 y ^ | 0x10 y . | 
+
+    uint8_t l2_trigger;
+    uint8_t r2_trigger;
+
+    uint8_t triangle;
+    uint8_t circle;
+    uint8_t cross;
+    uint8_t square;
+
+    uint8_t l1;
+    uint8_t r1;
+
+    uint8_t r3;
+    uint8_t l3;
+
+    uint8_t option;
+    uint8_t share;
+    uint8_t center;
+
+    uint8_t l4;
+    uint8_t r4;
+    
+    uint8_t l5;
+    uint8_t r5;
+
+    uint8_t touchpad_press;
+
+    int16_t touchpad_touch_num; // touchpad is inactive when this is -1
+    int16_t touchpad_x; // 0 to 1920
+    int16_t touchpad_y; // 0 to 1080
+
+    int64_t last_gyro_motion_timestamp_ns;
+    int64_t last_accel_motion_timestamp_ns;
+
+    double gyro[3]; // | x, y, z| right-hand-rules -- in rad/s
+    double accel[3]; // | x, y, z| positive: right, up, towards player -- in m/s^2
+
+    int16_t raw_gyro[3];
+    int16_t raw_accel[3];
+
+    uint64_t rumble_events_count;
+    uint8_t motors_intensity[2]; // 0 = left, 1 = right
+
+    uint64_t leds_events_count;
+    uint8_t leds_colors[3]; // r | g | b
+
+    uint8_t join_left_analog_and_gyroscope;
+    uint8_t join_right_analog_and_gyroscope;
+
+    volatile uint32_t flags;
+
+    uint32_t dirty; // GAMEPAD_STATUS_DIRTY_* mask
+
+} legacy_gamepad_status_t;
+
+typedef struct legacy_devices_status {
+    legacy_gamepad_status_t gamepad;
+
+    keyboard_status_t kbd;
+
+    mouse_status_t mouse;
+
+} legacy_devices_status_t;
+
+/**
+ * devices_status_shared_t before the atomics written by both threads were moved to their own line.
+ */
+typedef struct legacy_shared {
+    atomic_uint seq;
+
+    legacy_devices_status_t status;
+
+    atomic_uint dirty;
+
+    atomic_uint actions;
+} legacy_shared_t;
+
+typedef struct bench_data {
+    devices_status_shared_t shared;
+
+    // starts a line as the shared status of dev_out did, so that runs do not depend on where it lands
+    _Alignas(DEVICES_STATUS_CACHE_LINE_SIZE) legacy_shared_t legacy_shared;
+
+    bool legacy;
+
+    int64_t writer_period_us;
+
+    atomic_bool stop;
+
+    uint64_t publishes;
+
+    uint64_t syncs;
+    uint64_t torn;
+
+    // keeps the compose reads from being optimized away
+    int64_t checksum;
+} bench_data_t;
+
+/*
+ * devices_status_shared_publish over the legacy layout, applying the elements the writer sends as
+ * devices_status_apply_message does with default settings.
+ */
+static void legacy_shared_publish(legacy_shared_t *const shared, const in_message_t *const msgs, size_t msgs_count) {
+    const unsigned int seq = atomic_load_explicit(&shared->seq, memory_order_relaxed);
+    atomic_store_explicit(&shared->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    legacy_gamepad_status_t *const gamepad = &shared->status.gamepad;
+    for (size_t i = 0; i < msgs_count; ++i) {
+        const in_message_gamepad_set_element_t *const set = &msgs[i].data.gamepad_set;
+        switch (set->element) {
+            case GAMEPAD_GYROSCOPE: {
+                gamepad->last_gyro_motion_timestamp_ns = set->status.gyro.sample_timestamp_ns;
+                gamepad->raw_gyro[0] = set->status.gyro.x;
+                gamepad->raw_gyro[1] = set->status.gyro.y;
+                gamepad->raw_gyro[2] = set->status.gyro.z;
+                gamepad->dirty |= GAMEPAD_STATUS_DIRTY_GYRO;
+                break;
+            }
+            case GAMEPAD_ACCELEROMETER: {
+                gamepad->last_accel_motion_timestamp_ns = set->status.accel.sample_timestamp_ns;
+                gamepad->raw_accel[0] = set->status.accel.x;
+                gamepad->raw_accel[1] = set->status.accel.y;
+                gamepad->raw_accel[2] = set->status.accel.z;
+                gamepad->dirty |= GAMEPAD_STATUS_DIRTY_ACCEL;
+                break;
+            }
+            case GAMEPAD_LEFT_JOYSTICK_X: {
+                gamepad->joystick_positions[0][0] = set->status.joystick_pos;
+                gamepad->dirty |= GAMEPAD_STATUS_DIRTY_STICKS;
+                break;
+            }
+            case GAMEPAD_LEFT_JOYSTICK_Y: {
+                gamepad->joystick_positions[0][1] = set->status.joystick_pos;
+                gamepad->dirty |= GAMEPAD_STATUS_DIRTY_STICKS;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    const uint32_t dirty = gamepad->dirty;
+    const uint32_t actions = gamepad->flags;
+    gamepad->dirty = 0;
+    gamepad->flags = 0;
+
+    atomic_store_explicit(&shared->seq, seq + 2, memory_order_release);
+
+    if (dirty != 0) {
+        atomic_fetch_or_explicit(&shared->dirty, dirty, memory_order_release);
+    }
+
+    if (actions != 0) {
+        atomic_fetch_or_explicit(&shared->actions, actions, memory_order_release);
+    }
+}
+
+/*
+ * devices_status_shared_sync over the legacy layout.
+ */
+static void legacy_shared_sync(legacy_shared_t *const shared, devices_status_shared_reader_t *const reader, legacy_devices_status_t *const inout_stats) {
+    const uint32_t dirty = atomic_exchange_explicit(&shared->dirty, 0, memory_order_acquire);
+    const uint32_t actions = atomic_exchange_explicit(&shared->actions, 0, memory_order_acquire);
+
+    inout_stats->gamepad.flags |= actions;
+
+    if (atomic_load_explicit(&shared->seq, memory_order_acquire) == reader->seq) {
+        inout_stats->gamepad.dirty |= dirty;
+        return;
+    }
+
+    legacy_devices_status_t snapshot;
+    for (;;) {
+        const unsigned int begin = atomic_load_explicit(&shared->seq, memory_order_acquire);
+        if (begin & 1U) {
+            continue;
+        }
+
+        memcpy(&snapshot, &shared->status, sizeof(legacy_devices_status_t));
+        atomic_thread_fence(memory_order_acquire);
+
+        if (atomic_load_explicit(&shared->seq, memory_order_relaxed) == begin) {
+            reader->seq = begin;
+            break;
+        }
+    }
+
+    legacy_gamepad_status_t *const gamepad = &inout_stats->gamepad;
+    const uint32_t flags = gamepad->flags;
+    const uint32_t local_dirty = gamepad->dirty;
+    const uint64_t rumble_events_count = gamepad->rumble_events_count;
+    const uint64_t leds_events_count = gamepad->leds_events_count;
+    uint8_t motors_intensity[2];
+    uint8_t leds_colors[3];
+    memcpy(motors_intensity, gamepad->motors_intensity, sizeof(motors_intensity));
+    memcpy(leds_colors, gamepad->leds_colors, sizeof(leds_colors));
+
+    memcpy(gamepad, &snapshot.gamepad, sizeof(legacy_gamepad_status_t));
+
+    gamepad->flags = flags;
+    gamepad->dirty = local_dirty | dirty;
+    gamepad->rumble_events_count = rumble_events_count;
+    gamepad->leds_events_count = leds_events_count;
+    memcpy(gamepad->motors_intensity, motors_intensity, sizeof(motors_intensity));
+    memcpy(gamepad->leds_colors, leds_colors, sizeof(leds_colors));
+
+    inout_stats->kbd = snapshot.kbd;
+
+    inout_stats->mouse.btn_left = snapshot.mouse.btn_left;
+    inout_stats->mouse.btn_middle = snapshot.mouse.btn_middle;
+    inout_stats->mouse.btn_right = snapshot.mouse.btn_right;
+    inout_stats->mouse.x += (int32_t)((uint32_t)snapshot.mouse.x - (uint32_t)reader->mouse_x);
+    inout_stats->mouse.y += (int32_t)((uint32_t)snapshot.mouse.y - (uint32_t)reader->mouse_y);
+    reader->mouse_x = snapshot.mouse.x;
+    reader->mouse_y = snapshot.mouse.y;
+}
+
+static void *bench_writer(void *ptr) {
+    bench_data_t *const data = (bench_data_t*)ptr;
+
+    const struct timespec period = {
+        .tv_sec = (time_t)(data->writer_period_us / (int64_t)1000000),
+        .tv_nsec = (long)((data->writer_period_us % (int64_t)1000000) * (int64_t)1000),
+    };
+
+    in_message_t msgs[4];
+    memset(msgs, 0, sizeof(msgs));
+    msgs[0].type = GAMEPAD_SET_ELEMENT;
+    msgs[0].data.gamepad_set.element = GAMEPAD_GYROSCOPE;
+    msgs[1].type = GAMEPAD_SET_ELEMENT;
+    msgs[1].data.gamepad_set.element = GAMEPAD_ACCELEROMETER;
+    msgs[2].type = GAMEPAD_SET_ELEMENT;
+    msgs[2].data.gamepad_set.element = GAMEPAD_LEFT_JOYSTICK_X;
+    msgs[3].type = GAMEPAD_SET_ELEMENT;
+    msgs[3].data.gamepad_set.element = GAMEPAD_LEFT_JOYSTICK_Y;
+
+    uint64_t count = 0;
+    while (!atomic_load_explicit(&data->stop, memory_order_relaxed)) {
+        const uint16_t value = (uint16_t)(count & 0x3FFF);
+
+        msgs[0].data.gamepad_set.status.gyro.sample_timestamp_ns = (int64_t)count;
+        msgs[0].data.gamepad_set.status.gyro.x = value;
+        msgs[0].data.gamepad_set.status.gyro.y = value;
+        msgs[0].data.gamepad_set.status.gyro.z = value;
+
+        msgs[1].data.gamepad_set.status.accel.sample_timestamp_ns = (int64_t)count;
+        msgs[1].data.gamepad_set.status.accel.x = value;
+        msgs[1].data.gamepad_set.status.accel.y = value;
+        msgs[1].data.gamepad_set.status.accel.z = value;
+
+        msgs[2].data.gamepad_set.status.joystick_pos = (int32_t)value;
+        msgs[3].data.gamepad_set.status.joystick_pos = (int32_t)value;
+
+        const size_t msgs_count = ((count % BENCH_STICK_EVERY) == 0) ? 4 : 2;
+        if (data->legacy) {
+            legacy_shared_publish(&data->legacy_shared, msgs, msgs_count);
+        } else {
+            devices_status_shared_publish(&data->shared, msgs, msgs_count);
+        }
+        ++count;
+
+        if (data->writer_period_us > 0) {
+            nanosleep(&period, NULL);
+        }
+    }
+
+    data->publishes = count;
+    return NULL;
+}
+
+/*
+ * What every virtual gamepad reads to compose a report: true if the snapshot read is torn.
+ */
+static bool bench_compose(const gamepad_status_t *const gamepad, int64_t *const inout_checksum) {
+    *inout_checksum += gamepad->joystick_positions[0][0] + gamepad->joystick_positions[1][1] +
+        gamepad->l2_trigger + gamepad->r2_trigger + gamepad->dpad + gamepad->cross +
+        gamepad->raw_gyro[0] + gamepad->raw_accel[2] + gamepad->last_gyro_motion_timestamp_ns;
+
+    const bool imu_torn =
+        (gamepad->raw_gyro[0] != gamepad->raw_gyro[1]) ||
+        (gamepad->raw_gyro[0] != gamepad->raw_gyro[2]) ||
+        (gamepad->raw_gyro[0] != gamepad->raw_accel[0]) ||
+        (gamepad->raw_accel[0] != gamepad->raw_accel[1]) ||
+        (gamepad->raw_accel[0] != gamepad->raw_accel[2]) ||
+        (gamepad->last_gyro_motion_timestamp_ns != gamepad->last_accel_motion_timestamp_ns);
+    const bool stick_torn = gamepad->joystick_positions[0][0] != gamepad->joystick_positions[0][1];
+    return (imu_torn) || (stick_torn);
+}
+
+/*
+ * bench_compose reading the very same properties out of the legacy layout.
+ */
+static bool bench_compose_legacy(const legacy_gamepad_status_t *const gamepad, int64_t *const inout_checksum) {
+    *inout_checksum += gamepad->joystick_positions[0][0] + gamepad->joystick_positions[1][1] +
+        gamepad->l2_trigger + gamepad->r2_trigger + gamepad->dpad + gamepad->cross +
+        gamepad->raw_gyro[0] + gamepad->raw_accel[2] + gamepad->last_gyro_motion_timestamp_ns;
+
+    const bool imu_torn =
+        (gamepad->raw_gyro[0] != gamepad->raw_gyro[1]) ||
+        (gamepad->raw_gyro[0] != gamepad->raw_gyro[2]) ||
+        (gamepad->raw_gyro[0] != gamepad->raw_accel[0]) ||
+        (gamepad->raw_accel[0] != gamepad->raw_accel[1]) ||
+        (gamepad->raw_accel[0] != gamepad->raw_accel[2]) ||
+        (gamepad->last_gyro_motion_timestamp_ns != gamepad->last_accel_motion_timestamp_ns);
+    const bool stick_torn = gamepad->joystick_positions[0][0] != gamepad->joystick_positions[0][1];
+    return (imu_torn) || (stick_torn);
+}
+
+static void *bench_reader(void *ptr) {
+    bench_data_t *const data = (bench_data_t*)ptr;
+
+    devices_status_t stats;
+    devices_status_init(&stats);
+
+    legacy_devices_status_t legacy_stats;
+    memset(&legacy_stats, 0, sizeof(legacy_stats));
+
+    devices_status_shared_reader_t reader = {
+        .seq = 0,
+        .mouse_x = 0,
+        .mouse_y = 0,
+    };
+
+    uint64_t syncs = 0;
+    uint64_t torn = 0;
+    int64_t checksum = 0;
+    while (!atomic_load_explicit(&data->stop, memory_order_relaxed)) {
+        bool snapshot_torn;
+        if (data->legacy) {
+            legacy_shared_sync(&data->legacy_shared, &reader, &legacy_stats);
+            snapshot_torn = bench_compose_legacy(&legacy_stats.gamepad, &checksum);
+            legacy_stats.gamepad.dirty = 0;
+        } else {
+            devices_status_shared_sync(&data->shared, &reader, &stats);
+            snapshot_torn = bench_compose(&stats.gamepad, &checksum);
+            stats.gamepad.dirty = 0;
+        }
+
+        ++syncs;
+        if (snapshot_torn) {
+            ++torn;
+        }
+    }
+
+    data->syncs = syncs;
+    data->torn = torn;
+    data->checksum = checksum;
+    return NULL;
+}
+
+static void publish_timed(devices_status_shared_t *const shared, in_message_type_t type, time_t sec) {
+    in_message_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = type;
+
+    const struct timeval time = { .tv_sec = sec, .tv_usec = 0 };
+    if (type == MOUSE_EVENT) {
+        msg.data.mouse_event.type = MOUSE_ELEMENT_X;
+        msg.data.mouse_event.value = 1;
+        msg.data.mouse_event.flags = EV_MESSAGE_FLAGS_PRESERVE_TIME;
+        msg.data.mouse_event.time = time;
+    } else {
+        msg.data.kbd_set.code = KEY_A;
+        msg.data.kbd_set.value = (uint8_t)(sec & 1);
+        msg.data.kbd_set.flags = EV_MESSAGE_FLAGS_PRESERVE_TIME;
+        msg.data.kbd_set.time = time;
+    }
+
+    devices_status_shared_publish(shared, &msg, 1);
+}
+
+static void publish_imu(devices_status_shared_t *const shared) {
+    in_message_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = GAMEPAD_SET_ELEMENT;
+    msg.data.gamepad_set.element = GAMEPAD_GYROSCOPE;
+    devices_status_shared_publish(shared, &msg, 1);
+}
+
+/*
+ * The writer keeps the newest source time valid while the reader clears its copy after every frame:
+ * an unrelated publish (the IMU does it at the sampling frequency) must not hand the old time over again.
+ */
+static int check_event_time_handover(const dev_out_settings_t *const settings) {
+    static devices_status_shared_t shared;
+    if (devices_status_shared_init(&shared, settings) != 0) {
+        return -EINVAL;
+    }
+
+    devices_status_t stats;
+    devices_status_init(&stats);
+    devices_status_shared_reader_t reader = {
+        .seq = 0,
+        .mouse_x = 0,
+        .mouse_y = 0,
+    };
+
+    int res = 0;
+    for (time_t sec = 1; sec <= 2; ++sec) {
+        publish_timed(&shared, MOUSE_EVENT, sec);
+        publish_timed(&shared, KEYBOARD_SET_ELEMENT, sec);
+        devices_status_shared_sync(&shared, &reader, &stats);
+
+        if ((!stats.mouse.time_valid) || (stats.mouse.time.tv_sec != sec) || (!stats.kbd.time_valid) || (stats.kbd.time.tv_sec != sec)) {
+            fprintf(stderr, "event time: the time published (%ld) has not been handed over\n", (long)sec);
+            res = -EINVAL;
+            break;
+        }
+
+        // what the virtual mouse and keyboard do once their frame is sent
+        stats.mouse.time_valid = false;
+        stats.kbd.time_valid = false;
+
+        publish_imu(&shared);
+        devices_status_shared_sync(&shared, &reader, &stats);
+
+        if ((stats.mouse.time_valid) || (stats.kbd.time_valid)) {
+            fprintf(stderr, "event time: the time already consumed (%ld) has been handed over again\n", (long)sec);
+            res = -EINVAL;
+            break;
+        }
+    }
+
+    devices_status_shared_close(&shared);
+    return res;
+}
+
+int main(int argc, char **argv) {
+    const int64_t seconds = (argc > 1) ? strtoll(argv[1], NULL, 10) : BENCH_DEFAULT_SECONDS;
+    const int64_t writer_period_us = (argc > 2) ? strtoll(argv[2], NULL, 10) : 0;
+    const char *const layout = (argc > 3) ? argv[3] : "current";
+    if ((seconds <= 0) || (writer_period_us < 0) || ((strcmp(layout, "current") != 0) && (strcmp(layout, "legacy") != 0))) {
+        fprintf(stderr, "Usage: %s [seconds] [writer period in microseconds] [current | legacy]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    static dev_out_settings_t settings;
+    memset(&settings, 0, sizeof(settings));
+
+    if (check_event_time_handover(&settings) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    static bench_data_t data;
+    memset(&data, 0, sizeof(data));
+    data.writer_period_us = writer_period_us;
+    data.legacy = strcmp(layout, "legacy") == 0;
+    atomic_init(&data.stop, false);
+
+    const int init_res = devices_status_shared_init(&data.shared, &settings);
+    if (init_res != 0) {
+        fprintf(stderr, "Unable to initialize the shared status: %d\n", init_res);
+        return EXIT_FAILURE;
+    }
+
+    pthread_t writer_thread, reader_thread;
+    if (pthread_create(&reader_thread, NULL, bench_reader, (void*)&data) != 0) {
+        fprintf(stderr, "Unable to start the reader thread\n");
+        devices_status_shared_close(&data.shared);
+        return EXIT_FAILURE;
+    }
+
+    if (pthread_create(&writer_thread, NULL, bench_writer, (void*)&data) != 0) {
+        fprintf(stderr, "Unable to start the writer thread\n");
+        atomic_store(&data.stop, true);
+        pthread_join(reader_thread, NULL);
+        devices_status_shared_close(&data.shared);
+        return EXIT_FAILURE;
+    }
+
+    const struct timespec duration = { .tv_sec = (time_t)seconds, .tv_nsec = 0 };
+    nanosleep(&duration, NULL);
+    atomic_store(&data.stop, true);
+
+    pthread_join(writer_thread, NULL);
+    pthread_join(reader_thread, NULL);
+
+    devices_status_shared_close(&data.shared);
+
+    printf("%s layout, %" PRId64 "s: %" PRIu64 " publishes (%.1f ns each), %" PRIu64 " syncs (%.1f ns each), %" PRIu64 " torn (checksum %" PRId64 ")\n",
+        layout,
+        seconds,
+        data.publishes,
+        data.publishes > 0 ? ((double)seconds * 1e9) / (double)data.publishes : 0.0,
+        data.syncs,
+        data.syncs > 0 ? ((double)seconds * 1e9) / (double)data.syncs : 0.0,
+        data.torn,
+        data.checksum
+    );
+
+    return data.torn == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
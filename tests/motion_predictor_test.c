@@ -0,0 +1,257 @@
+#include "motion_predictor.h"
+#include "rogue_enemy.h"
+
+/*
+ * Replay of a synthetic IMU trace through motion_predictor_run: samples are taken every
+ * TRACE_IMU_PERIOD_US (with jitter) and reach dev_out TRACE_IPC_DELAY_US later, reports are composed
+ * every TRACE_REPORT_PERIOD_US. The reading sent with each report is compared to the value the sensor
+ * had at that moment, both with and without the prediction.
+ *
+ * The trace is a sum of two sinusoids per axis: a fast flick and a slow sweep, noise-free so that
+ * the error measured is only the one of the model.
+ */
+
+#define TRACE_DURATION_US       ((int64_t)10000000)
+#define TRACE_IMU_PERIOD_US     ((int64_t)625)
+#define TRACE_IMU_JITTER_US     ((int64_t)20)
+#define TRACE_IPC_DELAY_US      ((int64_t)300)
+#define TRACE_REPORT_PERIOD_US  ((int64_t)1250)
+
+// the clock starts far from zero as CLOCK_MONOTONIC does
+#define TRACE_START_US          ((int64_t)1000000000)
+
+// largest error (in LSB) tolerated between a predicted reading and the true one
+#define TRACE_MAX_ERROR_LINEAR_LSB      12
+#define TRACE_MAX_ERROR_QUADRATIC_LSB   6
+
+// the prediction must at least halve the RMS error of reporting the last sample
+#define TRACE_MIN_RMS_GAIN      2.0
+
+#define BENCH_ITERATIONS        1000000
+
+typedef struct trace_error {
+    double sum_sq;
+    int64_t max_abs;
+    int64_t count;
+} trace_error_t;
+
+static uint32_t lcg_state = 0x2545F491;
+
+static int64_t lcg_jitter(int64_t amplitude) {
+    lcg_state = (lcg_state * 1664525u) + 1013904223u;
+    return (int64_t)(lcg_state >> 8) % ((2 * amplitude) + 1) - amplitude;
+}
+
+static int16_t trace_value(int axis, int64_t t_us) {
+    const double t = (double)t_us / 1000000.0;
+    const double fast = 8000.0 * sin((2.0 * M_PI * (3.0 + axis)) * t);
+    const double slow = 4000.0 * sin((2.0 * M_PI * 0.5) * t + axis);
+    return (int16_t)lround(fast + slow);
+}
+
+static void trace_error_add(trace_error_t *const err, int64_t value, int64_t truth) {
+    const int64_t diff = absolute_value(value - truth);
+    err->sum_sq += (double)diff * (double)diff;
+    err->max_abs = diff > err->max_abs ? diff : err->max_abs;
+    ++err->count;
+}
+
+static double trace_error_rms(const trace_error_t *const err) {
+    return err->count > 0 ? sqrt(err->sum_sq / (double)err->count) : 0.0;
+}
+
+static void timespec_from_us(struct timespec *const out, int64_t us) {
+    out->tv_sec = (time_t)(us / (int64_t)1000000);
+    out->tv_nsec = (long)((us % (int64_t)1000000) * (int64_t)1000);
+}
+
+static int replay(bool quadratic) {
+    dev_out_settings_t settings;
+    memset(&settings, 0, sizeof(settings));
+    settings.motion_prediction = true;
+    settings.motion_prediction_quadratic = quadratic;
+    settings.motion_prediction_horizon_us = 4000;
+    settings.motion_prediction_max_delta = 2048;
+
+    motion_predictor_t predictor;
+    if (motion_predictor_init(&predictor, &settings) != 0) {
+        fprintf(stderr, "motion_predictor_init failed\n");
+        return -EINVAL;
+    }
+
+    gamepad_status_t gamepad;
+    memset(&gamepad, 0, sizeof(gamepad));
+
+    trace_error_t held = { 0 };
+    trace_error_t predicted = { 0 };
+
+    lcg_state = 0x2545F491;
+
+    int64_t next_sample_us = TRACE_START_US;
+    int64_t pending_sample_us = -1;
+    int64_t delivered = 0;
+    int16_t last_sample[3] = { 0, 0, 0 };
+
+    for (int64_t now_us = TRACE_START_US + TRACE_REPORT_PERIOD_US; now_us < TRACE_START_US + TRACE_DURATION_US; now_us += TRACE_REPORT_PERIOD_US) {
+        // deliver every sample that has reached dev_out by now
+        while (next_sample_us + TRACE_IPC_DELAY_US <= now_us) {
+            pending_sample_us = next_sample_us;
+            next_sample_us += TRACE_IMU_PERIOD_US + lcg_jitter(TRACE_IMU_JITTER_US);
+        }
+
+        if (pending_sample_us < 0) {
+            continue;
+        }
+
+        if (pending_sample_us * (int64_t)1000 != gamepad.last_gyro_motion_timestamp_ns) {
+            for (int axis = 0; axis < 3; ++axis) {
+                last_sample[axis] = trace_value(axis, pending_sample_us);
+                gamepad.raw_gyro[axis] = last_sample[axis];
+                gamepad.raw_accel[axis] = last_sample[axis];
+            }
+
+            gamepad.last_gyro_motion_timestamp_ns = pending_sample_us * (int64_t)1000;
+            gamepad.last_accel_motion_timestamp_ns = pending_sample_us * (int64_t)1000;
+            ++delivered;
+        }
+
+        struct timespec now;
+        timespec_from_us(&now, now_us);
+        motion_predictor_run(&predictor, &gamepad, &now);
+
+        // until the model has all of its samples the last one is reported as it is
+        if (delivered < MOTION_PREDICTOR_SAMPLES) {
+            continue;
+        }
+
+        for (int axis = 0; axis < 3; ++axis) {
+            const int64_t truth = trace_value(axis, now_us);
+            trace_error_add(&held, last_sample[axis], truth);
+            trace_error_add(&predicted, gamepad.raw_gyro[axis], truth);
+
+            if (gamepad.raw_gyro[axis] != gamepad.raw_accel[axis]) {
+                fprintf(stderr, "%s: gyroscope and accelerometer predicted differently from the same samples\n", quadratic ? "quadratic" : "linear");
+                return -EINVAL;
+            }
+        }
+    }
+
+    const double held_rms = trace_error_rms(&held);
+    const double predicted_rms = trace_error_rms(&predicted);
+
+    printf("%s: last sample rms %.2f max %" PRId64 " -- predicted rms %.2f max %" PRId64 " (LSB, %" PRId64 " readings)\n",
+        quadratic ? "quadratic" : "linear",
+        held_rms,
+        held.max_abs,
+        predicted_rms,
+        predicted.max_abs,
+        predicted.count
+    );
+
+    const int64_t max_error = quadratic ? TRACE_MAX_ERROR_QUADRATIC_LSB : TRACE_MAX_ERROR_LINEAR_LSB;
+    if (predicted.max_abs > max_error) {
+        fprintf(stderr, "%s: prediction error %" PRId64 " above the bound of %" PRId64 " LSB\n", quadratic ? "quadratic" : "linear", predicted.max_abs, max_error);
+        return -EINVAL;
+    }
+
+    if (predicted_rms * TRACE_MIN_RMS_GAIN > held_rms) {
+        fprintf(stderr, "%s: prediction does not reduce the error enough\n", quadratic ? "quadratic" : "linear");
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+/*
+ * Samples without a CLOCK_MONOTONIC timestamp must be reported untouched.
+ */
+static int unstamped(void) {
+    dev_out_settings_t settings;
+    memset(&settings, 0, sizeof(settings));
+    settings.motion_prediction = true;
+    settings.motion_prediction_horizon_us = 4000;
+    settings.motion_prediction_max_delta = 2048;
+
+    motion_predictor_t predictor;
+    motion_predictor_init(&predictor, &settings);
+
+    gamepad_status_t gamepad;
+    memset(&gamepad, 0, sizeof(gamepad));
+
+    struct timespec now;
+    for (int64_t i = 0; i < 16; ++i) {
+        gamepad.raw_gyro[0] = (int16_t)(i * 100);
+        gamepad.dirty = 0;
+
+        timespec_from_us(&now, TRACE_START_US + (i * TRACE_REPORT_PERIOD_US));
+        motion_predictor_run(&predictor, &gamepad, &now);
+
+        if ((gamepad.raw_gyro[0] != (int16_t)(i * 100)) || (gamepad.dirty != 0)) {
+            fprintf(stderr, "unstamped: reading changed without a timestamp\n");
+            return -EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Cost of a prediction for both sensors, with a new sample every other call.
+ */
+static void bench(bool quadratic) {
+    dev_out_settings_t settings;
+    memset(&settings, 0, sizeof(settings));
+    settings.motion_prediction = true;
+    settings.motion_prediction_quadratic = quadratic;
+    settings.motion_prediction_horizon_us = 4000;
+    settings.motion_prediction_max_delta = 2048;
+
+    motion_predictor_t predictor;
+    motion_predictor_init(&predictor, &settings);
+
+    gamepad_status_t gamepad;
+    memset(&gamepad, 0, sizeof(gamepad));
+
+    struct timespec start, end, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int64_t checksum = 0;
+    for (int64_t i = 0; i < BENCH_ITERATIONS; ++i) {
+        const int64_t now_us = TRACE_START_US + (i * TRACE_REPORT_PERIOD_US);
+        if ((i & 1) == 0) {
+            const int64_t sample_us = now_us - TRACE_IPC_DELAY_US;
+            for (int axis = 0; axis < 3; ++axis) {
+                gamepad.raw_gyro[axis] = (int16_t)((i * (axis + 1)) & 0x3FFF);
+                gamepad.raw_accel[axis] = (int16_t)((i * (axis + 3)) & 0x3FFF);
+            }
+            gamepad.last_gyro_motion_timestamp_ns = sample_us * (int64_t)1000;
+            gamepad.last_accel_motion_timestamp_ns = sample_us * (int64_t)1000;
+        }
+
+        timespec_from_us(&now, now_us);
+        motion_predictor_run(&predictor, &gamepad, &now);
+        checksum += gamepad.raw_gyro[0] + gamepad.raw_accel[2];
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    const int64_t elapsed_ns = ((int64_t)(end.tv_sec - start.tv_sec) * (int64_t)1000000000) + (int64_t)(end.tv_nsec - start.tv_nsec);
+    printf("%s: %.1f ns per motion_predictor_run (checksum %" PRId64 ")\n",
+        quadratic ? "quadratic" : "linear",
+        (double)elapsed_ns / (double)BENCH_ITERATIONS,
+        checksum
+    );
+}
+
+int main(int argc, char **argv) {
+    int failed = 0;
+
+    failed += replay(false) != 0;
+    failed += replay(true) != 0;
+    failed += unstamped() != 0;
+
+    bench(false);
+    bench(true);
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,303 @@
+#include "virt_deck.h"
+#include "rogue_enemy.h"
+
+#include <linux/uhid.h>
+
+/*
+ * Loopback of the Steam Deck backend through the kernel: the virtual controller is created on /dev/uhid
+ * and driven from the hidraw node the kernel gives it, as steam would do.
+ *
+ *   - a GET_ATTRIBUTES_VALUES command (feature report) must be answered with the attributes
+ *   - a composed input report must come out of hidraw unchanged, with the IMU readings in hid-steam units
+ *
+ * Needs /dev/uhid and hidraw (root): the test is skipped otherwise.
+ */
+
+// ctest: the test has been skipped
+#define LOOPBACK_SKIP 77
+
+#define LOOPBACK_HIDRAW_MAX 256
+
+#define LOOPBACK_TIMEOUT_MS 3000
+
+#define DECK_ID_GET_ATTRIBUTES_VALUES 0x83
+
+typedef struct loopback_service {
+    virt_deck_t *deck;
+
+    // rumble requests end up here: never the status reports are composed from
+    gamepad_status_t status;
+
+    atomic_bool stop;
+
+    int res;
+} loopback_service_t;
+
+/*
+ * Answer the requests of the kernel (and of hid-steam) until told to stop: the hidraw ioctls below block
+ * until the uhid side replies.
+ */
+static void *loopback_service_thread(void *ptr) {
+    loopback_service_t *const service = (loopback_service_t*)ptr;
+
+    struct pollfd pfd = {
+        .fd = virt_deck_get_fd(service->deck),
+        .events = POLLIN,
+    };
+
+    while (!atomic_load(&service->stop)) {
+        const int poll_res = poll(&pfd, 1, 50);
+        if (poll_res < 0) {
+            service->res = -errno;
+            break;
+        } else if ((poll_res > 0) && (pfd.revents & POLLIN)) {
+            const int event_res = virt_deck_event(service->deck, &service->status);
+            if (event_res != 0) {
+                service->res = event_res;
+                break;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * true if hidrawN belongs to a uhid device with the name and serial of the emulated controller.
+ */
+static bool hidraw_is_virtual_deck(int n) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/sys/class/hidraw/hidraw%d/device", n);
+
+    char real_path[PATH_MAX];
+    if ((realpath(path, real_path) == NULL) || (strstr(real_path, "/uhid/") == NULL)) {
+        return false;
+    }
+
+    snprintf(path, sizeof(path), "/sys/class/hidraw/hidraw%d/device/uevent", n);
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    char uevent[4096];
+    const ssize_t len = read(fd, uevent, sizeof(uevent) - 1);
+    close(fd);
+    if (len <= 0) {
+        return false;
+    }
+    uevent[len] = '\0';
+
+    return (strstr(uevent, "HID_NAME=" VIRT_DECK_DEV_NAME "\n") != NULL) && (strstr(uevent, "HID_UNIQ=ROGUEENEMY01\n") != NULL);
+}
+
+static void hidraw_list_virtual_decks(bool out_present[LOOPBACK_HIDRAW_MAX]) {
+    for (int n = 0; n < LOOPBACK_HIDRAW_MAX; ++n) {
+        out_present[n] = hidraw_is_virtual_deck(n);
+    }
+}
+
+/*
+ * Open the hidraw node of the virtual controller just created: an emulator already running has its own.
+ */
+static int hidraw_open_new_deck(const bool in_present_before[LOOPBACK_HIDRAW_MAX]) {
+    for (int waited_ms = 0; waited_ms < LOOPBACK_TIMEOUT_MS; waited_ms += 10) {
+        for (int n = 0; n < LOOPBACK_HIDRAW_MAX; ++n) {
+            if ((!in_present_before[n]) && (hidraw_is_virtual_deck(n))) {
+                char path[64];
+                snprintf(path, sizeof(path), "/dev/hidraw%d", n);
+
+                // udev might still be setting the node up
+                const int fd = open(path, O_RDWR | O_CLOEXEC | O_NONBLOCK);
+                if (fd >= 0) {
+                    printf("virtual Steam Deck controller is %s\n", path);
+                    return fd;
+                }
+            }
+        }
+
+        const struct timespec pause = { .tv_sec = 0, .tv_nsec = 10000000 };
+        nanosleep(&pause, NULL);
+    }
+
+    return -ENODEV;
+}
+
+static int check_feature_round_trip(int hidraw_fd) {
+    // [0] is the report id: the descriptor declares none
+    uint8_t cmd[1 + VIRT_DECK_REPORT_SIZE];
+    memset(cmd, 0, sizeof(cmd));
+    cmd[1] = DECK_ID_GET_ATTRIBUTES_VALUES;
+    cmd[2] = 0;
+
+    const int set_res = ioctl(hidraw_fd, HIDIOCSFEATURE(sizeof(cmd)), cmd);
+    if (set_res < 0) {
+        fprintf(stderr, "HIDIOCSFEATURE failed: %d\n", -errno);
+        return -errno;
+    }
+
+    uint8_t reply[1 + VIRT_DECK_REPORT_SIZE];
+    memset(reply, 0, sizeof(reply));
+    const int get_res = ioctl(hidraw_fd, HIDIOCGFEATURE(sizeof(reply)), reply);
+    if (get_res < 0) {
+        fprintf(stderr, "HIDIOCGFEATURE failed: %d\n", -errno);
+        return -errno;
+    }
+
+    // five attributes of one byte of id and four of value follow the command and its length
+    if ((reply[1] != DECK_ID_GET_ATTRIBUTES_VALUES) || (reply[2] != 5 * 5)) {
+        fprintf(stderr, "unexpected GET_ATTRIBUTES_VALUES reply: %02x %02x\n", reply[1], reply[2]);
+        return -EINVAL;
+    }
+
+    const uint32_t product_id = (uint32_t)reply[4] | ((uint32_t)reply[5] << 8) | ((uint32_t)reply[6] << 16) | ((uint32_t)reply[7] << 24);
+    if ((reply[3] != 0x01) || (product_id != VIRT_DECK_DEV_PRODUCT_ID)) {
+        fprintf(stderr, "unexpected product id attribute: %02x %08" PRIx32 "\n", reply[3], product_id);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int16_t get_le16(const uint8_t *const buf) {
+    return (int16_t)((uint16_t)buf[0] | ((uint16_t)buf[1] << 8));
+}
+
+static int check_input_report(virt_deck_t *const deck, int hidraw_fd) {
+    gamepad_status_t status;
+    gamepad_status_init(&status);
+
+    status.cross = 1;
+    status.l1 = 1;
+    status.joystick_positions[0][0] = 16384;
+    status.joystick_positions[0][1] = -16384;
+
+    // 1g along X and 100 deg/s around Z, in the units input clients send
+    status.raw_accel[0] = (int16_t)lround(9.80665 / LSB_PER_16G);
+    status.raw_gyro[2] = (int16_t)lround((100.0 * M_PI / 180.0) / LSB_PER_RAD_S_2000_DEG_S);
+
+    uint8_t composed[VIRT_DECK_REPORT_SIZE];
+    virt_deck_compose(deck, &status, composed);
+
+    const int send_res = virt_deck_send(deck, composed);
+    if (send_res != 0) {
+        fprintf(stderr, "virt_deck_send failed: %d\n", send_res);
+        return send_res;
+    }
+
+    struct pollfd pfd = {
+        .fd = hidraw_fd,
+        .events = POLLIN,
+    };
+
+    const int poll_res = poll(&pfd, 1, LOOPBACK_TIMEOUT_MS);
+    if (poll_res <= 0) {
+        fprintf(stderr, "no input report from hidraw: %d\n", poll_res < 0 ? -errno : -ETIMEDOUT);
+        return poll_res < 0 ? -errno : -ETIMEDOUT;
+    }
+
+    uint8_t received[VIRT_DECK_REPORT_SIZE + 1];
+    const ssize_t len = read(hidraw_fd, received, sizeof(received));
+    if (len != VIRT_DECK_REPORT_SIZE) {
+        fprintf(stderr, "input report of %zd bytes instead of %d\n", len, VIRT_DECK_REPORT_SIZE);
+        return -EINVAL;
+    }
+
+    if (memcmp(received, composed, VIRT_DECK_REPORT_SIZE) != 0) {
+        fprintf(stderr, "input report changed on its way through the kernel\n");
+        return -EINVAL;
+    }
+
+    // hid-steam: 16384 LSB/g, 16 LSB/deg/s, the Z axis of the gyroscope is reported negated in [32]
+    const int16_t accel_x = get_le16(&received[24]);
+    const int16_t gyro_z = get_le16(&received[32]);
+    if ((absolute_value((int64_t)accel_x - 16384) > 16) || (absolute_value((int64_t)gyro_z + 1600) > 2)) {
+        fprintf(stderr, "IMU readings not in hid-steam units: accel X %" PRId16 " (16384 expected), gyro [32] %" PRId16 " (-1600 expected)\n", accel_x, gyro_z);
+        return -EINVAL;
+    }
+
+    if ((received[8] & 0x88) != 0x88) {
+        fprintf(stderr, "cross and L1 not reported as pressed: %02x\n", received[8]);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (access("/dev/uhid", R_OK | W_OK) != 0) {
+        printf("/dev/uhid is not available: skipped\n");
+        return LOOPBACK_SKIP;
+    }
+
+    dev_out_settings_t settings;
+    memset(&settings, 0, sizeof(settings));
+    settings.gyro_to_analog_activation_treshold = 16;
+    settings.gyro_to_analog_mapping = 4;
+    settings.gyro_to_analog_exponent = 1.0;
+    settings.sticks_curve.exponent = 1.0;
+    settings.triggers_curve.exponent = 1.0;
+
+    gamepad_response_t response;
+    const int response_res = gamepad_response_compile(&response, &settings);
+    if (response_res != 0) {
+        fprintf(stderr, "gamepad_response_compile failed: %d\n", response_res);
+        return EXIT_FAILURE;
+    }
+
+    static bool present_before[LOOPBACK_HIDRAW_MAX];
+    hidraw_list_virtual_decks(present_before);
+
+    static virt_deck_t deck;
+    const int init_res = virt_deck_init(&deck, &response);
+    if (init_res != 0) {
+        fprintf(stderr, "virt_deck_init failed: %d\n", init_res);
+        return EXIT_FAILURE;
+    }
+
+    static loopback_service_t service;
+    memset(&service, 0, sizeof(service));
+    service.deck = &deck;
+    gamepad_status_init(&service.status);
+    atomic_init(&service.stop, false);
+
+    pthread_t service_thread;
+    if (pthread_create(&service_thread, NULL, loopback_service_thread, (void*)&service) != 0) {
+        fprintf(stderr, "Unable to start the uhid service thread\n");
+        virt_deck_close(&deck);
+        return EXIT_FAILURE;
+    }
+
+    int res = 0;
+
+    const int hidraw_fd = hidraw_open_new_deck(present_before);
+    if (hidraw_fd < 0) {
+        fprintf(stderr, "no hidraw node for the virtual controller: %d\n", hidraw_fd);
+        res = hidraw_fd;
+        goto loopback_err;
+    }
+
+    res = check_feature_round_trip(hidraw_fd);
+    if (res == 0) {
+        res = check_input_report(&deck, hidraw_fd);
+    }
+
+    close(hidraw_fd);
+
+loopback_err:
+    atomic_store(&service.stop, true);
+    pthread_join(service_thread, NULL);
+
+    if ((res == 0) && (service.res != 0)) {
+        fprintf(stderr, "uhid service failed: %d\n", service.res);
+        res = service.res;
+    }
+
+    virt_deck_close(&deck);
+
+    if (res == 0) {
+        printf("Steam Deck uhid loopback: ok\n");
+    }
+
+    return res == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,397 @@
+#include "virt_deck.h"
+
+#include <linux/uhid.h>
+
+// commands sent by steam and hid-steam as feature reports: the first byte of the payload
+#define DECK_ID_CLEAR_DIGITAL_MAPPINGS  0x81
+#define DECK_ID_GET_ATTRIBUTES_VALUES   0x83
+#define DECK_ID_SET_SETTINGS_VALUES     0x87
+#define DECK_ID_LOAD_DEFAULT_SETTINGS   0x8E
+#define DECK_ID_TRIGGER_HAPTIC_PULSE    0x8F
+#define DECK_ID_GET_STRING_ATTRIBUTE    0xAE
+#define DECK_ID_TRIGGER_RUMBLE_CMD      0xEB
+
+// type of the input report carrying the controller state
+#define DECK_ID_CONTROLLER_DECK_STATE   0x09
+
+#define DECK_ATTRIB_PRODUCT_ID              0x01
+#define DECK_ATTRIB_CAPABILITIES            0x02
+#define DECK_ATTRIB_FIRMWARE_BUILD_TIME     0x04
+#define DECK_ATTRIB_BOARD_REVISION          0x09
+#define DECK_ATTRIB_CONNECTION_INTERVAL_US  0x0B
+
+#define DECK_ATTRIB_STR_UNIT_SERIAL         0x01
+
+#define DECK_SERIAL "ROGUEENEMY01"
+
+// as in the linux kernel hid-steam driver
+#define DECK_ACCEL_RES_PER_G    16384
+#define DECK_GYRO_RES_PER_DPS   16
+
+#define DECK_STANDARD_GRAVITY   ((double)9.80665)
+
+// hid-steam reports [24] as X, -[26] as Z and [28] as Y (the same goes for the gyroscope)
+static const int8_t deck_mount_matrix[3][3] = {
+    { 1, 0,  0 },
+    { 0, 0, -1 },
+    { 0, 1,  0 },
+};
+
+static const char* path = "/dev/uhid";
+
+/*
+ * HID report descriptor of the gamepad interface (interface 2) of the Steam Deck controller:
+ * a single vendor-defined 64 bytes input report and a 64 bytes feature report used for commands.
+ *
+ * The presence of the feature report is what hid-steam uses to tell the gamepad apart from
+ * the lizard-mode keyboard and mouse interfaces.
+ */
+static unsigned char rdesc[] = {
+    0x06, 0xFF, 0xFF,   // Usage Page (Vendor Defined 0xFFFF)
+    0x09, 0x01,         // Usage (0x01)
+    0xA1, 0x01,         // Collection (Application)
+    0x09, 0x02,         //   Usage (0x02)
+    0x09, 0x03,         //   Usage (0x03)
+    0x15, 0x00,         //   Logical Minimum (0)
+    0x26, 0xFF, 0x00,   //   Logical Maximum (255)
+    0x75, 0x08,         //   Report Size (8)
+    0x95, 0x40,         //   Report Count (64)
+    0x81, 0x02,         //   Input (Data,Var,Abs,No Wrap,Linear,Preferred State,No Null Position)
+    0x09, 0x06,         //   Usage (0x06)
+    0x09, 0x07,         //   Usage (0x07)
+    0x15, 0x00,         //   Logical Minimum (0)
+    0x26, 0xFF, 0x00,   //   Logical Maximum (255)
+    0x75, 0x08,         //   Report Size (8)
+    0x95, 0x40,         //   Report Count (64)
+    0xB1, 0x02,         //   Feature (Data,Var,Abs,No Wrap,Linear,Preferred State,No Null Position,Non-volatile)
+    0xC0,               // End Collection
+};
+
+static int uhid_write(int fd, const struct uhid_event *ev)
+{
+	ssize_t ret;
+
+	ret = write(fd, ev, sizeof(*ev));
+	if (ret < 0) {
+		fprintf(stderr, "Cannot write to uhid: %d\n", (int)ret);
+		return -errno;
+	} else if (ret != sizeof(*ev)) {
+		fprintf(stderr, "Wrong size written to uhid: %zd != %zu\n",
+			ret, sizeof(*ev));
+		return -EFAULT;
+	} else {
+		return 0;
+	}
+}
+
+static int create(int fd)
+{
+	struct uhid_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.type = UHID_CREATE;
+	strcpy((char*)ev.u.create.name, VIRT_DECK_DEV_NAME);
+	strcpy((char*)ev.u.create.uniq, DECK_SERIAL);
+	ev.u.create.rd_data = rdesc;
+	ev.u.create.rd_size = sizeof(rdesc);
+	ev.u.create.bus = BUS_USB;
+	ev.u.create.vendor = VIRT_DECK_DEV_VENDOR_ID;
+	ev.u.create.product = VIRT_DECK_DEV_PRODUCT_ID;
+	ev.u.create.version = VIRT_DECK_DEV_VERSION;
+	ev.u.create.country = 0;
+
+	return uhid_write(fd, &ev);
+}
+
+static void destroy(int fd)
+{
+	struct uhid_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.type = UHID_DESTROY;
+
+	uhid_write(fd, &ev);
+}
+
+static void put_le16(uint8_t *const buf, int16_t value) {
+    buf[0] = (uint8_t)((uint16_t)value);
+    buf[1] = (uint8_t)((uint16_t)value >> 8);
+}
+
+static void put_le32(uint8_t *const buf, uint32_t value) {
+    buf[0] = (uint8_t)(value);
+    buf[1] = (uint8_t)(value >> 8);
+    buf[2] = (uint8_t)(value >> 16);
+    buf[3] = (uint8_t)(value >> 24);
+}
+
+static size_t put_attribute(uint8_t *const buf, uint8_t attrib, uint32_t value) {
+    buf[0] = attrib;
+    put_le32(&buf[1], value);
+    return 5;
+}
+
+/**
+ * Prepare the answer to a command: hid-steam and steam read it back with a GET_REPORT right after the SET_REPORT.
+ */
+static void handle_command(virt_deck_t *const gamepad, gamepad_status_t *const out_device_status, const uint8_t *const cmd, size_t cmd_len) {
+    memset(gamepad->feature_reply, 0, sizeof(gamepad->feature_reply));
+
+    if (cmd_len < 2) {
+        return;
+    }
+
+    gamepad->feature_reply[0] = cmd[0];
+
+    switch (cmd[0]) {
+        case DECK_ID_GET_ATTRIBUTES_VALUES: {
+            size_t len = 0;
+            len += put_attribute(&gamepad->feature_reply[2 + len], DECK_ATTRIB_PRODUCT_ID, VIRT_DECK_DEV_PRODUCT_ID);
+            len += put_attribute(&gamepad->feature_reply[2 + len], DECK_ATTRIB_CAPABILITIES, 0x00000000);
+            len += put_attribute(&gamepad->feature_reply[2 + len], DECK_ATTRIB_FIRMWARE_BUILD_TIME, 0x6245B8D2);
+            len += put_attribute(&gamepad->feature_reply[2 + len], DECK_ATTRIB_BOARD_REVISION, 0x00000000);
+            len += put_attribute(&gamepad->feature_reply[2 + len], DECK_ATTRIB_CONNECTION_INTERVAL_US, 1000);
+            gamepad->feature_reply[1] = (uint8_t)len;
+            break;
+        }
+        case DECK_ID_GET_STRING_ATTRIBUTE: {
+            const size_t serial_len = strlen(DECK_SERIAL);
+            gamepad->feature_reply[1] = (uint8_t)serial_len;
+            gamepad->feature_reply[2] = DECK_ATTRIB_STR_UNIT_SERIAL;
+            memcpy(&gamepad->feature_reply[3], DECK_SERIAL, serial_len);
+            break;
+        }
+        case DECK_ID_CLEAR_DIGITAL_MAPPINGS:
+            if ((gamepad->debug) && (gamepad->lizard_mode)) {
+                printf("Steam Deck lizard mode disabled\n");
+            }
+            gamepad->lizard_mode = false;
+            break;
+        case DECK_ID_LOAD_DEFAULT_SETTINGS:
+            // a real controller would start emulating keyboard and mouse again: that is never done here
+            gamepad->lizard_mode = true;
+            break;
+        case DECK_ID_TRIGGER_RUMBLE_CMD:
+            // [2] unused, [3-4] intensity, [5-6] left speed, [7-8] right speed, [9] left gain, [10] right gain
+            if (cmd_len >= 9) {
+                out_device_status->motors_intensity[0] = cmd[6];
+                out_device_status->motors_intensity[1] = cmd[8];
+                ++out_device_status->rumble_events_count;
+            }
+            break;
+        case DECK_ID_SET_SETTINGS_VALUES:
+        case DECK_ID_TRIGGER_HAPTIC_PULSE:
+        default:
+            break;
+    }
+}
+
+int virt_deck_init(
+    virt_deck_t *const gamepad,
+    const gamepad_response_t *const response
+) {
+    int ret = 0;
+
+    memset(gamepad, 0, sizeof(virt_deck_t));
+    gamepad->response = response;
+    gamepad->debug = false;
+    gamepad->seq_num = 0;
+    gamepad->lizard_mode = true;
+
+    // raw_accel is in m/s^2 * LSB_PER_16G (~2049 LSB/g) and raw_gyro in rad/s * LSB_PER_RAD_S_2000_DEG_S (~16.38 LSB/deg/s)
+    imu_matrix_compose(&gamepad->accel_matrix, deck_mount_matrix, LSB_PER_16G, DECK_STANDARD_GRAVITY / (double)DECK_ACCEL_RES_PER_G);
+    imu_matrix_compose(&gamepad->gyro_matrix, deck_mount_matrix, LSB_PER_RAD_S_2000_DEG_S, (M_PI / 180.0) / (double)DECK_GYRO_RES_PER_DPS);
+
+    gamepad->fd = open(path, O_RDWR | O_CLOEXEC);
+    if (gamepad->fd < 0) {
+        fprintf(stderr, "Cannot open uhid-cdev %s: %d\n", path, gamepad->fd);
+        ret = gamepad->fd;
+        goto virt_deck_init_err;
+    }
+
+    ret = create(gamepad->fd);
+    if (ret) {
+        fprintf(stderr, "Error creating uhid device: %d\n", ret);
+        close(gamepad->fd);
+        goto virt_deck_init_err;
+    }
+
+virt_deck_init_err:
+    return ret;
+}
+
+int virt_deck_get_fd(virt_deck_t *const gamepad) {
+    return gamepad->fd;
+}
+
+int virt_deck_event(virt_deck_t *const gamepad, gamepad_status_t *const out_device_status)
+{
+	struct uhid_event ev;
+	ssize_t ret;
+
+	const int fd = virt_deck_get_fd(gamepad);
+
+	memset(&ev, 0, sizeof(ev));
+	ret = read(fd, &ev, sizeof(ev));
+	if (ret == 0) {
+		fprintf(stderr, "Read HUP on uhid-cdev\n");
+		return -EFAULT;
+	} else if (ret < 0) {
+		fprintf(stderr, "Cannot read uhid-cdev: %d\n", (int)ret);
+		return -errno;
+	} else if (ret != sizeof(ev)) {
+		fprintf(stderr, "Invalid size read from uhid-dev: %zd != %zu\n",
+			ret, sizeof(ev));
+		return -EFAULT;
+	}
+
+	switch (ev.type) {
+	case UHID_START:
+	case UHID_STOP:
+	case UHID_OPEN:
+	case UHID_CLOSE:
+		if (gamepad->debug) {
+			printf("UHID event %u from uhid-dev\n", ev.type);
+		}
+		break;
+	case UHID_OUTPUT:
+		// commands are also accepted as output reports: [0] is the (unused) report id
+		if ((ev.u.output.rtype == UHID_OUTPUT_REPORT) && (ev.u.output.size > 1)) {
+			handle_command(gamepad, out_device_status, &ev.u.output.data[1], ev.u.output.size - 1);
+		}
+		break;
+	case UHID_SET_REPORT: {
+		struct uhid_event reply;
+		memset(&reply, 0, sizeof(reply));
+		reply.type = UHID_SET_REPORT_REPLY;
+		reply.u.set_report_reply.id = ev.u.set_report.id;
+		reply.u.set_report_reply.err = 0;
+
+		// [0] is the report id: always 0 as the descriptor declares none
+		if ((ev.u.set_report.rtype == UHID_FEATURE_REPORT) && (ev.u.set_report.size > 1)) {
+			handle_command(gamepad, out_device_status, &ev.u.set_report.data[1], ev.u.set_report.size - 1);
+		} else {
+			reply.u.set_report_reply.err = EIO;
+		}
+
+		uhid_write(fd, &reply);
+		break;
+	}
+	case UHID_GET_REPORT: {
+		struct uhid_event reply;
+		memset(&reply, 0, sizeof(reply));
+		reply.type = UHID_GET_REPORT_REPLY;
+		reply.u.get_report_reply.id = ev.u.get_report.id;
+
+		if (ev.u.get_report.rtype == UHID_FEATURE_REPORT) {
+			reply.u.get_report_reply.err = 0;
+			reply.u.get_report_reply.size = 1 + sizeof(gamepad->feature_reply);
+			reply.u.get_report_reply.data[0] = 0x00;
+			memcpy(&reply.u.get_report_reply.data[1], gamepad->feature_reply, sizeof(gamepad->feature_reply));
+		} else {
+			reply.u.get_report_reply.err = EIO;
+		}
+
+		uhid_write(fd, &reply);
+		break;
+	}
+	default:
+		fprintf(stderr, "Invalid event from uhid-dev: %u\n", ev.type);
+	}
+
+	return 0;
+}
+
+void virt_deck_compose(virt_deck_t *const gamepad, gamepad_status_t *const in_device_status, uint8_t *const out_buf) {
+    // the whole report is 64 bytes: it is rebuilt every time and the dirty mask is only consumed
+    in_device_status->dirty = 0;
+
+    memset(out_buf, 0, VIRT_DECK_REPORT_SIZE);
+
+    out_buf[0] = 0x01;
+    out_buf[1] = 0x00;
+    out_buf[2] = DECK_ID_CONTROLLER_DECK_STATE;
+    out_buf[3] = VIRT_DECK_REPORT_SIZE;
+    put_le32(&out_buf[4], gamepad->seq_num++);
+
+    out_buf[8] = (in_device_status->r2_trigger >= 225 ? 0x01 : 0x00) |
+        (in_device_status->l2_trigger >= 225 ? 0x02 : 0x00) |
+        (in_device_status->r1 ? 0x04 : 0x00) |
+        (in_device_status->l1 ? 0x08 : 0x00) |
+        (in_device_status->triangle ? 0x10 : 0x00) |
+        (in_device_status->circle ? 0x20 : 0x00) |
+        (in_device_status->square ? 0x40 : 0x00) |
+        (in_device_status->cross ? 0x80 : 0x00);
+
+    out_buf[9] = ((in_device_status->dpad & 0x10) ? 0x01 : 0x00) |
+        ((in_device_status->dpad & 0x01) ? 0x02 : 0x00) |
+        ((in_device_status->dpad & 0x02) ? 0x04 : 0x00) |
+        ((in_device_status->dpad & 0x20) ? 0x08 : 0x00) |
+        (in_device_status->share ? 0x10 : 0x00) |
+        (in_device_status->center ? 0x20 : 0x00) |
+        (in_device_status->option ? 0x40 : 0x00) |
+        (in_device_status->l5 ? 0x80 : 0x00);
+
+    const bool touching = in_device_status->touchpad_touch_num != -1;
+
+    out_buf[10] = (in_device_status->r5 ? 0x01 : 0x00) |
+        (in_device_status->touchpad_press ? 0x04 : 0x00) |
+        (touching ? 0x10 : 0x00) |
+        (in_device_status->l3 ? 0x40 : 0x00);
+
+    out_buf[11] = (in_device_status->r3 ? 0x04 : 0x00);
+
+    out_buf[13] = (in_device_status->l4 ? 0x02 : 0x00) |
+        (in_device_status->r4 ? 0x04 : 0x00);
+
+    // the touchpad is reported as the right trackpad: centered and with the Y axis pointing up
+    if (touching) {
+        const int64_t pad_x = ((int64_t)in_device_status->touchpad_x * (int64_t)65535) / (int64_t)1920 - (int64_t)32768;
+        const int64_t pad_y = (int64_t)32767 - ((int64_t)in_device_status->touchpad_y * (int64_t)65535) / (int64_t)1080;
+        put_le16(&out_buf[20], (int16_t)min_max_clamp(pad_x, -32768, 32767));
+        put_le16(&out_buf[22], (int16_t)min_max_clamp(pad_y, -32768, 32767));
+        put_le16(&out_buf[58], in_device_status->touchpad_press ? 32767 : 0);
+    }
+
+    int16_t accel[3], gyro[3];
+    imu_matrix_apply(&gamepad->accel_matrix, in_device_status->raw_accel, accel);
+    imu_matrix_apply(&gamepad->gyro_matrix, in_device_status->raw_gyro, gyro);
+    for (int i = 0; i < 3; ++i) {
+        put_le16(&out_buf[24 + (i * 2)], accel[i]);
+        put_le16(&out_buf[30 + (i * 2)], gyro[i]);
+    }
+
+    const uint8_t l2 = gamepad_response_trigger(gamepad->response, in_device_status->l2_trigger);
+    const uint8_t r2 = gamepad_response_trigger(gamepad->response, in_device_status->r2_trigger);
+    put_le16(&out_buf[44], (int16_t)(((uint16_t)l2 << 7) | ((uint16_t)l2 >> 1)));
+    put_le16(&out_buf[46], (int16_t)(((uint16_t)r2 << 7) | ((uint16_t)r2 >> 1)));
+
+    int32_t sticks[2][2];
+    gamepad_response_sticks(gamepad->response, in_device_status, sticks);
+
+    // the Y axis of the Deck sticks points up
+    put_le16(&out_buf[48], (int16_t)sticks[0][0]);
+    put_le16(&out_buf[50], (int16_t)min_max_clamp(-(int64_t)sticks[0][1], -32768, 32767));
+    put_le16(&out_buf[52], (int16_t)sticks[1][0]);
+    put_le16(&out_buf[54], (int16_t)min_max_clamp(-(int64_t)sticks[1][1], -32768, 32767));
+}
+
+int virt_deck_send(virt_deck_t *const gamepad, uint8_t *const out_buf) {
+    struct uhid_event l = {
+        .type = UHID_INPUT2,
+        .u = {
+            .input2 = {
+                .size = VIRT_DECK_REPORT_SIZE,
+            }
+        }
+    };
+
+    memcpy(&l.u.input2.data[0], &out_buf[0], l.u.input2.size);
+
+    return uhid_write(gamepad->fd, &l);
+}
+
+void virt_deck_close(virt_deck_t *const gamepad) {
+    destroy(gamepad->fd);
+    close(gamepad->fd);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "message.h"
+#include "devices_status.h"
+#include "gamepad_response.h"
+#include "imu_matrix.h"
+
+#define VIRT_DECK_DEV_NAME "Valve Software Steam Deck Controller"
+#define VIRT_DECK_DEV_VENDOR_ID 0x28de
+#define VIRT_DECK_DEV_PRODUCT_ID 0x1205
+#define VIRT_DECK_DEV_VERSION 0x0111
+
+// every input, output and feature report of the gamepad interface is 64 bytes long and carries no report id
+#define VIRT_DECK_REPORT_SIZE 64
+
+/**
+ * Emulator of the Steam Deck gamepad interface using USB UHID ( https://www.kernel.org/doc/html/latest/hid/uhid.html ) kernel APIs.
+ *
+ * Only the vendor-defined interface is emulated: the real controller also exposes a keyboard and a mouse
+ * that are fed by the firmware while in "lizard mode", here those are never emulated and the commands
+ * steam (or hid-steam) sends to leave lizard mode are only acknowledged.
+ */
+typedef struct virt_deck {
+    int fd;
+
+    bool debug;
+
+    uint32_t seq_num;
+
+    // sticks, triggers and gyro-to-analog curves: owned by the caller of the init function
+    const gamepad_response_t *response;
+
+    // conversion of raw_accel and raw_gyro to the axes and resolutions hid-steam expects
+    imu_matrix_t accel_matrix;
+    imu_matrix_t gyro_matrix;
+
+    // true until a CLEAR_DIGITAL_MAPPINGS command is received
+    bool lizard_mode;
+
+    // reply to the last command received with a SET_REPORT: returned by the following GET_REPORT
+    uint8_t feature_reply[VIRT_DECK_REPORT_SIZE];
+} virt_deck_t;
+
+int virt_deck_init(
+    virt_deck_t *const gamepad,
+    const gamepad_response_t *const response
+);
+
+int virt_deck_get_fd(
+    virt_deck_t *const gamepad
+);
+
+int virt_deck_event(
+    virt_deck_t *const gamepad,
+    gamepad_status_t *const out_device_status
+);
+
+void virt_deck_compose(
+    virt_deck_t *const gamepad,
+    gamepad_status_t *const in_device_status,
+    uint8_t *const out_buf
+);
+
+int virt_deck_send(
+    virt_deck_t *const gamepad,
+    uint8_t *const out_buf
+);
+
+void virt_deck_close(
+    virt_deck_t *const gamepad
+);
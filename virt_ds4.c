@@ -1,5 +1,7 @@
 #include "virt_ds4.h"
 #include "message.h"
+#include "ps_crc32.h"
+#include "ps_calibration.h"
 
 #include <linux/uhid.h>
 
@@ -21,45 +23,26 @@
 #define DS4_OUTPUT_REPORT_BT			0x11
 #define DS4_OUTPUT_REPORT_BT_SIZE		78
 
-#define DS4_FEATURE_REPORT_CALIBRATION		0x02
-#define DS4_FEATURE_REPORT_CALIBRATION_SIZE	37
-#define DS4_FEATURE_REPORT_CALIBRATION_BT	0x05
-#define DS4_FEATURE_REPORT_CALIBRATION_BT_SIZE	41
-#define DS4_FEATURE_REPORT_FIRMWARE_INFO	0xa3
-#define DS4_FEATURE_REPORT_FIRMWARE_INFO_SIZE	49
-#define DS4_FEATURE_REPORT_PAIRING_INFO		0x12
-#define DS4_FEATURE_REPORT_PAIRING_INFO_SIZE	16
-
-static const uint16_t gyro_pitch_bias  = 0xfff9;
-static const uint16_t gyro_yaw_bias    = 0x0009;
-static const uint16_t gyro_roll_bias   = 0xfff9;
-static const uint16_t gyro_pitch_plus  = 0x22fe;
-static const uint16_t gyro_pitch_minus = 0xdcf4;
-static const uint16_t gyro_yaw_plus    = 0x22bb;
-static const uint16_t gyro_yaw_minus   = 0xdd59;
-static const uint16_t gyro_roll_plus   = 0x2289;
-static const uint16_t gyro_roll_minus  = 0xdd68;
-static const uint16_t gyro_speed_plus  = 0x021c /* 540 */; // speed_2x = (gyro_speed_plus + gyro_speed_minus) = 1080;
-static const uint16_t gyro_speed_minus = 0x021c /* 540 */; // speed_2x = (gyro_speed_plus + gyro_speed_minus) = 1080;
-static const uint16_t acc_x_plus       = 0x20d3;
-static const uint16_t acc_x_minus      = 0xdf07;
-static const uint16_t acc_y_plus       = 0x20bf;
-static const uint16_t acc_y_minus      = 0xe0aa;
-static const uint16_t acc_z_plus       = 0x1ebc;
-static const uint16_t acc_z_minus      = 0xe086;
-
 static const char* path = "/dev/uhid";
 
-/* Seed values for DualShock4 / DualSense CRC32 for different report types. */
-static uint8_t PS_INPUT_CRC32_SEED = 0xA1;
-static uint8_t PS_OUTPUT_CRC32_SEED = 0xA2;
-static uint8_t PS_FEATURE_CRC32_SEED = 0xA3;
+static const uint8_t MAC_ADDR[] = { 0xf2, 0xa5, 0x71, 0x68, 0xaf, 0xdc };
 
-static uint32_t crc32_le(uint32_t crc_initial, const uint8_t *const buf, size_t len) {
-    return crc32(crc_initial ^ 0xffffffff, buf, len) ^ 0xffffffff;
-}
+static const uint8_t PAIRING_INFO_REPORT[DS4_FEATURE_REPORT_PAIRING_INFO_SIZE] = {
+    DS4_FEATURE_REPORT_PAIRING_INFO,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // MAC_ADDR: filled by virt_dualshock_init
+    0x08,
+    0x25, 0x00, 0x4c, 0x46, 0x49, 0x0e, 0x41, 0x00
+};
 
-static const uint8_t MAC_ADDR[] = { 0xf2, 0xa5, 0x71, 0x68, 0xaf, 0xdc };
+static const uint8_t FIRMWARE_INFO_REPORT[DS4_FEATURE_REPORT_FIRMWARE_INFO_SIZE] = {
+    DS4_FEATURE_REPORT_FIRMWARE_INFO, 0x53, 0x65, 0x70, 0x20, 0x32, 0x31, 0x20,
+    0x32, 0x30, 0x31, 0x38, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x30, 0x34, 0x3a, 0x35, 0x30, 0x3a, 0x35,
+    0x31, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x01, 0x0c, 0xb4, 0x01, 0x00, 0x00,
+    0x00, 0x0a, 0xa0, 0x10, 0x20, 0x00, 0xa0, 0x02,
+    0x00
+};
 
 static unsigned char rdesc[] = {
     0x05, 0x01,         /*  Usage Page (Desktop),               */
@@ -385,6 +368,46 @@ static int create(int fd, bool bluetooth)
 	return uhid_write(fd, &ev);
 }
 
+static int feature_report_reply(int fd, uint32_t id, const uint8_t *const data, uint16_t size)
+{
+	struct uhid_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.type = UHID_GET_REPORT_REPLY;
+	ev.u.get_report_reply.id = id;
+	ev.u.get_report_reply.err = 0;
+	ev.u.get_report_reply.size = size;
+	memcpy(&ev.u.get_report_reply.data[0], data, size);
+
+	return uhid_write(fd, &ev);
+}
+
+/**
+ * Build the constant GET_REPORT replies once: calibration data never changes and in bluetooth mode
+ * every feature report also needs its CRC32 appended.
+ */
+static void build_feature_reports(virt_dualshock_t *const gamepad) {
+    memcpy(gamepad->pairing_info_report, PAIRING_INFO_REPORT, sizeof(PAIRING_INFO_REPORT));
+    memcpy(&gamepad->pairing_info_report[1], MAC_ADDR, sizeof(MAC_ADDR));
+    memcpy(gamepad->firmware_info_report, FIRMWARE_INFO_REPORT, sizeof(FIRMWARE_INFO_REPORT));
+
+    uint8_t *const calibration = gamepad->calibration_report;
+    memset(calibration, 0, sizeof(gamepad->calibration_report));
+    calibration[0] = gamepad->bluetooth ? DS4_FEATURE_REPORT_CALIBRATION_BT : DS4_FEATURE_REPORT_CALIBRATION;
+    calibration[35] = 0x06;
+    gamepad->calibration_report_size = gamepad->bluetooth ? DS4_FEATURE_REPORT_CALIBRATION_BT_SIZE : DS4_FEATURE_REPORT_CALIBRATION_SIZE;
+
+    // the kernel reports gyroscope readings in units of 1/DS4_GYRO_RES_PER_DEG_S deg/s and accelerometer ones in
+    // units of 1/DS4_ACC_RES_PER_G g: the calibration tells it what our readings are so they are sent unscaled
+    ps_calibration_build(&calibration[PS_CALIBRATION_OFFSET], gamepad->bluetooth);
+
+    if (gamepad->bluetooth) {
+        ps_crc32_report_seal(PS_FEATURE_CRC32_SEED, gamepad->pairing_info_report, sizeof(gamepad->pairing_info_report));
+        ps_crc32_report_seal(PS_FEATURE_CRC32_SEED, gamepad->firmware_info_report, sizeof(gamepad->firmware_info_report));
+        ps_crc32_report_seal(PS_FEATURE_CRC32_SEED, calibration, gamepad->calibration_report_size);
+    }
+}
+
 static void destroy(int fd)
 {
 	struct uhid_event ev;
@@ -432,13 +455,11 @@ static ds4_dpad_status_t ds4_dpad_from_gamepad(uint8_t dpad) {
 int virt_dualshock_init(
     virt_dualshock_t *const out_gamepad,
     bool bluetooth,
-    int64_t gyro_to_analog_activation_treshold,
-    int64_t gyro_to_analog_mapping
+    const gamepad_response_t *const response
 ) {
     int ret = 0;
 
-    out_gamepad->gyro_to_analog_activation_treshold = absolute_value(gyro_to_analog_activation_treshold);
-    out_gamepad->gyro_to_analog_mapping = gyro_to_analog_mapping;
+    out_gamepad->response = response;
     out_gamepad->dt_sum = 0;
     out_gamepad->dt_buffer_current = 0;
     memset(out_gamepad->dt_buffer, 0, sizeof(out_gamepad->dt_buffer));
@@ -447,6 +468,9 @@ int virt_dualshock_init(
     out_gamepad->last_time = 0;
     out_gamepad->bluetooth = bluetooth;
 
+    ps_crc32_init();
+    build_feature_reports(out_gamepad);
+
     out_gamepad->fd = open(path, O_RDWR | O_CLOEXEC /* | O_NONBLOCK */);
     if (out_gamepad->fd < 0) {
         fprintf(stderr, "Cannot open uhid-cdev %s: %d\n", path, out_gamepad->fd);
@@ -609,112 +633,12 @@ int virt_dualshock_event(virt_dualshock_t *const gamepad, gamepad_status_t *cons
             printf("UHID_GET_REPORT from uhid-dev, report=%d\n", ev.u.get_report.rnum);
         }
         
-        if (ev.u.get_report.rnum == 18) {
-            struct uhid_event mac_addr_response = {
-                .type = UHID_GET_REPORT_REPLY,
-                .u = {
-                    .get_report_reply = {
-                        .size = DS4_FEATURE_REPORT_PAIRING_INFO_SIZE,
-                        .id = ev.u.get_report.id,
-                        .err = 0,
-                        .data = {
-                            DS4_FEATURE_REPORT_PAIRING_INFO,
-                            MAC_ADDR[0], MAC_ADDR[1], MAC_ADDR[2], MAC_ADDR[3], MAC_ADDR[4], MAC_ADDR[5],
-                            0x08,
-                            0x25, 0x00, 0x4c, 0x46, 0x49, 0x0e, 0x41, 0x00
-                        }
-                    }
-                }
-            };
-
-            if (gamepad->bluetooth) {
-                uint32_t crc = crc32_le(0xFFFFFFFFU, (const uint8_t*)&PS_FEATURE_CRC32_SEED, sizeof(PS_FEATURE_CRC32_SEED));
-                crc = ~crc32_le(crc, (const Bytef *)&mac_addr_response.u.get_report_reply.data[0], mac_addr_response.u.get_report_reply.size - 4);
-                memcpy(&mac_addr_response.u.get_report_reply.data[mac_addr_response.u.get_report_reply.size - sizeof(crc)], &crc, sizeof(crc));
-            }
-
-            uhid_write(gamepad->fd, &mac_addr_response);
+        if (ev.u.get_report.rnum == DS4_FEATURE_REPORT_PAIRING_INFO) {
+            feature_report_reply(gamepad->fd, ev.u.get_report.id, gamepad->pairing_info_report, sizeof(gamepad->pairing_info_report));
         } else if (ev.u.get_report.rnum == DS4_FEATURE_REPORT_FIRMWARE_INFO) {
-            struct uhid_event firmware_info_response = {
-                .type = UHID_GET_REPORT_REPLY,
-                .u = {
-                    .get_report_reply = {
-                        .size = DS4_FEATURE_REPORT_FIRMWARE_INFO_SIZE,
-                        .id = ev.u.get_report.id,
-                        .err = 0,
-                        .data = {
-                            DS4_FEATURE_REPORT_FIRMWARE_INFO, 0x53, 0x65, 0x70, 0x20, 0x32, 0x31, 0x20,
-                            0x32, 0x30, 0x31, 0x38, 0x00, 0x00, 0x00, 0x00,
-                            0x00, 0x30, 0x34, 0x3a, 0x35, 0x30, 0x3a, 0x35,
-                            0x31, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                            0x00, 0x00, 0x01, 0x0c, 0xb4, 0x01, 0x00, 0x00,
-                            0x00, 0x0a, 0xa0, 0x10, 0x20, 0x00, 0xa0, 0x02,
-                            0x00
-                        }
-                    }
-                }
-            };
-
-            if (gamepad->bluetooth) {
-                uint32_t crc = crc32_le(0xFFFFFFFFU, (const uint8_t*)&PS_FEATURE_CRC32_SEED, sizeof(PS_FEATURE_CRC32_SEED));
-                crc = ~crc32_le(crc, (const Bytef *)&firmware_info_response.u.get_report_reply.data[0], firmware_info_response.u.get_report_reply.size - 4);
-                memcpy(&firmware_info_response.u.get_report_reply.data[firmware_info_response.u.get_report_reply.size - sizeof(crc)], &crc, sizeof(crc));
-            }
-
-            uhid_write(gamepad->fd, &firmware_info_response);
-        } else if (
-            ((gamepad->bluetooth) && (ev.u.get_report.rnum == DS4_FEATURE_REPORT_CALIBRATION_BT)) ||
-            ((!gamepad->bluetooth) && (ev.u.get_report.rnum == DS4_FEATURE_REPORT_CALIBRATION))
-        ) { // dualshock4_get_calibration_data
-            struct uhid_event calibration_response = {
-                .type = UHID_GET_REPORT_REPLY,
-                .u = {
-                    .get_report_reply = {
-                        .size = gamepad->bluetooth ? DS4_FEATURE_REPORT_CALIBRATION_BT_SIZE : DS4_FEATURE_REPORT_CALIBRATION_SIZE,
-                        .id = ev.u.get_report.id,
-                        .err = 0,
-                        .data = {
-                            gamepad->bluetooth ? DS4_FEATURE_REPORT_CALIBRATION_BT : DS4_FEATURE_REPORT_CALIBRATION,
-                            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                            0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00,
-                            0x00,
-                        }
-                    }
-                }
-            };
-
-            // bias in kernel is 0 (embedded constant)
-            // speed_2x = speed_2x*DS4_GYRO_RES_PER_DEG_S; calculated by the kernel will be 1080.
-            // As a consequence sens_numer (for every axis) is 1080*1024.
-            // that number will be 1105920
-            memcpy((void*)&calibration_response.u.get_report_reply.data[1], (const void*)&gyro_pitch_bias, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[3], (const void*)&gyro_yaw_bias, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[5], (const void*)&gyro_roll_bias, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[7], (const void*)&gyro_pitch_plus, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[9], (const void*)&gyro_pitch_minus, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[11], (const void*)&gyro_yaw_plus, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[13], (const void*)&gyro_yaw_minus, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[15], (const void*)&gyro_roll_plus, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[17], (const void*)&gyro_roll_minus, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[19], (const void*)&gyro_speed_plus, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[21], (const void*)&gyro_speed_minus, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[23], (const void*)&acc_x_plus, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[25], (const void*)&acc_x_minus, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[27], (const void*)&acc_y_plus, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[29], (const void*)&acc_y_minus, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[31], (const void*)&acc_z_plus, sizeof(int16_t));
-            memcpy((void*)&calibration_response.u.get_report_reply.data[33], (const void*)&acc_z_minus, sizeof(int16_t));
-
-            if (gamepad->bluetooth) {
-                uint32_t crc = crc32_le(0xFFFFFFFFU, (const uint8_t*)&PS_FEATURE_CRC32_SEED, sizeof(PS_FEATURE_CRC32_SEED));
-                crc = ~crc32_le(crc, (const Bytef *)&calibration_response.u.get_report_reply.data[0], calibration_response.u.get_report_reply.size - 4);
-                memcpy(&calibration_response.u.get_report_reply.data[calibration_response.u.get_report_reply.size - sizeof(crc)], &crc, sizeof(crc));
-            }
-
-            uhid_write(gamepad->fd, &calibration_response);
+            feature_report_reply(gamepad->fd, ev.u.get_report.id, gamepad->firmware_info_report, sizeof(gamepad->firmware_info_report));
+        } else if (ev.u.get_report.rnum == gamepad->calibration_report[0]) { // dualshock4_get_calibration_data
+            feature_report_reply(gamepad->fd, ev.u.get_report.id, gamepad->calibration_report, gamepad->calibration_report_size);
         }
 
 		break;
@@ -727,6 +651,7 @@ int virt_dualshock_event(virt_dualshock_t *const gamepad, gamepad_status_t *cons
 
 void virt_dualshock_close(virt_dualshock_t *const out_gamepad) {
     destroy(out_gamepad->fd);
+    close(out_gamepad->fd);
 }
 
 /**
@@ -783,8 +708,8 @@ void virt_dualshock_compose(virt_dualshock_t *const gamepad, gamepad_status_t *c
      * kernel will do:
      * int calib_data = mult_frac(ds4->gyro_calib_data[i].sens_numer, raw_data, ds4->gyro_calib_data[i].sens_denom);
      * input_report_abs(ds4->sensors, ds4->gyro_calib_data[i].abs_code, calib_data);
-     * 
-     * as we know sens_numer is 0, hence calib_data is zero.
+     *
+     * sens_numer and sens_denom come from the calibration report built out of our units: readings go as they are.
      */
 
     const int16_t g_x = in_device_status->raw_gyro[0];
@@ -794,17 +719,17 @@ void virt_dualshock_compose(virt_dualshock_t *const gamepad, gamepad_status_t *c
     const int16_t a_y = in_device_status->raw_accel[1];
     const int16_t a_z = in_device_status->raw_accel[2];
 
-    const int64_t contrib_x = ((int64_t)g_y / (int64_t)gamepad->gyro_to_analog_mapping);
-    const int64_t contrib_y = ((int64_t)g_x / (int64_t)gamepad->gyro_to_analog_mapping);
+    int32_t sticks[2][2];
+    gamepad_response_sticks(gamepad->response, in_device_status, sticks);
 
     out_buf[0] = gamepad->bluetooth ? DS4_INPUT_REPORT_BT : DS4_INPUT_REPORT_USB;  // [00] report ID (0x01)
 
     uint8_t *const out_shifted_buf = gamepad->bluetooth ? &out_buf[2] : &out_buf[0];
 
-    out_shifted_buf[1] = ((uint64_t)((int64_t)in_device_status->joystick_positions[0][0] + (int64_t)32768) >> (uint64_t)8); // L stick, X axis
-    out_shifted_buf[2] = ((uint64_t)((int64_t)in_device_status->joystick_positions[0][1] + (int64_t)32768) >> (uint64_t)8); // L stick, Y axis
-    out_shifted_buf[3] = ((uint64_t)((int64_t)in_device_status->joystick_positions[1][0] + (int64_t)32768) >> (uint64_t)8); // R stick, X axis
-    out_shifted_buf[4] = ((uint64_t)((int64_t)in_device_status->joystick_positions[1][1] + (int64_t)32768) >> (uint64_t)8); // R stick, Y axis
+    out_shifted_buf[1] = (uint8_t)((uint32_t)(sticks[0][0] + 32768) >> 8); // L stick, X axis
+    out_shifted_buf[2] = (uint8_t)((uint32_t)(sticks[0][1] + 32768) >> 8); // L stick, Y axis
+    out_shifted_buf[3] = (uint8_t)((uint32_t)(sticks[1][0] + 32768) >> 8); // R stick, X axis
+    out_shifted_buf[4] = (uint8_t)((uint32_t)(sticks[1][1] + 32768) >> 8); // R stick, Y axis
     out_shifted_buf[5] =
         (in_device_status->triangle ? 0x80 : 0x00) |
         (in_device_status->circle ? 0x40 : 0x00) |
@@ -820,31 +745,11 @@ void virt_dualshock_compose(virt_dualshock_t *const gamepad, gamepad_status_t *c
         /*(in_device_status->l2_trigger > 200 ? 0x04 : 0x00)*/ 0x00 |
         (in_device_status->r1 ? 0x02 : 0x00) |
         (in_device_status->l1 ? 0x01 : 0x00);
-    
-    if (in_device_status->join_left_analog_and_gyroscope) {
-        if (absolute_value(contrib_x) > gamepad->gyro_to_analog_activation_treshold) {
-            out_shifted_buf[1] = min_max_clamp((int64_t)127 + (((int64_t)out_shifted_buf[1] - (int64_t)127) + contrib_x), 0, 255);
-        }
-        
-        if (absolute_value(contrib_y) >= gamepad->gyro_to_analog_activation_treshold) {
-            out_shifted_buf[2] = min_max_clamp((int64_t)127 + (((int64_t)out_shifted_buf[2] - (int64_t)127) + contrib_y), 0, 255);
-        }
-    }
 
-    if (in_device_status->join_right_analog_and_gyroscope) {
-        if (absolute_value(contrib_x) >= gamepad->gyro_to_analog_activation_treshold) {
-            out_shifted_buf[3] = min_max_clamp((int64_t)127 + (((int64_t)out_shifted_buf[3] - (int64_t)127) + contrib_x), 0, 255);
-        }
-        
-        if (absolute_value(contrib_y) >= gamepad->gyro_to_analog_activation_treshold) {
-            out_shifted_buf[4] = min_max_clamp((int64_t)127 + (((int64_t)out_shifted_buf[4] - (int64_t)127) + contrib_y), 0, 255);
-        }
-    }
-    
     out_shifted_buf[7] = in_device_status->center ? 0x01 : 0x00;
 
-    out_shifted_buf[8] = in_device_status->l2_trigger;
-    out_shifted_buf[9] = in_device_status->r2_trigger;
+    out_shifted_buf[8] = gamepad_response_trigger(gamepad->response, in_device_status->l2_trigger);
+    out_shifted_buf[9] = gamepad_response_trigger(gamepad->response, in_device_status->r2_trigger);
     memcpy(&out_shifted_buf[10], &timestamp, sizeof(timestamp));
     out_shifted_buf[12] = 0x20; // [12] battery level | this is called sensor_temparature in the kernel driver but is never used...
     memcpy(&out_shifted_buf[13], &g_x, sizeof(int16_t));
@@ -874,13 +779,11 @@ int virt_dualshock_send(virt_dualshock_t *const gamepad, uint8_t *const out_buf)
         }
     };
 
-    memcpy(&l.u.input2.data[0], &out_buf[0], l.u.input2.size);
-
     if (gamepad->bluetooth) {
-        uint32_t crc = crc32_le(0xFFFFFFFFU, (const uint8_t*)&PS_INPUT_CRC32_SEED, sizeof(PS_INPUT_CRC32_SEED));
-        crc = ~crc32_le(crc, (const uint8_t *)&l.u.input2.data[0], l.u.input2.size - 4);
-        memcpy(&l.u.input2.data[l.u.input2.size - sizeof(crc)], &crc, sizeof(crc));
+        ps_crc32_report_seal(PS_INPUT_CRC32_SEED, out_buf, l.u.input2.size);
     }
 
+    memcpy(&l.u.input2.data[0], &out_buf[0], l.u.input2.size);
+
     return uhid_write(gamepad->fd, &l);
 }
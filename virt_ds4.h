@@ -2,6 +2,16 @@
 
 #include "message.h"
 #include "devices_status.h"
+#include "gamepad_response.h"
+
+#define DS4_FEATURE_REPORT_CALIBRATION		0x02
+#define DS4_FEATURE_REPORT_CALIBRATION_SIZE	37
+#define DS4_FEATURE_REPORT_CALIBRATION_BT	0x05
+#define DS4_FEATURE_REPORT_CALIBRATION_BT_SIZE	41
+#define DS4_FEATURE_REPORT_FIRMWARE_INFO	0xa3
+#define DS4_FEATURE_REPORT_FIRMWARE_INFO_SIZE	49
+#define DS4_FEATURE_REPORT_PAIRING_INFO		0x12
+#define DS4_FEATURE_REPORT_PAIRING_INFO_SIZE	16
 
 /**
  * Emulator of the DualShock4 controller at USB level using USB UHID ( https://www.kernel.org/doc/html/latest/hid/uhid.html ) kernel APIs.
@@ -22,15 +32,20 @@ typedef struct virt_dualshock {
     uint32_t empty_reports;
     int64_t last_time;
 
-    int64_t gyro_to_analog_activation_treshold;
-    int64_t gyro_to_analog_mapping;
+    // sticks, triggers and gyro-to-analog curves: owned by the caller of the init function
+    const gamepad_response_t *response;
+
+    // GET_REPORT replies are constant: built (and checksummed when in bluetooth mode) by virt_dualshock_init
+    uint8_t pairing_info_report[DS4_FEATURE_REPORT_PAIRING_INFO_SIZE];
+    uint8_t firmware_info_report[DS4_FEATURE_REPORT_FIRMWARE_INFO_SIZE];
+    uint8_t calibration_report[DS4_FEATURE_REPORT_CALIBRATION_BT_SIZE]; // the bluetooth one is the longest
+    uint16_t calibration_report_size;
 } virt_dualshock_t;
 
 int virt_dualshock_init(
     virt_dualshock_t *const gamepad,
     bool bluetooth,
-    int64_t gyro_to_analog_activation_treshold,
-    int64_t gyro_to_analog_mapping
+    const gamepad_response_t *const response
 );
 
 int virt_dualshock_get_fd(
@@ -1,18 +1,11 @@
 #include "virt_ds5.h"
 #include "message.h"
 #include "rogue_enemy.h"
+#include "ps_crc32.h"
+#include "ps_calibration.h"
 
 #include <linux/uhid.h>
 
-#define DS_FEATURE_REPORT_PAIRING_INFO      0x09
-#define DS_FEATURE_REPORT_PAIRING_INFO_SIZE 20
-
-#define DS_FEATURE_REPORT_FIRMWARE_INFO         0x20
-#define DS_FEATURE_REPORT_FIRMWARE_INFO_SIZE    64
-
-#define DS_FEATURE_REPORT_CALIBRATION       0x05
-#define DS_FEATURE_REPORT_CALIBRATION_SIZE  41
-
 #define DS_INPUT_REPORT_USB         0x01
 #define DS_INPUT_REPORT_USB_SIZE    64
 #define DS_INPUT_REPORT_BT          0x31
@@ -31,15 +24,6 @@
 
 #define DS5_SPEC_DELTA_TIME         4096.0f
 
-static uint32_t crc32_le(uint32_t crc_initial, const uint8_t *const buf, size_t len) {
-    return crc32(crc_initial ^ 0xffffffff, buf, len) ^ 0xffffffff;
-}
-
-/* Seed values for DualShock4 / DualSense CRC32 for different report types. */
-static uint8_t PS_INPUT_CRC32_SEED = 0xA1;
-static uint8_t PS_OUTPUT_CRC32_SEED = 0xA2;
-static uint8_t PS_FEATURE_CRC32_SEED = 0xA3;
-
 #define DS5_EDGE_NAME "Sony Interactive Entertainment DualSense Edge Wireless Controller"
 #define DS5_EDGE_VERSION 256
 #define DS5_EDGE_VENDOR 0x054C
@@ -55,6 +39,30 @@ static const char* path = "/dev/uhid";
 //static const char* const MAC_ADDR_STR = "e8:47:3a:d6:e7:74";
 static const uint8_t MAC_ADDR[] = { 0x74, 0xe7, 0xd6, 0x3a, 0x47, 0xe8 };
 
+static const uint8_t PAIRING_INFO_REPORT[DS_FEATURE_REPORT_PAIRING_INFO_SIZE] = {
+    DS_FEATURE_REPORT_PAIRING_INFO,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // MAC_ADDR: filled by virt_dualsense_init
+    0x08,
+    0x25, 0x00, 0x1e, 0x00, 0xee, 0x74, 0xd0, 0xbc,
+    0x00, 0x00, 0x00, 0x00
+};
+
+static const uint8_t FIRMWARE_INFO_REPORT[DS_FEATURE_REPORT_FIRMWARE_INFO_SIZE] = {
+    DS_FEATURE_REPORT_FIRMWARE_INFO,
+    0x4a, 0x75, 0x6e, 0x20, 0x31, 0x39, 0x20, 0x32, 0x30, 0x32, 0x33, 0x31, 0x34, 0x3a, 0x34,
+    0x37, 0x3a, 0x33, 0x34, 0x03, 0x00, 0x44, 0x00, 0x08, 0x02, 0x00, 0x01, 0x36, 0x00, 0x00, 0x01,
+    0xc1, 0xc8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x54, 0x01, 0x00, 0x00,
+    0x14, 0x00, 0x00, 0x00, 0x0b, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+static const uint8_t CALIBRATION_REPORT[DS_FEATURE_REPORT_CALIBRATION_SIZE] = {
+    DS_FEATURE_REPORT_CALIBRATION,
+    // motion sensors calibration: filled by build_feature_reports
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x0b, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
 static unsigned char rdesc_edge[] = {
     0x05,
         0x01,  // Usage Page (Generic Desktop)        0
@@ -1092,6 +1100,40 @@ static int create(int fd, bool bluetooth, bool dualsense_edge)
 	return uhid_write(fd, &ev);
 }
 
+static int feature_report_reply(int fd, uint32_t id, const uint8_t *const data, uint16_t size)
+{
+	struct uhid_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.type = UHID_GET_REPORT_REPLY;
+	ev.u.get_report_reply.id = id;
+	ev.u.get_report_reply.err = 0;
+	ev.u.get_report_reply.size = size;
+	memcpy(&ev.u.get_report_reply.data[0], data, size);
+
+	return uhid_write(fd, &ev);
+}
+
+/**
+ * Build the constant GET_REPORT replies once: calibration data never changes and in bluetooth mode
+ * every feature report also needs its CRC32 appended.
+ */
+static void build_feature_reports(virt_dualsense_t *const gamepad) {
+    memcpy(gamepad->pairing_info_report, PAIRING_INFO_REPORT, sizeof(PAIRING_INFO_REPORT));
+    memcpy(&gamepad->pairing_info_report[1], MAC_ADDR, sizeof(MAC_ADDR));
+    memcpy(gamepad->firmware_info_report, FIRMWARE_INFO_REPORT, sizeof(FIRMWARE_INFO_REPORT));
+    memcpy(gamepad->calibration_report, CALIBRATION_REPORT, sizeof(CALIBRATION_REPORT));
+
+    // describe readings in the units they are received in: they are sent unscaled
+    ps_calibration_build(&gamepad->calibration_report[PS_CALIBRATION_OFFSET], false);
+
+    if (gamepad->bluetooth) {
+        ps_crc32_report_seal(PS_FEATURE_CRC32_SEED, gamepad->pairing_info_report, sizeof(gamepad->pairing_info_report));
+        ps_crc32_report_seal(PS_FEATURE_CRC32_SEED, gamepad->firmware_info_report, sizeof(gamepad->firmware_info_report));
+        ps_crc32_report_seal(PS_FEATURE_CRC32_SEED, gamepad->calibration_report, sizeof(gamepad->calibration_report));
+    }
+}
+
 static void destroy(int fd)
 {
 	struct uhid_event ev;
@@ -1106,13 +1148,11 @@ int virt_dualsense_init(
     virt_dualsense_t *const out_gamepad,
     bool bluetooth,
     bool dualsense_edge,
-    int64_t gyro_to_analog_activation_treshold,
-    int64_t gyro_to_analog_mapping
+    const gamepad_response_t *const response
 ) {
     int ret = 0;
 
-    out_gamepad->gyro_to_analog_activation_treshold = absolute_value(gyro_to_analog_activation_treshold);
-    out_gamepad->gyro_to_analog_mapping = gyro_to_analog_mapping;
+    out_gamepad->response = response;
     out_gamepad->edge_model = dualsense_edge;
     out_gamepad->bluetooth = bluetooth;
     out_gamepad->dt_sum = 0;
@@ -1122,6 +1162,10 @@ int virt_dualsense_init(
     out_gamepad->empty_reports = 0;
     out_gamepad->last_time = 0;
     out_gamepad->seq_num = 0;
+    out_gamepad->report_composed = false;
+
+    ps_crc32_init();
+    build_feature_reports(out_gamepad);
 
     out_gamepad->fd = open(path, O_RDWR | O_CLOEXEC /* | O_NONBLOCK */);
     if (out_gamepad->fd < 0) {
@@ -1299,82 +1343,11 @@ int virt_dualsense_event(virt_dualsense_t *const gamepad, gamepad_status_t *cons
     case UHID_GET_REPORT:
         //fprintf(stderr, "UHID_GET_REPORT from uhid-dev, report=%d\n", ev.u.get_report.rnum);
         if (ev.u.get_report.rnum == DS_FEATURE_REPORT_PAIRING_INFO) {
-            struct uhid_event mac_addr_response = {
-                .type = UHID_GET_REPORT_REPLY,
-                .u = {
-                    .get_report_reply = {
-                        .size = 20,
-                        .id = ev.u.get_report.id,
-                        .err = 0,
-                        .data = {
-                            DS_FEATURE_REPORT_PAIRING_INFO,
-                            MAC_ADDR[0], MAC_ADDR[1], MAC_ADDR[2], MAC_ADDR[3], MAC_ADDR[4], MAC_ADDR[5],
-                            0x08,
-                            0x25, 0x00, 0x1e, 0x00, 0xee, 0x74, 0xd0, 0xbc,
-                            0x00, 0x00, 0x00, 0x00
-                        }
-                    }
-                }
-            };
-
-            if (gamepad->bluetooth) {
-                uint32_t crc = crc32_le(0xFFFFFFFFU, (const uint8_t*)&PS_FEATURE_CRC32_SEED, sizeof(PS_FEATURE_CRC32_SEED));
-                crc = ~crc32_le(crc, (const Bytef *)&mac_addr_response.u.get_report_reply.data[0], mac_addr_response.u.get_report_reply.size - 4);
-                memcpy(&mac_addr_response.u.get_report_reply.data[mac_addr_response.u.get_report_reply.size - sizeof(crc)], &crc, sizeof(crc));
-            }
-
-            uhid_write(fd, &mac_addr_response);
+            feature_report_reply(fd, ev.u.get_report.id, gamepad->pairing_info_report, sizeof(gamepad->pairing_info_report));
         } else if (ev.u.get_report.rnum == DS_FEATURE_REPORT_FIRMWARE_INFO) {
-            struct uhid_event firmware_info_response = {
-                .type = UHID_GET_REPORT_REPLY,
-                .u = {
-                    .get_report_reply = {
-                        .size = DS_FEATURE_REPORT_FIRMWARE_INFO_SIZE,
-                        .id = ev.u.get_report.id,
-                        .err = 0,
-                        .data = {
-                            DS_FEATURE_REPORT_FIRMWARE_INFO,
-                            0x4a, 0x75, 0x6e, 0x20, 0x31, 0x39, 0x20, 0x32, 0x30, 0x32, 0x33, 0x31, 0x34, 0x3a, 0x34,
-                            0x37, 0x3a, 0x33, 0x34, 0x03, 0x00, 0x44, 0x00, 0x08, 0x02, 0x00, 0x01, 0x36, 0x00, 0x00, 0x01,
-                            0xc1, 0xc8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x54, 0x01, 0x00, 0x00,
-                            0x14, 0x00, 0x00, 0x00, 0x0b, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                        }
-                    }
-                }
-            };
-
-            if (gamepad->bluetooth) {
-                uint32_t crc = crc32_le(0xFFFFFFFFU, (const uint8_t*)&PS_FEATURE_CRC32_SEED, sizeof(PS_FEATURE_CRC32_SEED));
-                crc = ~crc32_le(crc, (const Bytef *)&firmware_info_response.u.get_report_reply.data[0], firmware_info_response.u.get_report_reply.size - 4);
-                memcpy(&firmware_info_response.u.get_report_reply.data[firmware_info_response.u.get_report_reply.size - sizeof(crc)], &crc, sizeof(crc));
-            }
-
-            uhid_write(fd, &firmware_info_response);
+            feature_report_reply(fd, ev.u.get_report.id, gamepad->firmware_info_report, sizeof(gamepad->firmware_info_report));
         } else if (ev.u.get_report.rnum == DS_FEATURE_REPORT_CALIBRATION) {
-            struct uhid_event calibration_response = {
-                .type = UHID_GET_REPORT_REPLY,
-                .u = {
-                    .get_report_reply = {
-                        .size = DS_FEATURE_REPORT_CALIBRATION_SIZE,
-                        .id = ev.u.get_report.id,
-                        .err = 0,
-                        .data = {
-                            DS_FEATURE_REPORT_CALIBRATION,
-                            0xfe, 0xff, 0xfc, 0xff, 0xfe, 0xff, 0x83, 0x22, 0x78, 0xdd, 0x92, 0x22, 0x5f, 0xdd, 0x95,
-                            0x22, 0x6d, 0xdd, 0x1c, 0x02, 0x1c, 0x02, 0xf2, 0x1f, 0xed, 0xdf, 0xe3, 0x20, 0xda, 0xe0, 0xee,
-                            0x1f, 0xdf, 0xdf, 0x0b, 0x00, 0x00, 0x00, 0x00, 0x00,
-                        }
-                    }
-                }
-            };
-
-            if (gamepad->bluetooth) {
-                uint32_t crc = crc32_le(0xFFFFFFFFU, (const uint8_t*)&PS_FEATURE_CRC32_SEED, sizeof(PS_FEATURE_CRC32_SEED));
-                crc = ~crc32_le(crc, (const Bytef *)&calibration_response.u.get_report_reply.data[0], calibration_response.u.get_report_reply.size - 4);
-                memcpy(&calibration_response.u.get_report_reply.data[calibration_response.u.get_report_reply.size - sizeof(crc)], &crc, sizeof(crc));
-            }
-
-            uhid_write(fd, &calibration_response);
+            feature_report_reply(fd, ev.u.get_report.id, gamepad->calibration_report, sizeof(gamepad->calibration_report));
         }
 
 		break;
@@ -1421,6 +1394,7 @@ static ds5_dpad_status_t ds5_dpad_from_gamepad(uint8_t dpad) {
 
 void virt_dualsense_close(virt_dualsense_t *const out_gamepad) {
     destroy(out_gamepad->fd);
+    close(out_gamepad->fd);
 }
 
 void virt_dualsense_compose(virt_dualsense_t *const gamepad, gamepad_status_t *const in_device_status, uint8_t *const out_buf) {
@@ -1453,6 +1427,24 @@ void virt_dualsense_compose(virt_dualsense_t *const gamepad, gamepad_status_t *c
 
     const uint32_t timestamp = sim_time + (int)((double)gamepad->empty_reports * DS5_SPEC_DELTA_TIME);
 
+    // only rewrite the parts of the report that changed since the last one
+    uint32_t dirty = in_device_status->dirty;
+    in_device_status->dirty = 0;
+
+    if (!gamepad->report_composed) {
+        memset(gamepad->report, 0, sizeof(gamepad->report));
+        gamepad->report_composed = true;
+        dirty = GAMEPAD_STATUS_DIRTY_ALL;
+    }
+
+    // the gyroscope contributes to sticks position when joined
+    if (
+        (dirty & GAMEPAD_STATUS_DIRTY_GYRO) &&
+        ((in_device_status->join_left_analog_and_gyroscope) || (in_device_status->join_right_analog_and_gyroscope))
+    ) {
+        dirty |= GAMEPAD_STATUS_DIRTY_STICKS;
+    }
+
     const int16_t g_x = in_device_status->raw_gyro[0];
     const int16_t g_y = in_device_status->raw_gyro[1];
     const int16_t g_z = in_device_status->raw_gyro[2];
@@ -1460,83 +1452,84 @@ void virt_dualsense_compose(virt_dualsense_t *const gamepad, gamepad_status_t *c
     const int16_t a_y = in_device_status->raw_accel[1];
     const int16_t a_z = in_device_status->raw_accel[2];
 
-    const int64_t contrib_x = ((int64_t)g_y / (int64_t)gamepad->gyro_to_analog_mapping);
-    const int64_t contrib_y = ((int64_t)g_x / (int64_t)gamepad->gyro_to_analog_mapping);
+    uint8_t *const report = gamepad->report;
 
-    out_buf[0] = gamepad->bluetooth ? DS_INPUT_REPORT_BT : DS_INPUT_REPORT_USB;  // [00] report ID (0x01)
+    report[0] = gamepad->bluetooth ? DS_INPUT_REPORT_BT : DS_INPUT_REPORT_USB;  // [00] report ID (0x01)
 
-    uint8_t *const out_shifted_buf = gamepad->bluetooth ? &out_buf[1] : &out_buf[0];
-    out_shifted_buf[1] = ((uint64_t)((int64_t)in_device_status->joystick_positions[0][0] + (int64_t)32768) >> (uint64_t)8); // L stick, X axis
-    out_shifted_buf[2] = ((uint64_t)((int64_t)in_device_status->joystick_positions[0][1] + (int64_t)32768) >> (uint64_t)8); // L stick, Y axis
-    out_shifted_buf[3] = ((uint64_t)((int64_t)in_device_status->joystick_positions[1][0] + (int64_t)32768) >> (uint64_t)8); // R stick, X axis
-    out_shifted_buf[4] = ((uint64_t)((int64_t)in_device_status->joystick_positions[1][1] + (int64_t)32768) >> (uint64_t)8); // R stick, Y axis
+    uint8_t *const out_shifted_buf = gamepad->bluetooth ? &report[1] : &report[0];
 
-    if (in_device_status->join_left_analog_and_gyroscope) {
-        if (absolute_value(contrib_x) > gamepad->gyro_to_analog_activation_treshold) {
-            out_shifted_buf[1] = min_max_clamp((int64_t)127 + (((int64_t)out_shifted_buf[1] - (int64_t)127) + contrib_x), 0, 255);
-        }
-        
-        if (absolute_value(contrib_y) >= gamepad->gyro_to_analog_activation_treshold) {
-            out_shifted_buf[2] = min_max_clamp((int64_t)127 + (((int64_t)out_shifted_buf[2] - (int64_t)127) + contrib_y), 0, 255);
-        }
+    if (dirty & GAMEPAD_STATUS_DIRTY_STICKS) {
+        int32_t sticks[2][2];
+        gamepad_response_sticks(gamepad->response, in_device_status, sticks);
+
+        out_shifted_buf[1] = (uint8_t)((uint32_t)(sticks[0][0] + 32768) >> 8); // L stick, X axis
+        out_shifted_buf[2] = (uint8_t)((uint32_t)(sticks[0][1] + 32768) >> 8); // L stick, Y axis
+        out_shifted_buf[3] = (uint8_t)((uint32_t)(sticks[1][0] + 32768) >> 8); // R stick, X axis
+        out_shifted_buf[4] = (uint8_t)((uint32_t)(sticks[1][1] + 32768) >> 8); // R stick, Y axis
     }
 
-    if (in_device_status->join_right_analog_and_gyroscope) {
-        if (absolute_value(contrib_x) >= gamepad->gyro_to_analog_activation_treshold) {
-            out_shifted_buf[3] = min_max_clamp((int64_t)127 + (((int64_t)out_shifted_buf[3] - (int64_t)127) + contrib_x), 0, 255);
-        }
-        
-        if (absolute_value(contrib_y) >= gamepad->gyro_to_analog_activation_treshold) {
-            out_shifted_buf[4] = min_max_clamp((int64_t)127 + (((int64_t)out_shifted_buf[4] - (int64_t)127) + contrib_y), 0, 255);
-        }
+    if (dirty & GAMEPAD_STATUS_DIRTY_TRIGGERS) {
+        out_shifted_buf[5] = gamepad_response_trigger(gamepad->response, in_device_status->l2_trigger); // Z
+        out_shifted_buf[6] = gamepad_response_trigger(gamepad->response, in_device_status->r2_trigger); // RZ
     }
 
-    out_shifted_buf[5] = in_device_status->l2_trigger; // Z
-    out_shifted_buf[6] = in_device_status->r2_trigger; // RZ
     out_shifted_buf[7] = gamepad->seq_num++; // seq_number
-    out_shifted_buf[8] = (in_device_status->square ? 0x10 : 0x00) |
-                (in_device_status->cross ? 0x20 : 0x00) |
-                (in_device_status->circle ? 0x40 : 0x00) |
-                (in_device_status->triangle ? 0x80 : 0x00) |
-                (uint8_t)ds5_dpad_from_gamepad(in_device_status->dpad);
-    out_shifted_buf[9] = (in_device_status->l1 ? 0x01 : 0x00) |
-            (in_device_status->r1 ? 0x02 : 0x00) |
-            /*(in_device_status->l2_trigger >= 225 ? 0x04 : 0x00)*/ 0x00 |
-            /*(in_device_status->r2_trigger >= 225 ? 0x08 : 0x00)*/ 0x00 |
-            (in_device_status->option ? 0x10 : 0x00) |
-            (in_device_status->share ? 0x20 : 0x00) |
-            (in_device_status->l3 ? 0x40 : 0x00) |
-            (in_device_status->r3 ? 0x80 : 0x00);
-
-    // mic button press is 0x04, touchpad press is 0x02
-    out_shifted_buf[10] = ((gamepad->edge_model) && (in_device_status->l5) ? 0x40 : 0x00) |
-            ((gamepad->edge_model) && (in_device_status->r5) ? 0x80 : 0x00) |
-            ((gamepad->edge_model) && (in_device_status->l4) ? 0x10 : 0x00) |
-            ((gamepad->edge_model) && (in_device_status->r4) ? 0x20 : 0x00) |
-            (in_device_status->touchpad_press ? 0x02 : 0x00) |
-            (in_device_status->center ? 0x01 : 0x00);
+
+    if (dirty & GAMEPAD_STATUS_DIRTY_BUTTONS) {
+        out_shifted_buf[8] = (in_device_status->square ? 0x10 : 0x00) |
+                    (in_device_status->cross ? 0x20 : 0x00) |
+                    (in_device_status->circle ? 0x40 : 0x00) |
+                    (in_device_status->triangle ? 0x80 : 0x00) |
+                    (uint8_t)ds5_dpad_from_gamepad(in_device_status->dpad);
+        out_shifted_buf[9] = (in_device_status->l1 ? 0x01 : 0x00) |
+                (in_device_status->r1 ? 0x02 : 0x00) |
+                /*(in_device_status->l2_trigger >= 225 ? 0x04 : 0x00)*/ 0x00 |
+                /*(in_device_status->r2_trigger >= 225 ? 0x08 : 0x00)*/ 0x00 |
+                (in_device_status->option ? 0x10 : 0x00) |
+                (in_device_status->share ? 0x20 : 0x00) |
+                (in_device_status->l3 ? 0x40 : 0x00) |
+                (in_device_status->r3 ? 0x80 : 0x00);
+
+        // mic button press is 0x04, touchpad press is 0x02
+        out_shifted_buf[10] = ((gamepad->edge_model) && (in_device_status->l5) ? 0x40 : 0x00) |
+                ((gamepad->edge_model) && (in_device_status->r5) ? 0x80 : 0x00) |
+                ((gamepad->edge_model) && (in_device_status->l4) ? 0x10 : 0x00) |
+                ((gamepad->edge_model) && (in_device_status->r4) ? 0x20 : 0x00) |
+                (in_device_status->touchpad_press ? 0x02 : 0x00) |
+                (in_device_status->center ? 0x01 : 0x00);
+    }
     //buf[11] = ;
     
     //buf[12] = 0x20; // [12] battery level | this is called sensor_temparature in the kernel driver but is never used...
-    memcpy(&out_shifted_buf[16], &g_x, sizeof(int16_t));
-    memcpy(&out_shifted_buf[18], &g_y, sizeof(int16_t));
-    memcpy(&out_shifted_buf[20], &g_z, sizeof(int16_t));
-    memcpy(&out_shifted_buf[22], &a_x, sizeof(int16_t));
-    memcpy(&out_shifted_buf[24], &a_y, sizeof(int16_t));
-    memcpy(&out_shifted_buf[26], &a_z, sizeof(int16_t));
+    if (dirty & GAMEPAD_STATUS_DIRTY_GYRO) {
+        memcpy(&out_shifted_buf[16], &g_x, sizeof(int16_t));
+        memcpy(&out_shifted_buf[18], &g_y, sizeof(int16_t));
+        memcpy(&out_shifted_buf[20], &g_z, sizeof(int16_t));
+    }
+
+    if (dirty & GAMEPAD_STATUS_DIRTY_ACCEL) {
+        memcpy(&out_shifted_buf[22], &a_x, sizeof(int16_t));
+        memcpy(&out_shifted_buf[24], &a_y, sizeof(int16_t));
+        memcpy(&out_shifted_buf[26], &a_z, sizeof(int16_t));
+    }
+
     memcpy(&out_shifted_buf[28], &timestamp, sizeof(timestamp));
 
-    // point of contact number 0
-    out_shifted_buf[33] = (in_device_status->touchpad_touch_num == -1) ? 0x80 : 0x7F; //contact
-    out_shifted_buf[34] = in_device_status->touchpad_x & (int16_t)0x00FF; //x_lo
-    out_shifted_buf[35] = (((in_device_status->touchpad_x & (int16_t)0x0F00) >> (int16_t)8) | ((in_device_status->touchpad_y & (int16_t)0x000F) << (int16_t)4)); // x_hi:4 y_lo:4
-    out_shifted_buf[36] = (in_device_status->touchpad_y & (int16_t)0x0FF0) >> (int16_t)4; //y_hi
-
-    // point of contact number 1
-    out_shifted_buf[37] = 0x80; //contact
-    out_shifted_buf[38] = 0x00; //x_lo
-    out_shifted_buf[39] = 0x00; //x_hi:4 y_lo:4
-    out_shifted_buf[40] = 0x00; //y_hi
+    if (dirty & GAMEPAD_STATUS_DIRTY_TOUCHPAD) {
+        // point of contact number 0
+        out_shifted_buf[33] = (in_device_status->touchpad_touch_num == -1) ? 0x80 : 0x7F; //contact
+        out_shifted_buf[34] = in_device_status->touchpad_x & (int16_t)0x00FF; //x_lo
+        out_shifted_buf[35] = (((in_device_status->touchpad_x & (int16_t)0x0F00) >> (int16_t)8) | ((in_device_status->touchpad_y & (int16_t)0x000F) << (int16_t)4)); // x_hi:4 y_lo:4
+        out_shifted_buf[36] = (in_device_status->touchpad_y & (int16_t)0x0FF0) >> (int16_t)4; //y_hi
+
+        // point of contact number 1
+        out_shifted_buf[37] = 0x80; //contact
+        out_shifted_buf[38] = 0x00; //x_lo
+        out_shifted_buf[39] = 0x00; //x_hi:4 y_lo:4
+        out_shifted_buf[40] = 0x00; //y_hi
+    }
+
+    memcpy(out_buf, report, gamepad->bluetooth ? DS_INPUT_REPORT_BT_SIZE : DS_INPUT_REPORT_USB_SIZE);
 }
 
 int virt_dualsense_send(virt_dualsense_t *const gamepad, uint8_t *const out_shifted_buf) {
@@ -1548,15 +1541,13 @@ int virt_dualsense_send(virt_dualsense_t *const gamepad, uint8_t *const out_shif
             }
         }
     };
-    
 
-    memcpy(&l.u.input2.data[0], &out_shifted_buf[0], l.u.input2.size);
 
     if (gamepad->bluetooth) {
-        uint32_t crc = crc32_le(0xFFFFFFFFU, (const uint8_t*)&PS_INPUT_CRC32_SEED, sizeof(PS_INPUT_CRC32_SEED));
-        crc = ~crc32_le(crc, (const uint8_t *)&l.u.input2.data[0], l.u.input2.size - 4);
-        memcpy(&l.u.input2.data[l.u.input2.size - sizeof(crc)], &crc, sizeof(crc));
+        ps_crc32_report_seal(PS_INPUT_CRC32_SEED, out_shifted_buf, l.u.input2.size);
     }
 
+    memcpy(&l.u.input2.data[0], &out_shifted_buf[0], l.u.input2.size);
+
     return uhid_write(gamepad->fd, &l);
 }
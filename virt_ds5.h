@@ -2,6 +2,16 @@
 
 #include "message.h"
 #include "devices_status.h"
+#include "gamepad_response.h"
+
+#define DS_FEATURE_REPORT_PAIRING_INFO      0x09
+#define DS_FEATURE_REPORT_PAIRING_INFO_SIZE 20
+
+#define DS_FEATURE_REPORT_FIRMWARE_INFO         0x20
+#define DS_FEATURE_REPORT_FIRMWARE_INFO_SIZE    64
+
+#define DS_FEATURE_REPORT_CALIBRATION       0x05
+#define DS_FEATURE_REPORT_CALIBRATION_SIZE  41
 
 /**
  * Emulator of the DualSense controller at USB level using USB UHID ( https://www.kernel.org/doc/html/latest/hid/uhid.html ) kernel APIs.
@@ -26,16 +36,24 @@ typedef struct virt_dualsense {
     uint32_t empty_reports;
     int64_t last_time;
 
-    int64_t gyro_to_analog_activation_treshold;
-    int64_t gyro_to_analog_mapping;
+    // sticks, triggers and gyro-to-analog curves: owned by the caller of the init function
+    const gamepad_response_t *response;
+
+    // last input report: virt_dualsense_compose only rewrites what gamepad_status_t marks as dirty
+    bool report_composed;
+    uint8_t report[78];
+
+    // GET_REPORT replies are constant: built (and checksummed when in bluetooth mode) by virt_dualsense_init
+    uint8_t pairing_info_report[DS_FEATURE_REPORT_PAIRING_INFO_SIZE];
+    uint8_t firmware_info_report[DS_FEATURE_REPORT_FIRMWARE_INFO_SIZE];
+    uint8_t calibration_report[DS_FEATURE_REPORT_CALIBRATION_SIZE];
 } virt_dualsense_t;
 
 int virt_dualsense_init(
     virt_dualsense_t *const gamepad,
     bool bluetooth,
     bool dualsense_edge,
-    int64_t gyro_to_analog_activation_treshold,
-    int64_t gyro_to_analog_mapping
+    const gamepad_response_t *const response
 );
 
 int virt_dualsense_get_fd(
@@ -8,53 +8,20 @@
 #define VIRT_KBD_DEV_PRODUCT_ID 0x0323
 #define VIRT_KBD_DEV_VERSION 0x0111
 
+// every key changing in the same frame plus the MSC_TIMESTAMP and the SYN_REPORT
+#define VIRT_KBD_MAX_FRAME_EVENTS (KEYBOARD_STATUS_KEYS_COUNT + 2)
+
 typedef struct virt_kbd {
     int fd;
 
-    uint8_t prev_q;
-    uint8_t prev_w;
-    uint8_t prev_e;
-    uint8_t prev_r;
-    uint8_t prev_t;
-    uint8_t prev_y;
-    uint8_t prev_u;
-    uint8_t prev_i;
-    uint8_t prev_o;
-    uint8_t prev_p;
-    uint8_t prev_a;
-    uint8_t prev_s;
-    uint8_t prev_d;
-    uint8_t prev_f;
-    uint8_t prev_g;
-    uint8_t prev_h;
-    uint8_t prev_j;
-    uint8_t prev_k;
-    uint8_t prev_l;
-    uint8_t prev_z;
-    uint8_t prev_x;
-    uint8_t prev_c;
-    uint8_t prev_v;
-    uint8_t prev_b;
-    uint8_t prev_n;
-    uint8_t prev_m;
-
-    uint8_t prev_num_1;
-    uint8_t prev_num_2;
-    uint8_t prev_num_3;
-    uint8_t prev_num_4;
-    uint8_t prev_num_5;
-    uint8_t prev_num_6;
-    uint8_t prev_num_7;
-    uint8_t prev_num_8;
-    uint8_t prev_num_9;
-    uint8_t prev_num_0;
+    // keys state as of the last frame sent
+    uint64_t prev_keys[KEYBOARD_STATUS_KEYS_WORDS];
 
-    uint8_t prev_up;
-    uint8_t prev_down;
-    uint8_t prev_left;
-    uint8_t prev_right;
+    // timestamp of the last frame sent
+    struct timeval prev_time;
 
-    uint8_t prev_lctrl;
+    // events of the frame being sent: written all at once
+    struct input_event frame[VIRT_KBD_MAX_FRAME_EVENTS];
 
 } virt_kbd_t;
 
@@ -47,6 +47,7 @@ int virt_mouse_init(virt_mouse_t *const mouse) {
     mouse->prev_btn_left = 0;
     mouse->prev_btn_right = 0;
     mouse->prev_btn_middle = 0;
+    timerclear(&mouse->prev_time);
     mouse->fd = fd;
     ret = 0;
 
@@ -67,7 +68,7 @@ int virt_mouse_send(virt_mouse_t *const mouse, mouse_status_t *const status, str
     int res = 0;
     
     size_t events_count = 0;
-    struct input_event events[12];
+    struct input_event *const events = mouse->frame;
 
     struct input_event tmp_ev;
     tmp_ev.type = EV_REL;
@@ -107,54 +108,28 @@ int virt_mouse_send(virt_mouse_t *const mouse, mouse_status_t *const status, str
         events[events_count++] = tmp_ev;
     }
 
-    #if 0
-	const struct input_event timestamp_ev = {
-		.code = MSC_TIMESTAMP,
-		.type = EV_MSC,
-		.value = (now.tv_sec - secAtInit)*1000000 + (now.tv_usec - usecAtInit),
-		.time = now,
-	};
-	const ssize_t timestamp_written = write(fd, (void*)&timestamp_ev, sizeof(timestamp_ev));
-	if (timestamp_written != sizeof(timestamp_ev)) {
-		fprintf(stderr, "Error in sync: written %ld bytes out of %ld\n", timestamp_written, sizeof(timestamp_ev));
-	}
-    #endif
-
     if (events_count > 0) {
         struct timeval t;
-        if (now != NULL) {
-            t = *now;
-        } else {
-            gettimeofday(&t, NULL);
-        }
-        
-        struct input_event syn_ev = {
-            .code = SYN_REPORT,
-            .type = EV_SYN,
-            .value = 0,
-            .time = t,
-        };
-        syn_ev.time.tv_usec += 1;
-
-        events[events_count++] = syn_ev;
-
-        for (size_t i = 0; i < events_count; ++i) {
-            if (i != (events_count - 1)) {
-                events[i].time = t;
-            }
-
-            const ssize_t sync_written = write(mouse->fd, (void*)&events[i], sizeof(struct input_event));
-            if (sync_written != sizeof(syn_ev)) {
-                fprintf(stderr, "Error in sync: written %ld bytes out of %ld\n", sync_written, sizeof(syn_ev));
-                res = errno;
-                res = res < 0 ? res : -1*res;
-                res = res == 0 ? -EIO : res;
-                goto virt_mouse_send_err;
-            }
+        input_frame_time(&t, status->time_valid ? &status->time : NULL, now, &mouse->prev_time);
+
+        input_frame_msc_timestamp(&events[events_count], &t);
+        ++events_count;
+
+        events[events_count].type = EV_SYN;
+        events[events_count].code = SYN_REPORT;
+        events[events_count].value = 0;
+        ++events_count;
+
+        res = write_input_frame(mouse->fd, events, events_count, &t);
+        if (res != 0) {
+            goto virt_mouse_send_err;
         }
     }
 
 virt_mouse_send_err:
+    // the next frame only merges events received from now on
+    status->time_valid = false;
+
     return res;
 }
 
@@ -8,6 +8,9 @@
 #define VIRT_MOUSE_DEV_PRODUCT_ID 0x0323
 #define VIRT_MOUSE_DEV_VERSION 0x0111
 
+// REL_X, REL_Y, three buttons, the MSC_TIMESTAMP and the SYN_REPORT
+#define VIRT_MOUSE_MAX_FRAME_EVENTS 8
+
 typedef struct virt_mouse {
     int fd;
 
@@ -15,8 +18,14 @@ typedef struct virt_mouse {
     uint8_t prev_btn_right;
     uint8_t prev_btn_middle;
 
+    // timestamp of the last frame sent
+    struct timeval prev_time;
+
     uint64_t status_recv;
 
+    // events of the frame being sent: written all at once
+    struct input_event frame[VIRT_MOUSE_MAX_FRAME_EVENTS];
+
 } virt_mouse_t;
 
 int virt_mouse_init(virt_mouse_t *const mouse);
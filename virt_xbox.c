@@ -0,0 +1,327 @@
+#include "virt_xbox.h"
+
+static const uint16_t abs_codes[VIRT_XBOX_ABS_COUNT] = {
+    ABS_X, ABS_Y, ABS_RX, ABS_RY, ABS_Z, ABS_RZ, ABS_HAT0X, ABS_HAT0Y,
+};
+
+static const uint16_t btn_codes[VIRT_XBOX_BTN_COUNT] = {
+    BTN_SOUTH, BTN_EAST, BTN_NORTH, BTN_WEST,
+    BTN_TL, BTN_TR,
+    BTN_SELECT, BTN_START, BTN_MODE,
+    BTN_THUMBL, BTN_THUMBR,
+    BTN_TRIGGER_HAPPY5, BTN_TRIGGER_HAPPY6, BTN_TRIGGER_HAPPY7, BTN_TRIGGER_HAPPY8, // P1 P2 P3 P4 (xpad order)
+};
+
+static int set_abs(int fd, uint16_t code, int32_t min, int32_t max, int32_t fuzz, int32_t flat) {
+    struct uinput_abs_setup abs_setup = {
+        .code = code,
+        .absinfo = {
+            .value = 0,
+            .minimum = min,
+            .maximum = max,
+            .fuzz = fuzz,
+            .flat = flat,
+            .resolution = 0,
+        },
+    };
+
+    return ioctl(fd, UI_ABS_SETUP, &abs_setup);
+}
+
+int virt_xbox_init(
+    virt_xbox_t *const gamepad,
+    const gamepad_response_t *const response
+) {
+    int ret = -EINVAL;
+
+    memset(gamepad, 0, sizeof(virt_xbox_t));
+    gamepad->response = response;
+    gamepad->debug = false;
+    gamepad->prev_valid = false;
+
+    int fd = open("/dev/uinput", O_RDWR);
+    if (fd < 0) {
+        ret = errno > 0 ? -1 * errno : errno;
+        ret = ret == 0 ? -EIO : ret;
+        goto virt_xbox_init_err;
+    }
+
+    ioctl(fd, UI_SET_EVBIT, EV_KEY);
+    ioctl(fd, UI_SET_EVBIT, EV_ABS);
+    ioctl(fd, UI_SET_EVBIT, EV_FF);
+    ioctl(fd, UI_SET_EVBIT, EV_SYN);
+    ioctl(fd, UI_SET_FFBIT, FF_RUMBLE);
+
+    for (size_t i = 0; i < VIRT_XBOX_BTN_COUNT; ++i) {
+        ioctl(fd, UI_SET_KEYBIT, btn_codes[i]);
+    }
+
+    for (size_t i = 0; i < VIRT_XBOX_ABS_COUNT; ++i) {
+        ioctl(fd, UI_SET_ABSBIT, abs_codes[i]);
+    }
+
+    set_abs(fd, ABS_X, -32768, 32767, 16, 128);
+    set_abs(fd, ABS_Y, -32768, 32767, 16, 128);
+    set_abs(fd, ABS_RX, -32768, 32767, 16, 128);
+    set_abs(fd, ABS_RY, -32768, 32767, 16, 128);
+    set_abs(fd, ABS_Z, 0, 255, 0, 0);
+    set_abs(fd, ABS_RZ, 0, 255, 0, 0);
+    set_abs(fd, ABS_HAT0X, -1, 1, 0, 0);
+    set_abs(fd, ABS_HAT0Y, -1, 1, 0, 0);
+
+    struct uinput_setup dev = {0};
+    strncpy(dev.name, VIRT_XBOX_DEV_NAME, UINPUT_MAX_NAME_SIZE-1);
+    dev.id.bustype = BUS_USB;
+    dev.id.vendor = VIRT_XBOX_DEV_VENDOR_ID;
+    dev.id.product = VIRT_XBOX_DEV_PRODUCT_ID;
+    dev.id.version = VIRT_XBOX_DEV_VERSION;
+    dev.ff_effects_max = VIRT_XBOX_FF_EFFECTS_MAX;
+
+    if (ioctl(fd, UI_DEV_SETUP, &dev) < 0) {
+        ret = errno > 0 ? -1 * errno : errno;
+        ret = ret == 0 ? -EIO : ret;
+        goto virt_xbox_init_err;
+    }
+
+    if (ioctl(fd, UI_DEV_CREATE) < 0) {
+        ret = errno > 0 ? -1 * errno : errno;
+        ret = ret == 0 ? -EIO : ret;
+        goto virt_xbox_init_err;
+    }
+
+    // initialization ok
+    gamepad->fd = fd;
+    ret = 0;
+
+virt_xbox_init_err:
+    if (ret != 0) {
+        gamepad->fd = -1;
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    return ret;
+}
+
+int virt_xbox_get_fd(virt_xbox_t *const gamepad) {
+    return gamepad->fd;
+}
+
+static int64_t monotonic_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((int64_t)now.tv_sec * (int64_t)1000000) + ((int64_t)now.tv_nsec / (int64_t)1000);
+}
+
+/**
+ * Drive the motors with the strongest of the effects playing at now_us, stopping those that are over.
+ */
+static void mix_effects(virt_xbox_t *const gamepad, gamepad_status_t *const out_device_status, int64_t now_us) {
+    uint16_t strong = 0;
+    uint16_t weak = 0;
+
+    for (int i = 0; i < VIRT_XBOX_FF_EFFECTS_MAX; ++i) {
+        virt_xbox_ff_effect_t *const effect = &gamepad->effects[i];
+        if (!effect->playing) {
+            continue;
+        }
+
+        if ((effect->length_ms != 0) && (now_us >= effect->end_us)) {
+            effect->playing = false;
+            continue;
+        }
+
+        if (now_us >= effect->start_us) {
+            strong = (effect->rumble.strong_magnitude > strong) ? effect->rumble.strong_magnitude : strong;
+            weak = (effect->rumble.weak_magnitude > weak) ? effect->rumble.weak_magnitude : weak;
+        }
+    }
+
+    // strong (low frequency) motor is the left one
+    const uint8_t motors[2] = { (uint8_t)(strong >> 8), (uint8_t)(weak >> 8) };
+    if (memcmp(out_device_status->motors_intensity, motors, sizeof(motors)) == 0) {
+        return;
+    }
+
+    memcpy(out_device_status->motors_intensity, motors, sizeof(motors));
+    ++out_device_status->rumble_events_count;
+
+    if (gamepad->debug) {
+        printf(
+            "Updated rumble -- motor_left: %d, motor_right: %d\n",
+            out_device_status->motors_intensity[0],
+            out_device_status->motors_intensity[1]
+        );
+    }
+}
+
+static void play_effect(virt_xbox_t *const gamepad, int effect_id, int32_t play_count, int64_t now_us) {
+    if ((effect_id < 0) || (effect_id >= VIRT_XBOX_FF_EFFECTS_MAX)) {
+        return;
+    }
+
+    virt_xbox_ff_effect_t *const effect = &gamepad->effects[effect_id];
+    effect->playing = play_count > 0;
+    if (effect->playing) {
+        // every play waits for the delay again
+        const int64_t play_us = ((int64_t)effect->delay_ms + (int64_t)effect->length_ms) * (int64_t)1000;
+        effect->start_us = now_us + ((int64_t)effect->delay_ms * (int64_t)1000);
+        effect->end_us = now_us + (play_us * (int64_t)play_count);
+    }
+}
+
+int virt_xbox_event(virt_xbox_t *const gamepad, gamepad_status_t *const out_device_status) {
+    struct input_event events[16];
+
+    const ssize_t ret = read(gamepad->fd, events, sizeof(events));
+    if (ret < 0) {
+        fprintf(stderr, "Cannot read events from uinput: %d\n", errno);
+        return -1 * errno;
+    }
+
+    const size_t events_count = (size_t)ret / sizeof(struct input_event);
+    for (size_t i = 0; i < events_count; ++i) {
+        if ((events[i].type == EV_UINPUT) && (events[i].code == UI_FF_UPLOAD)) {
+            struct uinput_ff_upload upload = {
+                .request_id = events[i].value,
+            };
+
+            if (ioctl(gamepad->fd, UI_BEGIN_FF_UPLOAD, &upload) < 0) {
+                fprintf(stderr, "Error beginning FF upload: %d\n", errno);
+                continue;
+            }
+
+            if ((upload.effect.id >= 0) && (upload.effect.id < VIRT_XBOX_FF_EFFECTS_MAX) && (upload.effect.type == FF_RUMBLE)) {
+                // an effect updated while playing keeps playing with the new magnitudes
+                virt_xbox_ff_effect_t *const effect = &gamepad->effects[upload.effect.id];
+                effect->rumble = upload.effect.u.rumble;
+                effect->delay_ms = upload.effect.replay.delay;
+                effect->length_ms = upload.effect.replay.length;
+                upload.retval = 0;
+            } else {
+                upload.retval = -EINVAL;
+            }
+
+            if (ioctl(gamepad->fd, UI_END_FF_UPLOAD, &upload) < 0) {
+                fprintf(stderr, "Error ending FF upload: %d\n", errno);
+            }
+        } else if ((events[i].type == EV_UINPUT) && (events[i].code == UI_FF_ERASE)) {
+            struct uinput_ff_erase erase = {
+                .request_id = events[i].value,
+            };
+
+            if (ioctl(gamepad->fd, UI_BEGIN_FF_ERASE, &erase) < 0) {
+                fprintf(stderr, "Error beginning FF erase: %d\n", errno);
+                continue;
+            }
+
+            if (erase.effect_id < VIRT_XBOX_FF_EFFECTS_MAX) {
+                memset(&gamepad->effects[erase.effect_id], 0, sizeof(gamepad->effects[erase.effect_id]));
+            }
+            erase.retval = 0;
+
+            if (ioctl(gamepad->fd, UI_END_FF_ERASE, &erase) < 0) {
+                fprintf(stderr, "Error ending FF erase: %d\n", errno);
+            }
+        } else if ((events[i].type == EV_FF) && (events[i].code != FF_GAIN)) {
+            play_effect(gamepad, events[i].code, events[i].value, monotonic_us());
+        }
+    }
+
+    mix_effects(gamepad, out_device_status, monotonic_us());
+
+    return 0;
+}
+
+int virt_xbox_send(virt_xbox_t *const gamepad, gamepad_status_t *const in_device_status, struct timeval *const now) {
+    int res = 0;
+
+    // effects with a length expire on the report clock: nobody else stops them
+    mix_effects(gamepad, in_device_status, monotonic_us());
+
+    int32_t sticks[2][2];
+    gamepad_response_sticks(gamepad->response, in_device_status, sticks);
+
+    const int32_t abs_values[VIRT_XBOX_ABS_COUNT] = {
+        sticks[0][0],
+        sticks[0][1],
+        sticks[1][0],
+        sticks[1][1],
+        gamepad_response_trigger(gamepad->response, in_device_status->l2_trigger),
+        gamepad_response_trigger(gamepad->response, in_device_status->r2_trigger),
+        (in_device_status->dpad & 0x01) ? 1 : ((in_device_status->dpad & 0x02) ? -1 : 0),
+        (in_device_status->dpad & 0x10) ? -1 : ((in_device_status->dpad & 0x20) ? 1 : 0),
+    };
+
+    const uint8_t btn_values[VIRT_XBOX_BTN_COUNT] = {
+        in_device_status->cross,
+        in_device_status->circle,
+        in_device_status->triangle,
+        in_device_status->square,
+        in_device_status->l1,
+        in_device_status->r1,
+        in_device_status->share,
+        in_device_status->option,
+        in_device_status->center,
+        in_device_status->l3,
+        in_device_status->r3,
+        in_device_status->r4,
+        in_device_status->r5,
+        in_device_status->l4,
+        in_device_status->l5,
+    };
+
+    size_t events_count = 0;
+    struct input_event *const events = gamepad->frame;
+
+    for (size_t i = 0; i < VIRT_XBOX_ABS_COUNT; ++i) {
+        if ((!gamepad->prev_valid) || (gamepad->prev_abs[i] != abs_values[i])) {
+            gamepad->prev_abs[i] = abs_values[i];
+            events[events_count].type = EV_ABS;
+            events[events_count].code = abs_codes[i];
+            events[events_count].value = abs_values[i];
+            ++events_count;
+        }
+    }
+
+    for (size_t i = 0; i < VIRT_XBOX_BTN_COUNT; ++i) {
+        const uint8_t pressed = btn_values[i] ? 1 : 0;
+        if ((!gamepad->prev_valid) || (gamepad->prev_btn[i] != pressed)) {
+            gamepad->prev_btn[i] = pressed;
+            events[events_count].type = EV_KEY;
+            events[events_count].code = btn_codes[i];
+            events[events_count].value = pressed;
+            ++events_count;
+        }
+    }
+
+    gamepad->prev_valid = true;
+
+    if (events_count > 0) {
+        struct timeval t;
+        if (now != NULL) {
+            t = *now;
+        } else {
+            gettimeofday(&t, NULL);
+        }
+
+        events[events_count].type = EV_SYN;
+        events[events_count].code = SYN_REPORT;
+        events[events_count].value = 0;
+        ++events_count;
+
+        res = write_input_frame(gamepad->fd, events, events_count, &t);
+        if (res != 0) {
+            goto virt_xbox_send_err;
+        }
+    }
+
+virt_xbox_send_err:
+    return res;
+}
+
+void virt_xbox_close(virt_xbox_t *const gamepad) {
+    ioctl(gamepad->fd, UI_DEV_DESTROY);
+    close(gamepad->fd);
+}
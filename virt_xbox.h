@@ -0,0 +1,83 @@
+#pragma once
+
+#include "message.h"
+#include "devices_status.h"
+#include "gamepad_response.h"
+
+#define VIRT_XBOX_DEV_NAME "Microsoft Xbox Elite Series 2 Controller"
+#define VIRT_XBOX_DEV_VENDOR_ID 0x045e
+#define VIRT_XBOX_DEV_PRODUCT_ID 0x0b00
+#define VIRT_XBOX_DEV_VERSION 0x0511
+
+// sticks, triggers and hat
+#define VIRT_XBOX_ABS_COUNT 8
+
+// face buttons, bumpers, select/start/mode, thumbs and the four back paddles
+#define VIRT_XBOX_BTN_COUNT 15
+
+#define VIRT_XBOX_FF_EFFECTS_MAX 16
+
+/**
+ * A rumble effect uploaded by a game and whether it is playing: uinput leaves timing effects to the device.
+ */
+typedef struct virt_xbox_ff_effect {
+    struct ff_rumble_effect rumble;
+
+    // as uploaded: delay before playing and duration of a play, 0 to play until stopped
+    uint16_t delay_ms;
+    uint16_t length_ms;
+
+    bool playing;
+
+    // CLOCK_MONOTONIC microseconds the effect starts and stops (unless length_ms is 0) at
+    int64_t start_us;
+    int64_t end_us;
+} virt_xbox_ff_effect_t;
+
+/**
+ * Emulator of an Xbox Elite Series 2 controller using uinput ( https://www.kernel.org/doc/html/latest/input/uinput.html ):
+ * no HID report to encode, sticks are 16 bits and rumble is received as force-feedback effects.
+ */
+typedef struct virt_xbox {
+    int fd;
+
+    bool debug;
+
+    // sticks, triggers and gyro-to-analog curves: owned by the caller of the init function
+    const gamepad_response_t *response;
+
+    // last values sent: only what changed is written out
+    bool prev_valid;
+    int32_t prev_abs[VIRT_XBOX_ABS_COUNT];
+    uint8_t prev_btn[VIRT_XBOX_BTN_COUNT];
+
+    // rumble effects uploaded by games, indexed by effect id: the motors play the strongest of those playing
+    virt_xbox_ff_effect_t effects[VIRT_XBOX_FF_EFFECTS_MAX];
+
+    // events of the frame being sent: written all at once
+    struct input_event frame[VIRT_XBOX_ABS_COUNT + VIRT_XBOX_BTN_COUNT + 1];
+} virt_xbox_t;
+
+int virt_xbox_init(
+    virt_xbox_t *const gamepad,
+    const gamepad_response_t *const response
+);
+
+int virt_xbox_get_fd(
+    virt_xbox_t *const gamepad
+);
+
+int virt_xbox_event(
+    virt_xbox_t *const gamepad,
+    gamepad_status_t *const out_device_status
+);
+
+int virt_xbox_send(
+    virt_xbox_t *const gamepad,
+    gamepad_status_t *const in_device_status,
+    struct timeval *const now
+);
+
+void virt_xbox_close(
+    virt_xbox_t *const gamepad
+);
@@ -47,6 +47,10 @@ int xbox360_ev_map(
 				current_message.data.gamepad_set.element = GAMEPAD_BTN_L3;
 				current_message.data.gamepad_set.status.btn = coll->ev[i].value;
 			} else if (coll->ev[i].code == BTN_MODE) {
+				if (coll->resync) {
+					continue;
+				}
+
 				current_message.type = GAMEPAD_ACTION;
 				current_message.data.action = GAMEPAD_ACTION_PRESS_AND_RELEASE_CENTER;
 			}